@@ -38,6 +38,8 @@ static const char slash = '/';
 #define RETRO_DEVICE_LIGHT_PHASER   RETRO_DEVICE_SUBCLASS(RETRO_DEVICE_LIGHTGUN, 0)
 #define RETRO_DEVICE_PADDLE         RETRO_DEVICE_SUBCLASS(RETRO_DEVICE_MOUSE, 0)
 
+#define LIBRETRO_MAX_UPSCALE 3
+
 static retro_environment_t environ_cb;
 static retro_video_refresh_t video_cb;
 static retro_audio_sample_t audio_cb;
@@ -69,14 +71,21 @@ static int paddle_sensitivity = 0;
 static bool bootrom_sms = false;
 static bool bootrom_gg = false;
 static bool libretro_supports_bitmasks = false;
+static bool libretro_supports_dupe = false;
 static bool categories_supported = false;
 static float aspect_ratio = 0.0f;
 static int current_screen_width = 0;
 static int current_screen_height = 0;
 static float current_aspect_ratio = 0;
+static int current_upscale = 1;
+static bool upscale_changed = false;
+static bool sample_rate_changed = false;
 
 static GearsystemCore* core;
 static u8* frame_buffer;
+static u8* scaled_frame_buffer;
+static Scaler* scaler;
+static GS_Color_Format pixel_format;
 static Cartridge::ForceConfiguration config;
 static GearsystemCore::GlassesConfig glasses_config;
 static const retro_vfs_interface* vfs_interface = NULL;
@@ -166,12 +175,16 @@ void retro_init(void)
     core = new GearsystemCore();
 
 #ifdef PS2
-    core->Init(GS_PIXEL_BGR555);
+    pixel_format = GS_PIXEL_BGR555;
 #else
-    core->Init(GS_PIXEL_RGB565);
+    pixel_format = GS_PIXEL_RGB565;
 #endif
 
+    core->Init(pixel_format);
+
     frame_buffer = new u8[GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN * 2];
+    scaled_frame_buffer = new u8[GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN * 2 * LIBRETRO_MAX_UPSCALE * LIBRETRO_MAX_UPSCALE];
+    scaler = new Scaler();
 
     config.type = Cartridge::CartridgeNotSupported;
     config.zone = Cartridge::CartridgeUnknownZone;
@@ -186,11 +199,16 @@ void retro_init(void)
         apply_controller_device(i, input_device[i], false);
 
     libretro_supports_bitmasks = environ_cb(RETRO_ENVIRONMENT_GET_INPUT_BITMASKS, NULL);
+
+    bool can_dupe = false;
+    libretro_supports_dupe = environ_cb(RETRO_ENVIRONMENT_GET_CAN_DUPE, &can_dupe) && can_dupe;
 }
 
 void retro_deinit(void)
 {
     SafeDeleteArray(frame_buffer);
+    SafeDeleteArray(scaled_frame_buffer);
+    SafeDelete(scaler);
     SafeDelete(core);
     vfs_interface = NULL;
 
@@ -199,7 +217,11 @@ void retro_deinit(void)
     current_screen_height = 0;
     current_aspect_ratio = 0.0f;
     aspect_ratio = 0.0f;
+    current_upscale = 1;
+    upscale_changed = false;
+    sample_rate_changed = false;
     libretro_supports_bitmasks = false;
+    libretro_supports_dupe = false;
 
     reset_controller_devices();
     clear_input_state();
@@ -247,14 +269,15 @@ void retro_get_system_av_info(struct retro_system_av_info *info)
 
     current_screen_width = runtime_info.screen_width;
     current_screen_height = runtime_info.screen_height;
+    current_upscale = scaler->GetFactor();
 
-    info->geometry.base_width   = current_screen_width;
-    info->geometry.base_height  = current_screen_height;
-    info->geometry.max_width    = GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN;
-    info->geometry.max_height   = GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN;
+    info->geometry.base_width   = current_screen_width * current_upscale;
+    info->geometry.base_height  = current_screen_height * current_upscale;
+    info->geometry.max_width    = GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * LIBRETRO_MAX_UPSCALE;
+    info->geometry.max_height   = GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN * LIBRETRO_MAX_UPSCALE;
     info->geometry.aspect_ratio = aspect_ratio;
     info->timing.fps            = runtime_info.region == Region_NTSC ? 60.0 : 50.0;
-    info->timing.sample_rate    = 44100.0;
+    info->timing.sample_rate    = (double)core->GetAudio()->GetSampleRate();
 }
 
 void retro_run(void)
@@ -265,33 +288,72 @@ void retro_run(void)
         check_variables();
     }
 
+    if (sample_rate_changed)
+    {
+        struct retro_system_av_info info;
+        retro_get_system_av_info(&info);
+        environ_cb(RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO, &info);
+        sample_rate_changed = false;
+    }
+
     update_input();
 
+    // Frames the frontend is going to drop (run-ahead) are not rendered, so
+    // the last converted frame always matches the last one it displayed.
+    // Their audio is not synthesized either.
+    int av_enable = 3;
+    if (!environ_cb(RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE, &av_enable))
+        av_enable = 3;
+    bool render = (av_enable & 1);
+    bool audio = (av_enable & 2);
+
     audio_sample_count = 0;
-    core->RunToVBlank(frame_buffer, audio_buf, &audio_sample_count);
+    core->RunToVBlank(frame_buffer, audio ? audio_buf : NULL, &audio_sample_count, NULL, render);
 
     GS_RuntimeInfo runtime_info;
     core->GetRuntimeInfo(runtime_info);
 
+    int upscale = scaler->GetFactor();
+    bool dupe_frame = libretro_supports_dupe && !core->IsFrameDirty() && !upscale_changed;
+
     if ((runtime_info.screen_width != current_screen_width) ||
         (runtime_info.screen_height != current_screen_height) ||
+        (upscale != current_upscale) ||
         (aspect_ratio != current_aspect_ratio))
     {
         current_screen_width = runtime_info.screen_width;
         current_screen_height = runtime_info.screen_height;
+        current_upscale = upscale;
         current_aspect_ratio = aspect_ratio;
 
         retro_system_av_info info;
-        info.geometry.base_width   = runtime_info.screen_width;
-        info.geometry.base_height  = runtime_info.screen_height;
-        info.geometry.max_width    = GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN;
-        info.geometry.max_height   = GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN;
+        info.geometry.base_width   = runtime_info.screen_width * upscale;
+        info.geometry.base_height  = runtime_info.screen_height * upscale;
+        info.geometry.max_width    = GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * LIBRETRO_MAX_UPSCALE;
+        info.geometry.max_height   = GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN * LIBRETRO_MAX_UPSCALE;
         info.geometry.aspect_ratio = aspect_ratio;
 
         environ_cb(RETRO_ENVIRONMENT_SET_GEOMETRY, &info.geometry);
+        dupe_frame = false;
     }
 
-    video_cb((uint8_t*)frame_buffer, runtime_info.screen_width, runtime_info.screen_height, runtime_info.screen_width * sizeof(u8) * 2);
+    u8* output = frame_buffer;
+
+    if (upscale > 1)
+    {
+        // The scaled buffer still holds the last frame when nothing changed
+        if (core->IsFrameDirty() || upscale_changed)
+            scaler->Scale(frame_buffer, scaled_frame_buffer, runtime_info.screen_width, runtime_info.screen_height, pixel_format);
+        output = scaled_frame_buffer;
+    }
+
+    upscale_changed = false;
+
+    int output_width = runtime_info.screen_width * upscale;
+    int output_height = runtime_info.screen_height * upscale;
+
+    // Passing NULL lets the frontend reuse the previous frame
+    video_cb(dupe_frame ? NULL : (uint8_t*)output, output_width, output_height, output_width * sizeof(u8) * 2);
 
     if (audio_sample_count > 0)
         audio_batch_cb(audio_buf, audio_sample_count / 2);
@@ -352,6 +414,7 @@ bool retro_load_game(const struct retro_game_info *info)
 
     core->GetCartridge()->Reset();
     check_variables();
+    sample_rate_changed = false;
     load_bootroms();
 
     snprintf(retro_game_path, sizeof(retro_game_path), "%s", info->path ? info->path : "");
@@ -374,6 +437,11 @@ bool retro_load_game(const struct retro_game_info *info)
     bool achievements = true;
     environ_cb(RETRO_ENVIRONMENT_SET_SUPPORT_ACHIEVEMENTS, &achievements);
 
+    // Compact savestates have a constant size for the loaded ROM and carry
+    // no host pointers or timestamps, but fields are stored in host layout
+    uint64_t quirks = RETRO_SERIALIZATION_QUIRK_ENDIAN_DEPENDENT | RETRO_SERIALIZATION_QUIRK_PLATFORM_DEPENDENT;
+    environ_cb(RETRO_ENVIRONMENT_SET_SERIALIZATION_QUIRKS, &quirks);
+
     Cartridge* cart = core->GetCartridge();
 
     log_cb(RETRO_LOG_INFO, "CRC: %08X\n", cart->GetCRC());
@@ -1125,6 +1193,52 @@ static void check_variables(void)
             aspect_ratio = 0.0f;
     }
 
+    var.key = "gearsystem_upscale";
+    var.value = NULL;
+
+    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+    {
+        Scaler::Filter filter = Scaler::FilterNearest;
+        int factor = 1;
+
+        if (strcmp(var.value, "2x") == 0)
+            factor = 2;
+        else if (strcmp(var.value, "3x") == 0)
+            factor = 3;
+        else if (strcmp(var.value, "Scale2x") == 0)
+            filter = Scaler::FilterScale2x;
+        else if (strcmp(var.value, "Scale3x") == 0)
+            filter = Scaler::FilterScale3x;
+        else if (strcmp(var.value, "LCD 2x") == 0)
+        {
+            filter = Scaler::FilterLCD;
+            factor = 2;
+        }
+        else if (strcmp(var.value, "LCD 3x") == 0)
+        {
+            filter = Scaler::FilterLCD;
+            factor = 3;
+        }
+        else if (strcmp(var.value, "Scanlines 2x") == 0)
+        {
+            filter = Scaler::FilterScanlines;
+            factor = 2;
+        }
+        else if (strcmp(var.value, "Scanlines 3x") == 0)
+        {
+            filter = Scaler::FilterScanlines;
+            factor = 3;
+        }
+
+        Scaler::Filter old_filter = scaler->GetFilter();
+        int old_factor = scaler->GetFactor();
+
+        scaler->SetFilter(filter, factor);
+
+        if ((scaler->GetFilter() != old_filter) || (scaler->GetFactor() != old_factor))
+            upscale_changed = true;
+    }
+
     var.key = "gearsystem_overscan";
     var.value = NULL;
 
@@ -1227,6 +1341,22 @@ static void check_variables(void)
         core->GetAudio()->SetFMVolume(volume_f);
     }
 
+    var.key = "gearsystem_sample_rate";
+    var.value = NULL;
+
+    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+    {
+        int sample_rate = atoi(var.value);
+        if (sample_rate < GS_AUDIO_SAMPLE_RATE_MIN || sample_rate > GS_AUDIO_SAMPLE_RATE_MAX)
+            sample_rate = GS_AUDIO_SAMPLE_RATE;
+
+        if (sample_rate != core->GetAudio()->GetSampleRate())
+        {
+            core->GetAudio()->SetSampleRate(sample_rate);
+            sample_rate_changed = true;
+        }
+    }
+
     var.key = "gearsystem_glasses";
     var.value = NULL;
 
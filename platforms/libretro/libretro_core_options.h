@@ -199,6 +199,27 @@ struct retro_core_option_v2_definition option_defs_us[] = {
         },
         "1:1 PAR"
     },
+    {
+        "gearsystem_upscale",
+        "Software Upscaling",
+        NULL,
+        "Upscale the output on the CPU before handing it to the frontend. 'Scale2x' and 'Scale3x' smooth diagonal edges, 'LCD' draws a pixel grid and 'Scanlines' darkens every other line. Useful with frontends or drivers without shader support.",
+        NULL,
+        "video",
+        {
+            { "Disabled",     NULL },
+            { "2x",           NULL },
+            { "3x",           NULL },
+            { "Scale2x",      NULL },
+            { "Scale3x",      NULL },
+            { "LCD 2x",       NULL },
+            { "LCD 3x",       NULL },
+            { "Scanlines 2x", NULL },
+            { "Scanlines 3x", NULL },
+            { NULL, NULL },
+        },
+        "Disabled"
+    },
     {
         "gearsystem_overscan",
         "Overscan",
@@ -342,6 +363,21 @@ struct retro_core_option_v2_definition option_defs_us[] = {
         },
         "100"
     },
+    {
+        "gearsystem_sample_rate",
+        "Audio Sample Rate",
+        NULL,
+        "Set the rate the sound chips are synthesized at. Matching the rate of the audio device avoids an extra resampling step in the frontend.",
+        NULL,
+        "audio",
+        {
+            { "32000", NULL },
+            { "44100", NULL },
+            { "48000", NULL },
+            { NULL, NULL },
+        },
+        "44100"
+    },
 
     /* Input */
 
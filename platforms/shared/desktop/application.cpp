@@ -142,6 +142,12 @@ int application_init(const ApplicationParams& params)
         gui_debug_load_symbols_file(params.symbol_file);
     }
 
+    if (IsValidPointer(params.record_audio_file) && (strlen(params.record_audio_file) > 0))
+    {
+        Log("Record audio argument: %s", params.record_audio_file);
+        emu_start_audio_recording(params.record_audio_file);
+    }
+
     if (params.mcp_mode >= 0)
     {
         const char* mcp_http_address = params.mcp_http_address.empty() ? "127.0.0.1" : params.mcp_http_address.c_str();
@@ -28,6 +28,8 @@ struct ApplicationParams
 {
     const char* rom_file = NULL;
     const char* symbol_file = NULL;
+    const char* record_audio_file = NULL;
+    const char* movie_file = NULL;
     bool force_fullscreen = false;
     bool force_windowed = false;
     int mcp_mode = -1;
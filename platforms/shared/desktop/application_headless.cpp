@@ -23,6 +23,7 @@
 #include "application_headless.h"
 #include "config.h"
 #include "emu.h"
+#include "movie.h"
 #include "gui.h"
 #include "gui_debug.h"
 #include "gui_debug_disassembler.h"
@@ -41,9 +42,11 @@ int application_headless_init(const ApplicationParams& params)
     Log("\n%s", GS_TITLE_ASCII);
     Log("%s %s Headless Mode", GS_TITLE, GS_VERSION);
 
-    if (params.mcp_mode < 0)
+    bool movie_file_argument = IsValidPointer(params.movie_file) && (strlen(params.movie_file) > 0);
+
+    if ((params.mcp_mode < 0) && !movie_file_argument)
     {
-        Error("Headless mode requires --mcp-stdio or --mcp-http");
+        Error("Headless mode requires --mcp-stdio, --mcp-http or --movie");
         return 1;
     }
 
@@ -81,6 +84,7 @@ int application_headless_init(const ApplicationParams& params)
     emu_set_media_slot(config_emulator.media);
     emu_set_hide_left_bar(config_video.hide_left_bar);
     emu_video_no_sprite_limit(config_video.sprite_limit);
+    emu_video_threaded_rendering(config_video.threaded_rendering);
     emu_disable_ym2413(config_audio.ym2413 == 1);
 
     bool rom_file_argument = IsValidPointer(params.rom_file) && (strlen(params.rom_file) > 0);
@@ -101,6 +105,16 @@ int application_headless_init(const ApplicationParams& params)
         gui_debug_load_symbols_file(params.symbol_file);
     }
 
+    if (IsValidPointer(params.record_audio_file) && (strlen(params.record_audio_file) > 0))
+    {
+        Log("Record audio argument: %s", params.record_audio_file);
+        emu_start_audio_recording(params.record_audio_file);
+    }
+
+    // Movie replays run to completion without an MCP server
+    if (movie_file_argument)
+        return 0;
+
     const char* mcp_http_address = params.mcp_http_address.empty() ? "127.0.0.1" : params.mcp_http_address.c_str();
     if (params.mcp_mode == 0)
         Log("Starting MCP server (mode: stdio)...");
@@ -151,3 +165,21 @@ void application_headless_mainloop(void)
             SDL_Delay((Uint32)ceilf(target_ms - elapsed_ms));
     }
 }
+
+int application_headless_movie(const char* file_path)
+{
+    while (gui_is_rom_loading())
+    {
+        gui_finish_loading_rom();
+        SDL_Delay(1);
+    }
+
+    if (emu_is_empty())
+    {
+        Error("Movie replay requires a ROM file argument");
+        return 1;
+    }
+
+    Log("Replaying movie: %s", file_path);
+    return movie_replay(file_path);
+}
@@ -25,5 +25,6 @@
 int application_headless_init(const ApplicationParams& params);
 void application_headless_destroy(void);
 void application_headless_mainloop(void);
+int application_headless_movie(const char* file_path);
 
 #endif /* APPLICATION_HEADLESS_H */
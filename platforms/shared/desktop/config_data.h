@@ -63,6 +63,7 @@ struct config_Emulator
     bool ffwd;
     int ffwd_speed;
     int runahead;
+    bool runahead_second_instance;
     int system;
     int zone;
     int mapper;
@@ -108,6 +109,7 @@ struct config_Video
     bool fps;
     int sync_mode;
     bool sprite_limit;
+    bool threaded_rendering;
     float background_color[config_Theme_Count][3];
     float background_color_debugger[config_Theme_Count][3];
     int glasses;
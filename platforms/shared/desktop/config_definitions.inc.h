@@ -123,6 +123,7 @@ static inline void process(config_Operation operation)
     // Emulation
     CONFIG_INT("Emulator", "FFWD", config_emulator.ffwd_speed, 1);
     CONFIG_INT_RANGE("Emulator", "RunAhead", config_emulator.runahead, 0, 0, 3);
+    CONFIG_BOOL("Emulator", "RunAheadSecondInstance", config_emulator.runahead_second_instance, false);
     CONFIG_INT_RANGE("Emulator", "SaveSlot", config_emulator.save_slot, 0, 0, 4);
     CONFIG_BOOL("Emulator", "StartPaused", config_emulator.start_paused, false);
     CONFIG_BOOL("Emulator", "PauseWhenInactive", config_emulator.pause_when_inactive, true);
@@ -172,6 +173,7 @@ static inline void process(config_Operation operation)
     CONFIG_INT("Video", "HideLeftBar", config_video.hide_left_bar, 0);
     CONFIG_BOOL("Video", "FPS", config_video.fps, false);
     CONFIG_BOOL("Video", "SpriteLimit", config_video.sprite_limit, false);
+    CONFIG_BOOL("Video", "ThreadedRendering", config_video.threaded_rendering, false);
     CONFIG_INT("Video", "3DGlasses", config_video.glasses, 0);
     CONFIG_INT_RANGE("Video", "ShaderMode", config_video.shader_mode, config_ShaderMode_PixelPerfect, config_ShaderMode_PixelPerfect, config_ShaderMode_External);
 
@@ -22,12 +22,16 @@
 
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 #include <string.h>
 #include "gearsystem.h"
 #include "sound_queue.h"
 #include "config.h"
 #include "rewind.h"
 #include "runahead.h"
+#include "movie.h"
 #include "events.h"
 #include "gui_debug_trace_logger.h"
 #include "mcp/mcp_manager.h"
@@ -44,6 +48,8 @@ static bool audio_enabled;
 static McpManager* mcp_manager;
 static Uint64 rewind_last_counter = 0;
 static double rewind_pop_accumulator = 0.0;
+static GS_SaveState_Screenshot savestates_screenshots[5];
+static bool savestates_screenshots_loaded[5];
 
 enum Loading_State
 {
@@ -58,16 +64,76 @@ static bool loading_thread_active;
 static bool loading_result;
 static char loading_file_path[4096];
 static Cartridge::ForceConfiguration loading_config;
+static char audio_recording_pending_path[4096];
 static int emu_debug_halt_step_frames_pending;
 static const int kDebugHaltStepMaxFrames = 4;
 
+// Savestates are captured in the frame and compressed and written to disk
+// on a worker thread, so slow storage doesn't stall emulation
+struct State_Save_Job
+{
+    u32 id;
+    int slot;
+    std::string path;
+    GS_SaveState_Capture capture;
+    bool success;
+    bool wait;
+};
+
+static const size_t kStateSaveMaxResults = 16;
+static std::thread save_thread;
+static std::mutex save_mutex;
+static std::condition_variable save_condition;
+static std::condition_variable save_done_condition;
+static std::deque<State_Save_Job*> save_queue;
+static std::deque<State_Save_Job*> save_results;
+static bool save_thread_quit;
+static u32 save_next_id;
+static u32 save_finished_count;
+static u32 save_refreshed_count;
+
 u16* debug_background_buffer;
 u16* debug_tile_buffer;
 u16* debug_sprite_buffers[64];
 
+enum Debug_View
+{
+    Debug_View_Background,
+    Debug_View_Tiles,
+    Debug_View_Sprites,
+    Debug_View_Count
+};
+
+enum Debug_View_Update
+{
+    Debug_View_Update_None,
+    Debug_View_Update_Partial,
+    Debug_View_Update_Full
+};
+
+#define DEBUG_VIEW_KEY_SIZE 8
+
+// Snapshot of the VDP state each debug view was last built from. Only the
+// cells whose VRAM changed since then are decoded and converted again.
+struct DebugViewCache
+{
+    u8 vram[0x4000];
+    u16 palette[32];
+    int key[DEBUG_VIEW_KEY_SIZE];
+    bool valid;
+};
+
+static DebugViewCache debug_view_caches[Debug_View_Count];
+static bool debug_vram_dirty[0x4000 >> 3];
+
 static void save_ram(void);
 static void load_ram(void);
 static void reset_buffers(void);
+static void save_thread_func(void);
+static void trim_state_save_results(void);
+static u32 queue_state_save(const std::string& path, int slot, bool wait);
+static void finish_state_saves(void);
+static void start_pending_audio_recording(void);
 static const char* get_mapper(Cartridge::CartridgeTypes type);
 static const char* get_zone(Cartridge::CartridgeZones zone);
 static const char* get_configurated_dir(int option, const char* path); 
@@ -77,12 +143,16 @@ static void update_debug(void);
 static void update_debug_background(void);
 static void update_debug_tiles(void);
 static void update_debug_sprites(void);
-static void update_debug_background_buffer_smsgg(void);
-static void update_debug_tile_buffer_smsgg(void);
-static void update_debug_sprite_buffers_smsgg(void);
-static void update_debug_background_buffer_sg1000(void);
-static void update_debug_tile_buffer_sg1000(void);
-static void update_debug_sprite_buffers_sg1000(void);
+static Debug_View_Update check_debug_view(Debug_View view, const int* key);
+static void invalidate_debug_views(void);
+static bool is_debug_vram_dirty(int address, int size);
+static void render_debug_rect(u16* src, u8* dst, int stride, int x, int y, int width, int height);
+static bool update_debug_background_cell_smsgg(u8* vram, u8* regs, int tile_x, int tile_y, bool force);
+static bool update_debug_tile_smsgg(u8* vram, int tile_number, bool force);
+static bool update_debug_sprite_smsgg(u8* vram, u8* regs, int sprite, bool force);
+static bool update_debug_background_cell_sg1000(u8* vram, u8* regs, int tile_x, int tile_y, bool force);
+static bool update_debug_tile_sg1000(u8* vram, u8* regs, int tile_number, bool force);
+static bool update_debug_sprite_sg1000(u8* vram, u8* regs, int sprite, bool force);
 static void debug_step_instruction(void);
 static void reset_rewind_timing(void);
 static int get_rewind_pop_budget(void);
@@ -101,7 +171,7 @@ bool emu_init(void)
     sound_queue_init();
 
     for (int i = 0; i < 5; i++)
-        InitPointer(emu_savestates_screenshots[i].data);
+        InitPointer(savestates_screenshots[i].data);
 
     audio_enabled = true;
     emu_audio_sync = true;
@@ -113,12 +183,20 @@ bool emu_init(void)
     emu_debug_step_frames_pending = 0;
     emu_frame_counter = 0;
     emu_debug_tile_palette = 0;
+    audio_recording_pending_path[0] = 0;
 
     mcp_manager = new McpManager();
     mcp_manager->Init(gearsystem);
 
     rewind_init();
     runahead_init();
+    movie_init();
+
+    save_thread_quit = false;
+    save_next_id = 0;
+    save_finished_count = 0;
+    save_refreshed_count = 0;
+    save_thread = std::thread(save_thread_func);
 
     return true;
 }
@@ -132,6 +210,22 @@ void emu_destroy(void)
     }
     loading_state.store(Loading_State_None);
 
+    {
+        std::lock_guard<std::mutex> lock(save_mutex);
+        save_thread_quit = true;
+    }
+
+    save_condition.notify_one();
+    if (save_thread.joinable())
+        save_thread.join();
+
+    while (!save_results.empty())
+    {
+        delete save_results.front();
+        save_results.pop_front();
+    }
+
+    movie_destroy();
     save_ram();
     rewind_destroy();
     runahead_destroy();
@@ -143,7 +237,118 @@ void emu_destroy(void)
     destroy_debug();
 
     for (int i = 0; i < 5; i++)
-        SafeDeleteArray(emu_savestates_screenshots[i].data);
+        SafeDeleteArray(savestates_screenshots[i].data);
+}
+
+static void save_thread_func(void)
+{
+    std::unique_lock<std::mutex> lock(save_mutex);
+
+    while (true)
+    {
+        while (!save_thread_quit && save_queue.empty())
+            save_condition.wait(lock);
+
+        // Pending saves are always written before quitting
+        if (save_queue.empty())
+            break;
+
+        State_Save_Job* job = save_queue.front();
+
+        lock.unlock();
+        job->success = GearsystemCore::WriteSaveStateFile(job->path.c_str(), &job->capture);
+        GearsystemCore::ReleaseSaveStateCapture(&job->capture);
+        lock.lock();
+
+        save_queue.pop_front();
+        save_results.push_back(job);
+        save_finished_count++;
+
+        trim_state_save_results();
+
+        save_done_condition.notify_all();
+    }
+}
+
+// Results nobody waits for are only status messages for the GUI. Without
+// a GUI they are never read, so only the newest ones are kept.
+static void trim_state_save_results(void)
+{
+    size_t unclaimed = 0;
+
+    for (size_t i = 0; i < save_results.size(); i++)
+    {
+        if (!save_results[i]->wait)
+            unclaimed++;
+    }
+
+    size_t i = 0;
+
+    while ((unclaimed > kStateSaveMaxResults) && (i < save_results.size()))
+    {
+        State_Save_Job* job = save_results[i];
+
+        if (job->wait)
+        {
+            i++;
+            continue;
+        }
+
+        save_results.erase(save_results.begin() + i);
+        delete job;
+        unclaimed--;
+    }
+}
+
+static u32 queue_state_save(const std::string& path, int slot, bool wait)
+{
+    State_Save_Job* job = new State_Save_Job;
+    job->slot = slot;
+    job->path = path;
+    job->success = false;
+    job->wait = wait;
+
+    bool captured = gearsystem->CaptureSaveState(&job->capture, true);
+
+    if (!captured)
+        Error("Failed to save state to file: %s", path.c_str());
+
+    {
+        std::lock_guard<std::mutex> lock(save_mutex);
+        job->id = ++save_next_id;
+
+        if (captured)
+            save_queue.push_back(job);
+        else
+        {
+            save_results.push_back(job);
+            save_finished_count++;
+            trim_state_save_results();
+        }
+    }
+
+    if (captured)
+        save_condition.notify_one();
+    else
+        save_done_condition.notify_all();
+
+    return job->id;
+}
+
+static void finish_state_saves(void)
+{
+    u32 finished = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(save_mutex);
+        finished = save_finished_count;
+    }
+
+    if (finished != save_refreshed_count)
+    {
+        save_refreshed_count = finished;
+        update_savestates_data();
+    }
 }
 
 static void load_media_thread_func(void)
@@ -158,6 +363,7 @@ void emu_load_media_async(const char* file_path, Cartridge::ForceConfiguration c
         return;
 
     gui_debug_trace_logger_reset();
+    movie_stop();
 
     emu_debug_command = Debug_Command_None;
     reset_buffers();
@@ -194,9 +400,17 @@ bool emu_finish_media_loading(void)
     loading_state.store(Loading_State_None);
 
     if (!loading_result)
+    {
+        if (audio_recording_pending_path[0] != 0)
+        {
+            Log("Audio recording not started, media failed to load: %s", audio_recording_pending_path);
+            audio_recording_pending_path[0] = 0;
+        }
         return false;
+    }
 
     emu_audio_reset();
+    start_pending_audio_recording();
     load_ram();
 
     if (config_debug.debug && (config_debug.dis_look_ahead_count > 0))
@@ -204,6 +418,7 @@ bool emu_finish_media_loading(void)
 
     update_savestates_data();
     rewind_reset();
+    runahead_reset(loading_config);
 
     return true;
 }
@@ -215,6 +430,9 @@ void emu_render_current_frame(void)
 
     gearsystem->RenderFrameBuffer(emu_frame_buffer);
 
+    if (gearsystem->IsFrameDirty())
+        emu_frame_generation++;
+
     if (config_debug.debug)
         update_debug();
 }
@@ -230,6 +448,7 @@ void emu_update(void)
         return;
 
     emu_mcp_pump_commands();
+    finish_state_saves();
 
     if (emu_is_empty())
         return;
@@ -237,16 +456,16 @@ void emu_update(void)
     int sampleCount = 0;
     bool frame_executed = false;
     bool frame_completed = false;
+    bool frame_dirty = false;
 
     if (rewind_is_active())
     {
+        movie_invalidate();
+
         int to_pop = get_rewind_pop_budget();
 
-        for (int i = 0; i < to_pop; i++)
-        {
-            if (!rewind_pop())
-                break;
-        }
+        if (to_pop > 0)
+            rewind_pop(to_pop);
 
         int silence_count = GS_AUDIO_QUEUE_SIZE;
         memset(audio_buffer, 0, silence_count * sizeof(s16));
@@ -271,8 +490,10 @@ void emu_update(void)
         {
             Debug_Command debug_command = emu_debug_command;
             rewind_commit_seek();
+            movie_invalidate();
             breakpoint_hit = gearsystem->RunToVBlank(emu_frame_buffer, audio_buffer, &sampleCount, &debug_run);
             frame_executed = true;
+            frame_dirty = gearsystem->IsFrameDirty();
 
             if (!breakpoint_hit && (debug_command == Debug_Command_StepFrame || debug_command == Debug_Command_Continue))
                 frame_completed = true;
@@ -326,12 +547,16 @@ void emu_update(void)
         if (!gearsystem->IsPaused())
         {
             rewind_commit_seek();
+            movie_update();
 
             int runahead = runahead_get_frames();
             if (runahead > 0)
-                runahead_run(runahead, emu_frame_buffer, audio_buffer, &sampleCount);
+                frame_dirty = runahead_run(runahead, emu_frame_buffer, audio_buffer, &sampleCount);
             else
+            {
                 gearsystem->RunToVBlank(emu_frame_buffer, audio_buffer, &sampleCount);
+                frame_dirty = gearsystem->IsFrameDirty();
+            }
 
             frame_executed = true;
             frame_completed = true;
@@ -340,6 +565,8 @@ void emu_update(void)
 
     if (frame_executed)
     {
+        if (frame_dirty)
+            emu_frame_generation++;
         if (frame_completed)
             emu_frame_counter++;
         rewind_push();
@@ -397,21 +624,34 @@ static int get_rewind_pop_budget(void)
 
 void emu_key_pressed(GS_Joypads pad, GS_Keys key)
 {
+    if (movie_is_playing())
+        return;
+
     gearsystem->KeyPressed(pad, key);
+    movie_key_pressed(pad, key);
 }
 
 void emu_key_released(GS_Joypads pad, GS_Keys key)
 {
+    if (movie_is_playing())
+        return;
+
     gearsystem->KeyReleased(pad, key);
 }
 
 void emu_set_reset(bool pressed)
 {
+    if (movie_is_playing())
+        return;
+
     gearsystem->SetReset(pressed);
 }
 
 void emu_set_phaser(int x, int y)
 {
+    if (movie_is_playing())
+        return;
+
     gearsystem->SetPhaser(x, y);
 }
 
@@ -432,6 +672,9 @@ void emu_enable_phaser_crosshair(bool enable, int shape, int color)
 
 void emu_set_paddle(float x)
 {
+    if (movie_is_playing())
+        return;
+
     gearsystem->SetPaddle(x);
 }
 
@@ -482,6 +725,8 @@ void emu_reset(Cartridge::ForceConfiguration config)
     gearsystem->ResetROM(&config);
     load_ram();
     rewind_reset();
+    runahead_reset(config);
+    movie_invalidate();
 }
 
 void emu_audio_mute(bool mute)
@@ -498,7 +743,12 @@ void emu_audio_set_master_volume(float volume)
 void emu_audio_reset(void)
 {
     sound_queue_stop();
-    sound_queue_start(GS_AUDIO_SAMPLE_RATE, 2, GS_AUDIO_QUEUE_SIZE, config_audio.buffer_count);
+
+    // Synthesize at the device rate so SDL doesn't have to resample again
+    int sample_rate = sound_queue_get_device_sample_rate();
+    gearsystem->GetAudio()->SetSampleRate(sample_rate > 0 ? sample_rate : GS_AUDIO_SAMPLE_RATE);
+
+    sound_queue_start(gearsystem->GetAudio()->GetSampleRate(), 2, GS_AUDIO_QUEUE_SIZE, config_audio.buffer_count);
 }
 
 void emu_audio_psg_volume(float volume)
@@ -536,44 +786,117 @@ void emu_load_ram(const char* file_path, Cartridge::ForceConfiguration config)
         gearsystem->ResetROM(&config);
         gearsystem->LoadRam(file_path, true);
         rewind_reset();
+        runahead_reset(config);
+        movie_invalidate();
     }
 }
 
-void emu_save_state_slot(int index)
+u32 emu_save_state_slot(int index, bool wait)
 {
-    if (!emu_is_empty())
-    {
-        const char* dir = get_configurated_dir(config_emulator.savestates_dir_option, config_emulator.savestates_path.c_str());
-        gearsystem->SaveState(dir, index, true);
-        update_savestates_data();
-    }
+    if (emu_is_empty())
+        return 0;
+
+    const char* dir = get_configurated_dir(config_emulator.savestates_dir_option, config_emulator.savestates_path.c_str());
+    return queue_state_save(gearsystem->GetSaveStatePath(dir, index), index, wait);
 }
 
 void emu_load_state_slot(int index)
 {
     if (!emu_is_empty())
     {
+        emu_wait_state_saves();
+
         const char* dir = get_configurated_dir(config_emulator.savestates_dir_option, config_emulator.savestates_path.c_str());
         if (gearsystem->LoadState(dir, index))
         {
+            movie_invalidate();
             events_sync_input();
             rewind_reset();
         }
     }
 }
 
-void emu_save_state_file(const char* file_path)
+u32 emu_save_state_file(const char* file_path, bool wait)
 {
-    if (!emu_is_empty())
-        gearsystem->SaveState(file_path, -1, true);
+    if (emu_is_empty())
+        return 0;
+
+    return queue_state_save(gearsystem->GetSaveStatePath(file_path, -1), -1, wait);
+}
+
+bool emu_wait_state_save(u32 id)
+{
+    std::unique_lock<std::mutex> lock(save_mutex);
+
+    while (true)
+    {
+        for (size_t i = 0; i < save_results.size(); i++)
+        {
+            State_Save_Job* job = save_results[i];
+
+            if (job->id == id)
+            {
+                bool success = job->success;
+                save_results.erase(save_results.begin() + i);
+                delete job;
+                return success;
+            }
+        }
+
+        bool pending = false;
+        for (size_t i = 0; i < save_queue.size(); i++)
+        {
+            if (save_queue[i]->id == id)
+                pending = true;
+        }
+
+        if (!pending)
+            return false;
+
+        save_done_condition.wait(lock);
+    }
+}
+
+void emu_wait_state_saves(void)
+{
+    std::unique_lock<std::mutex> lock(save_mutex);
+
+    while (!save_queue.empty())
+        save_done_condition.wait(lock);
+}
+
+bool emu_get_state_save_result(int* slot, bool* success)
+{
+    std::lock_guard<std::mutex> lock(save_mutex);
+
+    // Saves with a waiter are reported to it instead
+    for (size_t i = 0; i < save_results.size(); i++)
+    {
+        State_Save_Job* job = save_results[i];
+
+        if (job->wait)
+            continue;
+
+        save_results.erase(save_results.begin() + i);
+
+        *slot = job->slot;
+        *success = job->success;
+        delete job;
+        return true;
+    }
+
+    return false;
 }
 
 void emu_load_state_file(const char* file_path)
 {
     if (!emu_is_empty())
     {
+        emu_wait_state_saves();
+
         if (gearsystem->LoadState(file_path))
         {
+            movie_invalidate();
             events_sync_input();
             rewind_reset();
         }
@@ -590,30 +913,49 @@ void update_savestates_data(void)
     for (int i = 0; i < 5; i++)
     {
         emu_savestates[i].rom_name[0] = 0;
-        SafeDeleteArray(emu_savestates_screenshots[i].data);
+        SafeDeleteArray(savestates_screenshots[i].data);
+
+        savestates_screenshots_loaded[i] = false;
 
         const char* dir = get_configurated_dir(config_emulator.savestates_dir_option, config_emulator.savestates_path.c_str());
+        gearsystem->GetSaveStateHeader(i + 1, dir, &emu_savestates[i]);
+    }
+}
 
-        if (!gearsystem->GetSaveStateHeader(i + 1, dir, &emu_savestates[i]))
-            continue;
+// Thumbnails are only decoded when a slot is actually displayed
+GS_SaveState_Screenshot* emu_get_savestate_screenshot(int slot)
+{
+    if (slot < 0 || slot >= 5 || emu_is_empty())
+        return NULL;
+
+    if (!savestates_screenshots_loaded[slot])
+    {
+        savestates_screenshots_loaded[slot] = true;
 
-        if (emu_savestates[i].screenshot_size > 0)
+        if ((emu_savestates[slot].rom_name[0] != 0) && (emu_savestates[slot].screenshot_size > 0))
         {
-            emu_savestates_screenshots[i].data = new u8[emu_savestates[i].screenshot_size];
-            emu_savestates_screenshots[i].size = emu_savestates[i].screenshot_size;
-            gearsystem->GetSaveStateScreenshot(i + 1, dir, &emu_savestates_screenshots[i]);
+            const char* dir = get_configurated_dir(config_emulator.savestates_dir_option, config_emulator.savestates_path.c_str());
+            savestates_screenshots[slot].data = new u8[emu_savestates[slot].screenshot_size];
+            savestates_screenshots[slot].size = emu_savestates[slot].screenshot_size;
+
+            if (!gearsystem->GetSaveStateScreenshot(slot + 1, dir, &savestates_screenshots[slot]))
+                SafeDeleteArray(savestates_screenshots[slot].data);
         }
     }
+
+    return IsValidPointer(savestates_screenshots[slot].data) ? &savestates_screenshots[slot] : NULL;
 }
 
 void emu_add_cheat(const char* cheat)
 {
     gearsystem->SetCheat(cheat);
+    runahead_add_cheat(cheat);
 }
 
 void emu_clear_cheats()
 {
     gearsystem->ClearCheats();
+    runahead_clear_cheats();
 }
 
 void emu_get_runtime(GS_RuntimeInfo& runtime)
@@ -864,6 +1206,11 @@ void emu_video_no_sprite_limit(bool enabled)
     gearsystem->GetVideo()->SetNoSpriteLimit(enabled);
 }
 
+void emu_video_threaded_rendering(bool enabled)
+{
+    gearsystem->GetVideo()->SetThreadedRendering(enabled);
+}
+
 void emu_disable_ym2413(bool disable)
 {
     gearsystem->GetAudio()->DisableYM2413(disable);
@@ -882,7 +1229,7 @@ void emu_save_screenshot(const char* file_path)
     Log("Screenshot saved to %s", file_path);
 }
 
-int emu_get_screenshot_png(unsigned char** out_buffer)
+int emu_get_screenshot_png(unsigned char** out_buffer, int scale, Scaler::Filter filter)
 {
     if (!gearsystem->GetCartridge()->IsReady())
         return 0;
@@ -890,12 +1237,25 @@ int emu_get_screenshot_png(unsigned char** out_buffer)
     GS_RuntimeInfo runtime;
     emu_get_runtime(runtime);
 
-    int stride = runtime.screen_width * 4;
+    Scaler scaler;
+    scaler.SetFilter(filter, scale);
+
+    int factor = scaler.GetFactor();
+    int width = runtime.screen_width * factor;
+    int height = runtime.screen_height * factor;
+    u8* buffer = emu_frame_buffer;
     int len = 0;
 
-    *out_buffer = stbi_write_png_to_mem(emu_frame_buffer, stride, 
-                                         runtime.screen_width, runtime.screen_height, 
-                                         4, &len);
+    if (factor > 1)
+    {
+        buffer = new u8[width * height * 4];
+        scaler.Scale(emu_frame_buffer, buffer, runtime.screen_width, runtime.screen_height, GS_PIXEL_RGBA8888);
+    }
+
+    *out_buffer = stbi_write_png_to_mem(buffer, width * 4, width, height, 4, &len);
+
+    if (buffer != emu_frame_buffer)
+        SafeDeleteArray(buffer);
 
     return len;
 }
@@ -927,7 +1287,7 @@ int emu_get_sprite_png(int sprite_index, unsigned char** out_buffer)
     if (sprite_index < 0 || sprite_index > 63)
         return 0;
 
-    update_debug();
+    update_debug_sprites();
 
     int width, height;
     get_sprite_size(&width, &height);
@@ -1006,9 +1366,13 @@ static void reset_buffers(void)
     for (int i = 0; i < 512 * 512 * 4; i++)
         emu_frame_buffer[i] = 0;
 
+    emu_frame_generation++;
+
     for (int i = 0; i < GS_AUDIO_BUFFER_SIZE; i++)
         audio_buffer[i] = 0;
 
+    invalidate_debug_views();
+
 }
 
 static const char* get_configurated_dir(int location, const char* path)
@@ -1186,37 +1550,147 @@ static void destroy_debug(void)
 
 static void update_debug_background(void)
 {
-    if (gearsystem->GetVideo()->IsSG1000Mode())
-        update_debug_background_buffer_sg1000();
-    else
-        update_debug_background_buffer_smsgg();
-
     Video* video = gearsystem->GetVideo();
-    video->Render32bit(debug_background_buffer, emu_debug_background_buffer, GS_PIXEL_RGBA8888, 256 * 256);
+    u8* regs = video->GetRegisters();
+    bool sg1000 = video->IsSG1000Mode();
+    int key[DEBUG_VIEW_KEY_SIZE] = { sg1000, video->GetTMS9918Mode(), video->IsExtendedMode224(), regs[2], regs[3], regs[4], regs[7], 0 };
+
+    Debug_View_Update update = check_debug_view(Debug_View_Background, key);
+
+    if (update == Debug_View_Update_None)
+        return;
+
+    bool force = (update == Debug_View_Update_Full);
+    u8* vram = video->GetVRAM();
+
+    for (int tile_y = 0; tile_y < 32; tile_y++)
+    {
+        for (int tile_x = 0; tile_x < 32; tile_x++)
+        {
+            bool updated = sg1000 ?
+                    update_debug_background_cell_sg1000(vram, regs, tile_x, tile_y, force) :
+                    update_debug_background_cell_smsgg(vram, regs, tile_x, tile_y, force);
+
+            if (updated)
+                render_debug_rect(debug_background_buffer, emu_debug_background_buffer, 256, tile_x * 8, tile_y * 8, 8, 8);
+        }
+    }
 }
 
 static void update_debug_tiles(void)
 {
-    if (gearsystem->GetVideo()->IsSG1000Mode())
-        update_debug_tile_buffer_sg1000();
-    else
-        update_debug_tile_buffer_smsgg();
-
     Video* video = gearsystem->GetVideo();
-    video->Render32bit(debug_tile_buffer, emu_debug_tile_buffer, GS_PIXEL_RGBA8888, 32 * 32 * 64);
+    u8* regs = video->GetRegisters();
+    bool sg1000 = video->IsSG1000Mode();
+    int key[DEBUG_VIEW_KEY_SIZE] = { sg1000, video->GetTMS9918Mode(), regs[4], emu_debug_tile_palette, 0, 0, 0, 0 };
+
+    Debug_View_Update update = check_debug_view(Debug_View_Tiles, key);
+
+    if (update == Debug_View_Update_None)
+        return;
+
+    bool force = (update == Debug_View_Update_Full);
+    u8* vram = video->GetVRAM();
+    int tile_count = sg1000 ? 32 * 32 : 32 * 16;
+
+    for (int tile = 0; tile < tile_count; tile++)
+    {
+        bool updated = sg1000 ?
+                update_debug_tile_sg1000(vram, regs, tile, force) :
+                update_debug_tile_smsgg(vram, tile, force);
+
+        if (updated)
+            render_debug_rect(debug_tile_buffer, emu_debug_tile_buffer, 256, (tile & 31) * 8, (tile >> 5) * 8, 8, 8);
+    }
 }
 
 static void update_debug_sprites(void)
 {
-    if (gearsystem->GetVideo()->IsSG1000Mode())
-        update_debug_sprite_buffers_sg1000();
-    else
-        update_debug_sprite_buffers_smsgg();
-
     Video* video = gearsystem->GetVideo();
+    u8* regs = video->GetRegisters();
+    bool sg1000 = video->IsSG1000Mode();
+    int key[DEBUG_VIEW_KEY_SIZE] = { sg1000, regs[1], regs[5], regs[6], 0, 0, 0, 0 };
+
+    Debug_View_Update update = check_debug_view(Debug_View_Sprites, key);
+
+    if (update == Debug_View_Update_None)
+        return;
+
+    bool force = (update == Debug_View_Update_Full);
+    u8* vram = video->GetVRAM();
+
     for (int s = 0; s < 64; s++)
     {
-        video->Render32bit(debug_sprite_buffers[s], emu_debug_sprite_buffers[s], GS_PIXEL_RGBA8888, 16 * 16);
+        bool updated = sg1000 ?
+                update_debug_sprite_sg1000(vram, regs, s, force) :
+                update_debug_sprite_smsgg(vram, regs, s, force);
+
+        if (updated)
+            video->Render32bit(debug_sprite_buffers[s], emu_debug_sprite_buffers[s], GS_PIXEL_RGBA8888, 16 * 16);
+    }
+}
+
+static Debug_View_Update check_debug_view(Debug_View view, const int* key)
+{
+    DebugViewCache* cache = &debug_view_caches[view];
+    Video* video = gearsystem->GetVideo();
+    u8* vram = video->GetVRAM();
+
+    u16 palette[32];
+    for (int i = 0; i < 32; i++)
+        palette[i] = video->ColorFromPalette(i);
+
+    bool full = !cache->valid ||
+            (memcmp(cache->key, key, sizeof(cache->key)) != 0) ||
+            (memcmp(cache->palette, palette, sizeof(palette)) != 0);
+
+    bool vram_changed = (memcmp(cache->vram, vram, 0x4000) != 0);
+
+    if (!full && !vram_changed)
+        return Debug_View_Update_None;
+
+    if (!full)
+    {
+        for (int i = 0; i < (0x4000 >> 3); i++)
+            debug_vram_dirty[i] = (memcmp(&cache->vram[i << 3], &vram[i << 3], 8) != 0);
+    }
+
+    memcpy(cache->vram, vram, 0x4000);
+    memcpy(cache->palette, palette, sizeof(palette));
+    memcpy(cache->key, key, sizeof(cache->key));
+    cache->valid = true;
+
+    return full ? Debug_View_Update_Full : Debug_View_Update_Partial;
+}
+
+static void invalidate_debug_views(void)
+{
+    for (int i = 0; i < Debug_View_Count; i++)
+        debug_view_caches[i].valid = false;
+}
+
+static bool is_debug_vram_dirty(int address, int size)
+{
+    int first = address >> 3;
+    int last = (address + size - 1) >> 3;
+
+    for (int i = first; i <= last; i++)
+    {
+        if (debug_vram_dirty[i & 0x7FF])
+            return true;
+    }
+
+    return false;
+}
+
+static void render_debug_rect(u16* src, u8* dst, int stride, int x, int y, int width, int height)
+{
+    Video* video = gearsystem->GetVideo();
+
+    for (int row = y; row < (y + height); row++)
+    {
+        int offset = (row * stride) + x;
+        video->Render32bit(src + offset, dst + (offset * 4), GS_PIXEL_RGBA8888, width);
     }
 }
 
@@ -1249,55 +1723,50 @@ static void debug_step_instruction(void)
     gearsystem->Pause(false);
 }
 
-static void update_debug_background_buffer_smsgg(void)
+static bool update_debug_background_cell_smsgg(u8* vram, u8* regs, int tile_x, int tile_y, bool force)
 {
     Video* video = gearsystem->GetVideo();
-    u8* regs = video->GetRegisters();
-    u8* vram = video->GetVRAM();
 
-    for (int y = 0; y < 256; y++)
+    int name_table_addr = (regs[2] & (video->IsExtendedMode224() ? 0x0C : 0x0E)) << 10;
+    if (video->IsExtendedMode224())
+        name_table_addr |= 0x700;
+    u16 map_addr = name_table_addr + (64 * tile_y) + (tile_x * 2);
+
+    u16 tile_info_lo = vram[map_addr];
+    u16 tile_info_hi = vram[map_addr + 1];
+
+    int tile_number = ((tile_info_hi & 1) << 8) | tile_info_lo;
+
+    if (!force && !is_debug_vram_dirty(map_addr, 2) && !is_debug_vram_dirty(tile_number * 32, 32))
+        return false;
+
+    bool tile_hflip = IsSetBit((u8)tile_info_hi, 1);
+    bool tile_vflip = IsSetBit((u8)tile_info_hi, 2);
+    int tile_palette = IsSetBit((u8)tile_info_hi, 3) ? 16 : 0;
+
+    for (int offset_y = 0; offset_y < 8; offset_y++)
     {
-        int width_y = (y * 256);
-        int tile_y = y / 8;
-        int offset_y = y & 0x7;
+        int width_y = ((tile_y * 8) + offset_y) * 256;
+        int final_offset_y = tile_vflip ? 7 - offset_y : offset_y;
+        int tile_data_addr = (tile_number * 32) + (4 * final_offset_y);
 
-        for (int x = 0; x < 256; x++)
+        for (int x = 0; x < 8; x++)
         {
-            int tile_x = x / 8;
-            int offset_x = x & 0x7;
-            int pixel = width_y + x;
-
-            int name_table_addr = (regs[2] & (video->IsExtendedMode224() ? 0x0C : 0x0E)) << 10;
-            if (video->IsExtendedMode224())
-                name_table_addr |= 0x700;
-            u16 map_addr = name_table_addr + (64 * tile_y) + (tile_x * 2);
-
-            u16 tile_info_lo = vram[map_addr];
-            u16 tile_info_hi = vram[map_addr + 1];
-
-            int tile_number = ((tile_info_hi & 1) << 8) | tile_info_lo;
-            bool tile_hflip = IsSetBit((u8)tile_info_hi, 1);
-            bool tile_vflip = IsSetBit((u8)tile_info_hi, 2);
-            int tile_palette = IsSetBit((u8)tile_info_hi, 3) ? 16 : 0;
-            int final_offset_y = offset_y;
-            if (!tile_hflip)
-                offset_x = 7 - offset_x;
-            if (tile_vflip)
-                final_offset_y = 7 - offset_y;
-
-            int tile_data_addr = (tile_number * 32) + (4 * final_offset_y);
+            int offset_x = tile_hflip ? x : 7 - x;
+            int pixel = width_y + (tile_x * 8) + x;
+
             int color_index = ((vram[tile_data_addr] >> offset_x) & 1) | (((vram[tile_data_addr + 1] >> offset_x) & 1) << 1) | (((vram[tile_data_addr + 2] >> offset_x) & 1) << 2) | (((vram[tile_data_addr + 3] >> offset_x) & 1) << 3);
 
             debug_background_buffer[pixel] = video->ColorFromPalette(color_index + tile_palette);
         }
     }
+
+    return true;
 }
 
-static void update_debug_background_buffer_sg1000(void)
+static bool update_debug_background_cell_sg1000(u8* vram, u8* regs, int tile_x, int tile_y, bool force)
 {
     Video* video = gearsystem->GetVideo();
-    u8* vram = video->GetVRAM();
-    u8* regs = video->GetRegisters();
     int mode = video->GetTMS9918Mode();
 
     int pattern_table_addr = 0;
@@ -1317,191 +1786,177 @@ static void update_debug_background_buffer_sg1000(void)
         color_table_addr = regs[3] << 6;
     }
 
-    for (int y = 0; y < 256; y++)
-    {
-        int width_y = (y * 256);
-        int tile_y = y / 8;
-        int offset_y = y & 0x7;
-
-        for (int x = 0; x < 256; x++)
-        {
-            int tile_x = x / 8;
-            int offset_x = 7 - (x & 0x7);
-            int pixel = width_y + x;
-
-            int tile_number = (tile_y * 32) + tile_x;
-
-            int name_tile_addr = name_table_addr + tile_number;
+    int tile_number = (tile_y * 32) + tile_x;
+    int name_tile_addr = name_table_addr + tile_number;
+    int name_tile = 0;
 
-            int name_tile = 0;
+    if (mode == 2)
+        name_tile = vram[name_tile_addr] | (region & 0x300 & tile_number);
+    else
+        name_tile = vram[name_tile_addr];
 
-            if (mode == 2)
-                name_tile = vram[name_tile_addr] | (region & 0x300 & tile_number);
-            else
-                name_tile = vram[name_tile_addr];
+    int pattern_addr = pattern_table_addr + (name_tile << 3);
+    int color_addr = (mode == 2) ? color_table_addr + (name_tile << 3) : color_table_addr + (name_tile >> 3);
 
-            u8 pattern_line = vram[pattern_table_addr + (name_tile << 3) + offset_y];
+    if (!force && !is_debug_vram_dirty(name_tile_addr, 1) && !is_debug_vram_dirty(pattern_addr, 8) && !is_debug_vram_dirty(color_addr, (mode == 2) ? 8 : 1))
+        return false;
 
-            u8 color_line = 0;
+    for (int offset_y = 0; offset_y < 8; offset_y++)
+    {
+        int width_y = ((tile_y * 8) + offset_y) * 256;
+        u8 pattern_line = vram[pattern_addr + offset_y];
+        u8 color_line = (mode == 2) ? vram[color_addr + offset_y] : vram[color_addr];
 
-            if (mode == 2)
-                color_line = vram[color_table_addr + (name_tile << 3) + offset_y];
-            else
-                color_line = vram[color_table_addr + (name_tile >> 3)];
+        int bg_color = color_line & 0x0F;
+        int fg_color = color_line >> 4;
 
-            int bg_color = color_line & 0x0F;
-            int fg_color = color_line >> 4;
-            int final_color = IsSetBit(pattern_line, offset_x) ? fg_color : bg_color;
+        for (int x = 0; x < 8; x++)
+        {
+            int pixel = width_y + (tile_x * 8) + x;
+            int final_color = IsSetBit(pattern_line, 7 - x) ? fg_color : bg_color;
 
             debug_background_buffer[pixel] = (final_color > 0) ? final_color : backdrop_color;
         }
     }
+
+    return true;
 }
 
-static void update_debug_tile_buffer_smsgg(void)
+static bool update_debug_tile_smsgg(u8* vram, int tile_number, bool force)
 {
+    int tile_data_addr = tile_number * 32;
+
+    if (!force && !is_debug_vram_dirty(tile_data_addr, 32))
+        return false;
+
     Video* video = gearsystem->GetVideo();
-    u8* vram = video->GetVRAM();
+    int tile_palette = emu_debug_tile_palette * 16;
+    int tile_x = tile_number & 31;
+    int tile_y = tile_number >> 5;
 
-    for (int y = 0; y < 128; y++)
+    for (int offset_y = 0; offset_y < 8; offset_y++)
     {
-        int width_y = (y * 256);
-        int tile_y = y / 8;
-        int offset_y = y & 0x7;
+        int width_y = ((tile_y * 8) + offset_y) * 256;
+        int line_addr = tile_data_addr + (4 * offset_y);
 
-        for (int x = 0; x < 256; x++)
+        for (int x = 0; x < 8; x++)
         {
-            int tile_x = x / 8;
-            int offset_x = 7 - (x & 0x7);
-            int pixel = width_y + x;
+            int offset_x = 7 - x;
+            int pixel = width_y + (tile_x * 8) + x;
 
-            int tile_number = (tile_y * 32) + tile_x;
-            int tile_palette = emu_debug_tile_palette * 16;
-
-            int tile_data_addr = (tile_number * 32) + (4 * offset_y);
-            int color_index = ((vram[tile_data_addr] >> offset_x) & 1) | (((vram[tile_data_addr + 1] >> offset_x) & 1) << 1) | (((vram[tile_data_addr + 2] >> offset_x) & 1) << 2) | (((vram[tile_data_addr + 3] >> offset_x) & 1) << 3);
+            int color_index = ((vram[line_addr] >> offset_x) & 1) | (((vram[line_addr + 1] >> offset_x) & 1) << 1) | (((vram[line_addr + 2] >> offset_x) & 1) << 2) | (((vram[line_addr + 3] >> offset_x) & 1) << 3);
 
             debug_tile_buffer[pixel] = video->ColorFromPalette(color_index + tile_palette);
         }
     }
+
+    return true;
 }
 
-static void update_debug_tile_buffer_sg1000(void)
+static bool update_debug_tile_sg1000(u8* vram, u8* regs, int tile_number, bool force)
 {
-    Video* video = gearsystem->GetVideo();
-    u8* vram = video->GetVRAM();
-    u8* regs = video->GetRegisters();
-    int mode = video->GetTMS9918Mode();
-
+    int mode = gearsystem->GetVideo()->GetTMS9918Mode();
     int pattern_table_addr = (regs[4] & ((mode == 2) ? 0x04 : 0x07)) << 11;
-    
-    for (int y = 0; y < 256; y++)
-    {
-        int width_y = (y * 256);
-        int tile_y = y / 8;
-        int offset_y = y & 0x7;
-
-        for (int x = 0; x < 256; x++)
-        {
-            int tile_x = x / 8;
-            int offset_x = 7 - (x & 0x7);
-            int pixel = width_y + x;
+    int tile_data_addr = (pattern_table_addr + (tile_number * 8)) & 0x3FFF;
 
-            int tile_number = (tile_y * 32) + tile_x;
+    if (!force && !is_debug_vram_dirty(tile_data_addr, 8))
+        return false;
 
-            int tile_data_addr = pattern_table_addr + (tile_number * 8) + (1 * offset_y);
-            bool color = IsSetBit(vram[tile_data_addr], offset_x);
+    int tile_x = tile_number & 31;
+    int tile_y = tile_number >> 5;
 
-            u16 black = 0;
+    u16 black = 0;
+    u16 white = 15;
 
-            u16 white = 15;
+    for (int offset_y = 0; offset_y < 8; offset_y++)
+    {
+        int width_y = ((tile_y * 8) + offset_y) * 256;
+        u8 pattern_line = vram[tile_data_addr + offset_y];
 
-            debug_tile_buffer[pixel] = color ? white : black;
+        for (int x = 0; x < 8; x++)
+        {
+            int pixel = width_y + (tile_x * 8) + x;
+            debug_tile_buffer[pixel] = IsSetBit(pattern_line, 7 - x) ? white : black;
         }
     }
+
+    return true;
 }
 
-static void update_debug_sprite_buffers_smsgg(void)
+static bool update_debug_sprite_smsgg(u8* vram, u8* regs, int sprite, bool force)
 {
-    GearsystemCore* core = emu_get_core();
-    Video* video = core->GetVideo();
-    u8* regs = video->GetRegisters();
-    u8* vram = video->GetVRAM();
-    GS_RuntimeInfo runtime;
-    emu_get_runtime(runtime);
+    Video* video = gearsystem->GetVideo();
 
     bool sprites_16 = IsSetBit(regs[1], 1);
     u16 sprite_table_address = (regs[5] << 7) & 0x3F00;
     u16 sprite_table_address_2 = sprite_table_address + 0x80;
     u16 sprite_tiles_address = (regs[6] << 11) & 0x2000;
 
-    for (int s = 0; s < 64; s++)
-    {
-        u16 sprite_info_address = sprite_table_address_2 + (s << 1);
-        int tile = vram[sprite_info_address + 1];
-        tile &= sprites_16 ? 0xFE : 0xFF;
-        int tile_addr = sprite_tiles_address + (tile << 5);
+    u16 sprite_info_address = sprite_table_address_2 + (sprite << 1);
+    int tile = vram[sprite_info_address + 1];
+    tile &= sprites_16 ? 0xFE : 0xFF;
+    int tile_addr = sprite_tiles_address + (tile << 5);
 
-        int padding = 0;
-        for (int pixel = 0; pixel < (8 * 16); pixel++)
-        {
-            if ((pixel != 0) && (pixel % 8 == 0))
-                padding += 8;
+    if (!force && !is_debug_vram_dirty(sprite_info_address + 1, 1) && !is_debug_vram_dirty(tile_addr, 64))
+        return false;
+
+    int padding = 0;
+    for (int pixel = 0; pixel < (8 * 16); pixel++)
+    {
+        if ((pixel != 0) && (pixel % 8 == 0))
+            padding += 8;
 
-            int pixel_x = 7 - (pixel & 0x7);
-            int pixel_y = pixel / 8;
+        int pixel_x = 7 - (pixel & 0x7);
+        int pixel_y = pixel / 8;
 
-            u16 line_addr = tile_addr + (4 * pixel_y);
+        u16 line_addr = (tile_addr + (4 * pixel_y)) & 0x3FFF;
 
-            int color_index = ((vram[line_addr] >> pixel_x) & 1) | (((vram[line_addr + 1] >> pixel_x) & 1) << 1) | (((vram[line_addr + 2] >> pixel_x) & 1) << 2) | (((vram[line_addr + 3] >> pixel_x) & 1) << 3);
+        int color_index = ((vram[line_addr] >> pixel_x) & 1) | (((vram[line_addr + 1] >> pixel_x) & 1) << 1) | (((vram[line_addr + 2] >> pixel_x) & 1) << 2) | (((vram[line_addr + 3] >> pixel_x) & 1) << 3);
 
-            debug_sprite_buffers[s][pixel + padding] = video->ColorFromPalette(color_index + 16);
-        }
+        debug_sprite_buffers[sprite][pixel + padding] = video->ColorFromPalette(color_index + 16);
     }
+
+    return true;
 }
 
-static void update_debug_sprite_buffers_sg1000(void)
+static bool update_debug_sprite_sg1000(u8* vram, u8* regs, int sprite, bool force)
 {
-    GearsystemCore* core = emu_get_core();
-    Video* video = core->GetVideo();
-    u8* regs = video->GetRegisters();
-    u8* vram = video->GetVRAM();
-    GS_RuntimeInfo runtime;
-    emu_get_runtime(runtime);
-
     int sprite_size = IsSetBit(regs[1], 1) ? 16 : 8;
     u16 sprite_attribute_addr = (regs[5] & 0x7F) << 7;
     u16 sprite_pattern_addr = (regs[6] & 0x07) << 11;
 
-    for (int s = 0; s < 64; s++)
+    int sprite_attribute_offset = sprite_attribute_addr + (sprite << 2);
+    int sprite_color = vram[sprite_attribute_offset + 3] & 0x0F;
+    int sprite_tile = vram[sprite_attribute_offset + 2];
+    sprite_tile &= (sprite_size == 16) ? 0xFC : 0xFF;
+    int sprite_tile_addr = sprite_pattern_addr + (sprite_tile << 3);
+
+    if (!force && !is_debug_vram_dirty(sprite_attribute_offset + 2, 2) && !is_debug_vram_dirty(sprite_tile_addr, 32))
+        return false;
+
+    for (int pixel_y = 0; pixel_y < sprite_size; pixel_y++)
     {
-        int sprite_attribute_offset = sprite_attribute_addr + (s << 2);
-        int sprite_color = vram[sprite_attribute_offset + 3] & 0x0F;
-        int sprite_tile = vram[sprite_attribute_offset + 2];
-        sprite_tile &= (sprite_size == 16) ? 0xFC : 0xFF;
+        int sprite_line_addr = sprite_tile_addr + pixel_y;
 
-        for (int pixel_y = 0; pixel_y < sprite_size; pixel_y++)
+        for (int pixel_x = 0; pixel_x < 16; pixel_x++)
         {
-            int sprite_line_addr = sprite_pattern_addr + (sprite_tile << 3) + pixel_y;
-
-            for (int pixel_x = 0; pixel_x < 16; pixel_x++)
-            {
-                if ((sprite_size == 8) && (pixel_x == 8))
-                    break;
+            if ((sprite_size == 8) && (pixel_x == 8))
+                break;
 
-                int pixel = (pixel_y * 16) + pixel_x;
+            int pixel = (pixel_y * 16) + pixel_x;
 
-                bool sprite_pixel = false;
+            bool sprite_pixel = false;
 
-                if (pixel_x < 8)
-                    sprite_pixel = IsSetBit(vram[sprite_line_addr], 7 - pixel_x);
-                else
-                    sprite_pixel = IsSetBit(vram[sprite_line_addr + 16], 15 - pixel_x);
+            if (pixel_x < 8)
+                sprite_pixel = IsSetBit(vram[sprite_line_addr & 0x3FFF], 7 - pixel_x);
+            else
+                sprite_pixel = IsSetBit(vram[(sprite_line_addr + 16) & 0x3FFF], 15 - pixel_x);
 
-                debug_sprite_buffers[s][pixel] = sprite_pixel ? sprite_color : 0;
-            }
+            debug_sprite_buffers[sprite][pixel] = sprite_pixel ? sprite_color : 0;
         }
     }
+
+    return true;
 }
 
 void emu_start_vgm_recording(const char* file_path)
@@ -1554,6 +2009,56 @@ bool emu_is_vgm_recording(void)
     return gearsystem->GetAudio()->IsVgmRecording();
 }
 
+bool emu_start_audio_recording(const char* file_path)
+{
+    if (emu_is_audio_recording())
+        emu_stop_audio_recording();
+
+    // Finishing the load resets the output sample rate, which would close
+    // the file, so wait until the new media is running
+    if (loading_state.load() != Loading_State_None)
+    {
+        strncpy_fit(audio_recording_pending_path, file_path, sizeof(audio_recording_pending_path));
+        Log("Audio recording will start once media is loaded: %s", file_path);
+        return true;
+    }
+
+    if (!gearsystem->GetAudio()->StartAudioRecording(file_path))
+        return false;
+
+    Log("Audio recording started: %s", file_path);
+    return true;
+}
+
+void emu_stop_audio_recording(void)
+{
+    audio_recording_pending_path[0] = 0;
+
+    if (gearsystem->GetAudio()->IsAudioRecording())
+    {
+        gearsystem->GetAudio()->StopAudioRecording();
+        Log("Audio recording stopped");
+    }
+}
+
+bool emu_is_audio_recording(void)
+{
+    return (audio_recording_pending_path[0] != 0) || gearsystem->GetAudio()->IsAudioRecording();
+}
+
+static void start_pending_audio_recording(void)
+{
+    if (audio_recording_pending_path[0] == 0)
+        return;
+
+    char file_path[4096];
+    strncpy_fit(file_path, audio_recording_pending_path, sizeof(file_path));
+    audio_recording_pending_path[0] = 0;
+
+    if (!emu_start_audio_recording(file_path))
+        Error("Unable to start audio recording: %s", file_path);
+}
+
 void emu_mcp_set_transport(int mode, int tcp_port, const char* tcp_address)
 {
     if (mcp_manager)
@@ -44,8 +44,8 @@ enum Directory_Location
 };
 
 EXTERN u8* emu_frame_buffer;
+EXTERN u32 emu_frame_generation;
 EXTERN GS_SaveState_Header emu_savestates[5];
-EXTERN GS_SaveState_Screenshot emu_savestates_screenshots[5];
 EXTERN u32 emu_savestates_generation;
 EXTERN u8* emu_debug_sprite_buffers[64];
 EXTERN u8* emu_debug_background_buffer;
@@ -91,11 +91,15 @@ EXTERN bool emu_is_audio_enabled(void);
 EXTERN bool emu_is_audio_open(void);
 EXTERN void emu_save_ram(const char* file_path);
 EXTERN void emu_load_ram(const char* file_path, Cartridge::ForceConfiguration config);
-EXTERN void emu_save_state_slot(int index);
+EXTERN u32 emu_save_state_slot(int index, bool wait);
 EXTERN void emu_load_state_slot(int index);
-EXTERN void emu_save_state_file(const char* file_path);
+EXTERN u32 emu_save_state_file(const char* file_path, bool wait);
 EXTERN void emu_load_state_file(const char* file_path);
+EXTERN bool emu_wait_state_save(u32 id);
+EXTERN void emu_wait_state_saves(void);
+EXTERN bool emu_get_state_save_result(int* slot, bool* success);
 EXTERN void update_savestates_data(void);
+EXTERN GS_SaveState_Screenshot* emu_get_savestate_screenshot(int slot);
 EXTERN void emu_add_cheat(const char* cheat);
 EXTERN void emu_clear_cheats();
 EXTERN void emu_get_runtime(GS_RuntimeInfo& runtime);
@@ -119,9 +123,10 @@ EXTERN void emu_set_3d_glasses_config(int config);
 EXTERN void emu_set_overscan(int overscan);
 EXTERN void emu_set_hide_left_bar(int hide_left_bar);
 EXTERN void emu_video_no_sprite_limit(bool enabled);
+EXTERN void emu_video_threaded_rendering(bool enabled);
 EXTERN void emu_disable_ym2413(bool disable);
 EXTERN void emu_save_screenshot(const char* file_path);
-EXTERN int emu_get_screenshot_png(unsigned char** out_buffer);
+EXTERN int emu_get_screenshot_png(unsigned char** out_buffer, int scale = 1, Scaler::Filter filter = Scaler::FilterNearest);
 EXTERN int emu_get_sprite_png(int sprite_index, unsigned char** out_buffer);
 EXTERN void emu_save_sprite(const char* file_path, int index);
 EXTERN void emu_save_background(const char* file_path);
@@ -129,6 +134,9 @@ EXTERN void emu_save_tiles(const char* file_path);
 EXTERN void emu_start_vgm_recording(const char* file_path);
 EXTERN void emu_stop_vgm_recording(void);
 EXTERN bool emu_is_vgm_recording(void);
+EXTERN bool emu_start_audio_recording(const char* file_path);
+EXTERN void emu_stop_audio_recording(void);
+EXTERN bool emu_is_audio_recording(void);
 EXTERN void emu_mcp_set_transport(int mode, int tcp_port, const char* tcp_address);
 EXTERN void emu_mcp_start(void);
 EXTERN void emu_mcp_stop(void);
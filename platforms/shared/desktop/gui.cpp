@@ -56,6 +56,7 @@ static void main_window(void);
 static void show_status_message(void);
 static void show_error_window(void);
 static void show_loading_popup(void);
+static void show_state_save_results(void);
 static bool finish_loading_rom(void);
 static void update_window_visibility_padding(void);
 static Cartridge::CartridgeTypes get_mapper(int index);
@@ -133,6 +134,7 @@ bool gui_init(void)
     emu_set_overscan(config_debug.debug ? 0 : config_video.overscan);
     emu_set_hide_left_bar(config_video.hide_left_bar);
     emu_video_no_sprite_limit(config_video.sprite_limit);
+    emu_video_threaded_rendering(config_video.threaded_rendering);
     emu_set_disassembler_syntax(config_debug.dis_syntax);
     emu_disable_ym2413(config_audio.ym2413 == 1);
     emu_enable_phaser(config_emulator.light_phaser);
@@ -183,6 +185,7 @@ void gui_render(void)
         gui_show_info();
 
     show_loading_popup();
+    show_state_save_results();
     show_status_message();
     show_error_window();
 
@@ -218,7 +221,7 @@ void gui_shortcut(gui_ShortCutEvent event)
         std::string message("Saving state to slot ");
         message += std::to_string(config_emulator.save_slot + 1);
         gui_set_status_message(message.c_str(), 3000);
-        emu_save_state_slot(config_emulator.save_slot + 1);
+        emu_save_state_slot(config_emulator.save_slot + 1, false);
         break;
     }
     case gui_ShortcutLoadState:
@@ -639,6 +642,29 @@ static void show_status_message(void)
     }
 }
 
+static void show_state_save_results(void)
+{
+    int slot = 0;
+    bool success = false;
+
+    while (emu_get_state_save_result(&slot, &success))
+    {
+        if (!success)
+        {
+            gui_set_error_message("Failed to save state");
+            continue;
+        }
+
+        std::string message("State saved");
+        if (slot > 0)
+        {
+            message += " to slot ";
+            message += std::to_string(slot);
+        }
+        gui_set_status_message(message.c_str(), 3000);
+    }
+}
+
 static void show_loading_popup(void)
 {
     if (!loading_rom_active)
@@ -715,6 +741,8 @@ static bool finish_loading_rom(void)
         {
             emu_frame_buffer[i] = 0;
         }
+
+        emu_frame_generation++;
     }
 
     if (!emu_is_empty())
@@ -48,6 +48,8 @@ void gui_action_reset(void)
         {
             emu_frame_buffer[i] = 0;
         }
+
+        emu_frame_generation++;
     }
 }
 
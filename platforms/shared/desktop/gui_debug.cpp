@@ -77,7 +77,15 @@ void gui_debug_update(void)
 void gui_debug_windows(void)
 {
     gui_debug_update();
-    emu_get_core()->GetAudio()->EnablePSGDebug(config_debug.debug && config_debug.show_psg);
+
+    // Only follow the window state on changes so MCP can also request capture
+    static bool psg_debug = false;
+    bool show_psg = config_debug.debug && config_debug.show_psg;
+    if (show_psg != psg_debug)
+    {
+        emu_get_core()->GetAudio()->EnablePSGDebug(show_psg);
+        psg_debug = show_psg;
+    }
 
     if (config_debug.debug)
     {
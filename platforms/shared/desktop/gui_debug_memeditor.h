@@ -106,6 +106,7 @@ public:
     int PerformSearch(int op, int compare_type, int compare_value, int data_type);
     std::vector<Search>* GetSearchResults();
     int FindBytesSequence(const char* hex_str, int* out_addresses, int max_results);
+    bool CheckDataWritten();
 
 private:
     bool IsColumnSeparator(int current_column, int column_count);
@@ -152,6 +153,7 @@ private:
     int m_jump_to_address;
     int m_scroll_to_address;
     uint8_t* m_mem_data;
+    bool m_mem_data_written;
     int m_mem_size;
     int m_mem_base_addr;
     char m_hex_addr_format[16];
@@ -38,6 +38,7 @@ static const int DEBUG_MEMORY_MAX_SETTINGS_RECORDS = 0x10000;
 static void memory_editor_menu(void);
 static void draw_tabs(void);
 static void draw_single_tab(int i);
+static void check_video_writes(void);
 static bool memory_settings_read_data(std::istream& stream, void* data, size_t size);
 static bool memory_settings_read_count(std::istream& stream, int& count, size_t record_size);
 static bool memory_settings_read_editor(std::istream& stream, std::vector<MemEditor::Bookmark>& bookmarks,
@@ -174,6 +175,8 @@ void gui_debug_window_memory(void)
 
     ImGui::End();
     ImGui::PopStyleVar();
+
+    check_video_writes();
 }
 
 void gui_debug_memory_search_window(void)
@@ -204,6 +207,8 @@ void gui_debug_memory_watches_window(void)
         mem_edit[i].DrawWatchWindow();
         ImGui::PopFont();
     }
+
+    check_video_writes();
 }
 
 void gui_debug_memory_step_frame(void)
@@ -222,6 +227,7 @@ void gui_debug_memory_copy(void)
 void gui_debug_memory_paste(void)
 {
     mem_edit[current_mem_edit].Paste();
+    check_video_writes();
 }
 
 void gui_debug_memory_select_all(void)
@@ -246,6 +252,17 @@ void gui_debug_memory_save_dump(const char* file_path, bool binary)
 void gui_debug_memory_load_dump(const char* file_path)
 {
     mem_edit[current_mem_edit].LoadFromBinaryFile(file_path);
+    check_video_writes();
+}
+
+static void check_video_writes(void)
+{
+    bool vram = mem_edit[MEMORY_EDITOR_VRAM].CheckDataWritten();
+    bool cram = mem_edit[MEMORY_EDITOR_CRAM].CheckDataWritten();
+
+    // The editors write straight into VDP memory, behind the renderer caches
+    if (vram || cram)
+        emu_get_core()->GetVideo()->InvalidateVRAMCaches();
 }
 
 static void draw_tabs(void)
@@ -490,6 +507,7 @@ void gui_debug_memory_set_selection_value(int editor, u8 value)
         return;
 
     mem_edit[editor].SetValueToSelection(value);
+    check_video_writes();
 }
 
 void gui_debug_memory_add_bookmark(int editor, int address, const char* name)
@@ -27,6 +27,7 @@
 #include "config.h"
 #include "emu.h"
 #include "rewind.h"
+#include "movie.h"
 
 static int seek_position = 0;
 static bool scrubbing = false;
@@ -177,6 +178,7 @@ bool gui_debug_rewind_seek(int age)
     if (!rewind_seek(age))
         return false;
 
+    movie_invalidate();
     seek_position = age;
     scrubbing = true;
     return true;
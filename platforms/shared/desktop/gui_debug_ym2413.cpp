@@ -86,7 +86,7 @@ void gui_debug_window_ym2413(void)
     ImGui::Begin("YM2413 FM", &config_debug.show_ym2413);
 
     GearsystemCore* core = emu_get_core();
-    YM2413_OPLL* opll = (YM2413_OPLL*)YM2413GetContextPtr();
+    YM2413_OPLL* opll = core->GetAudio()->GetYM2413()->GetChip();
 
     bool rhythm_mode = (opll->rhythm & 0x20) != 0;
 
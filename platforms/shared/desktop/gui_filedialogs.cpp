@@ -33,6 +33,7 @@
 #include "application.h"
 #include "config.h"
 #include "emu.h"
+#include "movie.h"
 #include "utils.h"
 
 enum FileDialogID
@@ -43,6 +44,8 @@ enum FileDialogID
     FileDialog_SaveRAM,
     FileDialog_LoadState,
     FileDialog_SaveState,
+    FileDialog_RecordMovie,
+    FileDialog_PlayMovie,
     FileDialog_ChooseSavestatePath,
     FileDialog_ChooseScreenshotPath,
     FileDialog_ChooseTracePath,
@@ -50,6 +53,7 @@ enum FileDialogID
     FileDialog_LoadSymbols,
     FileDialog_SaveScreenshot,
     FileDialog_SaveVGM,
+    FileDialog_SaveWAV,
     FileDialog_SaveSprite,
     FileDialog_SaveAllSprites,
     FileDialog_SaveBackground,
@@ -145,6 +149,26 @@ void gui_file_dialog_save_state(void)
     SDL_ShowSaveFileDialog(file_dialog_callback, (void*)(intptr_t)FileDialog_SaveState, application_sdl_window, filters, 1, default_path);
 }
 
+void gui_file_dialog_record_movie(void)
+{
+    if (!begin_dialog())
+        return;
+
+    SDL_DialogFileFilter filters[] = { { "Movie Files", "gsm" } };
+    const char* default_path = config_emulator.last_open_path.empty() ? NULL : config_emulator.last_open_path.c_str();
+    SDL_ShowSaveFileDialog(file_dialog_callback, (void*)(intptr_t)FileDialog_RecordMovie, application_sdl_window, filters, 1, default_path);
+}
+
+void gui_file_dialog_play_movie(void)
+{
+    if (!begin_dialog())
+        return;
+
+    SDL_DialogFileFilter filters[] = { { "Movie Files", "gsm" } };
+    const char* default_path = config_emulator.last_open_path.empty() ? NULL : config_emulator.last_open_path.c_str();
+    SDL_ShowOpenFileDialog(file_dialog_callback, (void*)(intptr_t)FileDialog_PlayMovie, application_sdl_window, filters, 1, default_path, false);
+}
+
 void gui_file_dialog_choose_savestate_path(void)
 {
     if (!begin_dialog())
@@ -199,6 +223,15 @@ void gui_file_dialog_save_vgm(void)
     SDL_ShowSaveFileDialog(file_dialog_callback, (void*)(intptr_t)FileDialog_SaveVGM, application_sdl_window, filters, 1, NULL);
 }
 
+void gui_file_dialog_save_wav(void)
+{
+    if (!begin_dialog())
+        return;
+
+    SDL_DialogFileFilter filters[] = { { "WAV Files", "wav" } };
+    SDL_ShowSaveFileDialog(file_dialog_callback, (void*)(intptr_t)FileDialog_SaveWAV, application_sdl_window, filters, 1, NULL);
+}
+
 void gui_file_dialog_save_sprite(int index)
 {
     if (!begin_dialog())
@@ -406,7 +439,23 @@ static void process_dialog_result(FileDialogID id, const char* path)
             std::string message("Saving state to ");
             message += path;
             gui_set_status_message(message.c_str(), 3000);
-            emu_save_state_file(path);
+            emu_save_state_file(path, false);
+            break;
+        }
+        case FileDialog_RecordMovie:
+        {
+            if (movie_record(path))
+                gui_set_status_message("Movie recording started", 3000);
+            else
+                gui_set_status_message("Failed to start movie recording", 3000);
+            break;
+        }
+        case FileDialog_PlayMovie:
+        {
+            if (movie_play(path))
+                gui_set_status_message("Movie playback started", 3000);
+            else
+                gui_set_status_message("Failed to play movie", 3000);
             break;
         }
         case FileDialog_ChooseSavestatePath:
@@ -444,6 +493,14 @@ static void process_dialog_result(FileDialogID id, const char* path)
             gui_set_status_message("VGM recording started", 3000);
             break;
         }
+        case FileDialog_SaveWAV:
+        {
+            if (emu_start_audio_recording(path))
+                gui_set_status_message("Audio recording started", 3000);
+            else
+                gui_set_status_message("Failed to start audio recording", 3000);
+            break;
+        }
         case FileDialog_SaveSprite:
         {
             gui_action_save_sprite(path, pending_dialog_int_param1);
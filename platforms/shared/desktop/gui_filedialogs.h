@@ -31,12 +31,15 @@ EXTERN void gui_file_dialog_load_ram(void);
 EXTERN void gui_file_dialog_save_ram(void);
 EXTERN void gui_file_dialog_load_state(void);
 EXTERN void gui_file_dialog_save_state(void);
+EXTERN void gui_file_dialog_record_movie(void);
+EXTERN void gui_file_dialog_play_movie(void);
 EXTERN void gui_file_dialog_choose_savestate_path(void);
 EXTERN void gui_file_dialog_choose_screenshot_path(void);
 EXTERN void gui_file_dialog_choose_trace_path(void);
 EXTERN void gui_file_dialog_load_symbols(void);
 EXTERN void gui_file_dialog_save_screenshot(void);
 EXTERN void gui_file_dialog_save_vgm(void);
+EXTERN void gui_file_dialog_save_wav(void);
 EXTERN void gui_file_dialog_save_sprite(int index);
 EXTERN void gui_file_dialog_save_all_sprites(void);
 EXTERN void gui_file_dialog_save_background(void);
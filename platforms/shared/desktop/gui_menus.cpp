@@ -27,6 +27,7 @@
 #include "gui_debug_memory.h"
 #include "config.h"
 #include "rewind.h"
+#include "movie.h"
 #include "application.h"
 #include "display.h"
 #include "gamepad.h"
@@ -42,10 +43,14 @@ static bool open_ram = false;
 static bool save_ram = false;
 static bool open_state = false;
 static bool save_state = false;
+static bool record_movie = false;
+static bool play_movie = false;
+static int movie_seek_frame = 0;
 static bool open_about = false;
 static bool open_load_defaults = false;
 static bool save_screenshot = false;
 static bool save_vgm = false;
+static bool save_wav = false;
 static bool choose_savestates_path = false;
 static bool choose_screenshots_path = false;
 static bool choose_backup_ram_path = false;
@@ -90,10 +95,13 @@ void gui_main_menu(void)
     save_ram = false;
     open_state = false;
     save_state = false;
+    record_movie = false;
+    play_movie = false;
     open_about = false;
     open_load_defaults = false;
     save_screenshot = false;
     save_vgm = false;
+    save_wav = false;
     choose_savestates_path = false;
     choose_screenshots_path = false;
     gui_main_menu_hovered = false;
@@ -209,6 +217,16 @@ static void menu_gearsystem(void)
                 ImGui::EndTooltip();
             }
 
+            ImGui::MenuItem("Second Instance", "", &config_emulator.runahead_second_instance);
+
+            if (ImGui::IsItemHovered())
+            {
+                ImGui::BeginTooltip();
+                ImGui::Text("Runs the speculative frames on a second emulator instance.");
+                ImGui::Text("The main instance is never rolled back, at the cost of extra memory.");
+                ImGui::EndTooltip();
+            }
+
             ImGui::EndMenu();
         }
 
@@ -257,7 +275,7 @@ static void menu_gearsystem(void)
             std::string message("Saving state to slot ");
             message += std::to_string(config_emulator.save_slot + 1);
             gui_set_status_message(message.c_str(), 3000);
-            emu_save_state_slot(config_emulator.save_slot + 1);
+            emu_save_state_slot(config_emulator.save_slot + 1, false);
         }
 
         if (ImGui::MenuItem("Load State", config_hotkeys[config_HotkeyIndex_LoadState].str, false, media_actions_enabled))
@@ -278,6 +296,49 @@ static void menu_gearsystem(void)
 
         ImGui::Separator();
 
+        bool movie_active = movie_is_recording() || movie_is_playing();
+
+        if (ImGui::MenuItem("Record Movie...", "", false, media_actions_enabled && !movie_active))
+        {
+            record_movie = true;
+        }
+
+        if (ImGui::MenuItem("Play Movie...", "", false, media_actions_enabled && !movie_active))
+        {
+            play_movie = true;
+        }
+
+        if (ImGui::MenuItem("Stop Movie", "", false, movie_active))
+        {
+            movie_stop();
+            gui_set_status_message("Movie stopped", 3000);
+        }
+        if (movie_active && ImGui::IsItemHovered())
+        {
+            ImGui::BeginTooltip();
+            ImGui::Text("%s: frame %u", movie_is_recording() ? "Recording" : "Playing", movie_get_frame());
+            ImGui::EndTooltip();
+        }
+
+        if (ImGui::BeginMenu("Seek Movie", movie_is_playing()))
+        {
+            if (ImGui::IsWindowAppearing())
+                movie_seek_frame = (int)movie_get_frame();
+
+            // Seeking replays from the nearest keyframe, so only do it once
+            // the slider is released
+            ImGui::PushItemWidth(200.0f);
+            ImGui::SliderInt("##movie_seek", &movie_seek_frame, 0, (int)movie_get_frame_count(), "Frame = %d");
+            ImGui::PopItemWidth();
+
+            if (ImGui::IsItemDeactivatedAfterEdit() && !movie_seek((u32)movie_seek_frame))
+                gui_set_status_message("Failed to seek movie", 3000);
+
+            ImGui::EndMenu();
+        }
+
+        ImGui::Separator();
+
         if (ImGui::MenuItem("Save Screenshot As...", "", false, media_actions_enabled))
         {
             save_screenshot = true;
@@ -847,6 +908,19 @@ static void menu_video(void)
             emu_video_no_sprite_limit(config_video.sprite_limit);
         }
 
+        if (ImGui::MenuItem("Threaded Rendering", "", &config_video.threaded_rendering))
+        {
+            emu_video_threaded_rendering(config_video.threaded_rendering);
+        }
+
+        if (ImGui::IsItemHovered())
+        {
+            ImGui::BeginTooltip();
+            ImGui::Text("Render scanlines on a separate thread.");
+            ImGui::Text("Reduces the time spent emulating each frame on multi-core systems.");
+            ImGui::EndTooltip();
+        }
+
         ImGui::Separator();
 
         if (ImGui::BeginMenu("3D Glasses"))
@@ -1466,7 +1540,7 @@ static void menu_audio(void)
             ImGui::PopItemWidth();
             if (ImGui::IsItemHovered())
             {
-                float latency_ms = (config_audio.buffer_count * GS_AUDIO_QUEUE_SIZE) / (float)(GS_AUDIO_SAMPLE_RATE * 2) * 1000.0f;
+                float latency_ms = (config_audio.buffer_count * GS_AUDIO_QUEUE_SIZE) / (float)(emu_get_core()->GetAudio()->GetSampleRate() * 2) * 1000.0f;
                 ImGui::BeginTooltip();
                 ImGui::Text("Lower values reduce audio latency.");
                 ImGui::Text("Higher values prevent audio underruns.");
@@ -1494,6 +1568,23 @@ static void menu_audio(void)
         }
 #endif
 
+#ifndef GS_DISABLE_AUDIORECORDER
+        ImGui::Separator();
+
+        bool is_audio_recording = emu_is_audio_recording();
+
+        if (ImGui::MenuItem("Start WAV Recording...", "", false, !is_audio_recording && !emu_is_empty()))
+        {
+            save_wav = true;
+        }
+
+        if (ImGui::MenuItem("Stop WAV Recording", "", false, is_audio_recording))
+        {
+            emu_stop_audio_recording();
+            gui_set_status_message("Audio recording stopped", 3000);
+        }
+#endif
+
         ImGui::EndMenu();
     }
 }
@@ -1741,10 +1832,16 @@ static void file_dialogs(void)
         gui_file_dialog_load_state();
     if (save_state)
         gui_file_dialog_save_state();
+    if (record_movie)
+        gui_file_dialog_record_movie();
+    if (play_movie)
+        gui_file_dialog_play_movie();
     if (save_screenshot)
         gui_file_dialog_save_screenshot();
     if (save_vgm)
         gui_file_dialog_save_vgm();
+    if (save_wav)
+        gui_file_dialog_save_wav();
     if (choose_savestates_path)
         gui_file_dialog_choose_savestate_path();
     if (choose_screenshots_path)
@@ -1956,11 +2053,14 @@ static void draw_savestate_slot_info(int slot)
         get_date_time_string(emu_savestates[slot].timestamp, date, sizeof(date));
         ImGui::Text("%s", date);
 
-        if (IsValidPointer(emu_savestates_screenshots[slot].data))
+        GS_SaveState_Screenshot* screenshot = emu_get_savestate_screenshot(slot);
+
+        if (IsValidPointer(screenshot))
         {
-            float width = (float)emu_savestates_screenshots[slot].width;
-            float height = (float)emu_savestates_screenshots[slot].height;
-            ImGui::Image((ImTextureID)(intptr_t)ogl_renderer_emu_savestates, ImVec2((height / 3.0f) * 4.0f, height), ImVec2(0, 0), ImVec2(width / (float)SYSTEM_TEXTURE_WIDTH, height / (float)SYSTEM_TEXTURE_HEIGHT));
+            float width = (float)screenshot->width;
+            float height = (float)screenshot->height;
+            float display_height = height * GS_SAVESTATE_THUMBNAIL_SCALE;
+            ImGui::Image((ImTextureID)(intptr_t)ogl_renderer_emu_savestates, ImVec2((display_height / 3.0f) * 4.0f, display_height), ImVec2(0, 0), ImVec2(width / (float)SYSTEM_TEXTURE_WIDTH, height / (float)SYSTEM_TEXTURE_HEIGHT));
         }
     }
     else
@@ -27,6 +27,7 @@
 #include "application.h"
 #include "gamepad.h"
 #include "emu.h"
+#include "sound_queue.h"
 #include "license.h"
 #include "backers.h"
 #include "ogl_renderer.h"
@@ -364,6 +365,13 @@ void gui_show_fps(void)
     ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f,1.00f,0.0f,1.0f));
     ImGui::SetCursorPos(ImVec2(5.0f, config_debug.debug ? 25.0f : 5.0f));
     ImGui::Text("FPS:  %.2f\nTIME: %.2f ms", ImGui::GetIO().Framerate, 1000.0f / ImGui::GetIO().Framerate);
+    if (sound_queue_is_open())
+    {
+        SoundQueueStats stats;
+        sound_queue_get_stats(&stats);
+        ImGui::Text("AUDIO: %.1f ms (%.0f%%) x%.4f", stats.latency_ms, stats.fill * 100.0f, stats.ratio);
+        ImGui::Text("UNDERRUNS: %u OVERRUNS: %u", stats.underruns, stats.overruns);
+    }
     ImGui::PopStyleColor();
     ImGui::PopFont();
 }
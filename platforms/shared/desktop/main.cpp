@@ -117,6 +117,26 @@ int main(int argc, char* argv[])
                 app_params.mcp_http_address = argv[++i];
                 app_params.mcp_http_address_set = true;
             }
+            else if (strcmp(argv[i], "--record-audio") == 0)
+            {
+                if (i + 1 >= argc || argv[i + 1][0] == '-')
+                {
+                    fprintf(stderr, "Missing value for --record-audio\n");
+                    return -1;
+                }
+
+                app_params.record_audio_file = argv[++i];
+            }
+            else if (strcmp(argv[i], "--movie") == 0)
+            {
+                if (i + 1 >= argc || argv[i + 1][0] == '-')
+                {
+                    fprintf(stderr, "Missing value for --movie\n");
+                    return -1;
+                }
+
+                app_params.movie_file = argv[++i];
+            }
             else
             {
                 printf("Unknown option: %s\n", argv[i]);
@@ -129,7 +149,8 @@ int main(int argc, char* argv[])
     int non_option_count = 0;
     for (int i = 1; i < argc; i++)
     {
-        if ((strcmp(argv[i], "--mcp-http-port") == 0) || (strcmp(argv[i], "--mcp-http-address") == 0))
+        if ((strcmp(argv[i], "--mcp-http-port") == 0) || (strcmp(argv[i], "--mcp-http-address") == 0) ||
+            (strcmp(argv[i], "--record-audio") == 0) || (strcmp(argv[i], "--movie") == 0))
         {
             if (i + 1 < argc)
                 i++;
@@ -174,13 +195,21 @@ int main(int argc, char* argv[])
         printf("      --mcp-router            Enable compact MCP tool routing\n");
         printf("      --mcp-http-address A    HTTP bind address (default: 127.0.0.1)\n");
         printf("      --mcp-http-port N       HTTP port for MCP server (default: 7777)\n");
-        printf("      --headless              Run without GUI (requires --mcp-stdio or --mcp-http)\n");
+        printf("      --record-audio FILE     Record the audio output to a WAV file\n");
+        printf("      --movie FILE            Replay an input movie at full speed and print frame, audio and state hashes\n");
+        printf("      --headless              Run without GUI (requires --mcp-stdio, --mcp-http or --movie)\n");
         printf("      --portable              Store configuration and user data beside the application\n");
         printf("  -v, --version               Display version information\n");
         printf("  -h, --help                  Display this help message\n");
         return ret;
     }
 
+    if (IsValidPointer(app_params.movie_file) && !headless)
+    {
+        printf("Error: --movie requires --headless\n");
+        return -1;
+    }
+
     if (app_params.force_fullscreen && app_params.force_windowed)
         app_params.force_fullscreen = false;
 
@@ -203,7 +232,11 @@ int main(int argc, char* argv[])
 
         if (ret == 0)
         {
-            application_headless_mainloop();
+            if (IsValidPointer(app_params.movie_file))
+                ret = application_headless_movie(app_params.movie_file);
+            else
+                application_headless_mainloop();
+
             application_headless_destroy();
         }
 
@@ -33,6 +33,7 @@
 #include "../config.h"
 #include "../events.h"
 #include "../rewind.h"
+#include "../movie.h"
 #include <cstring>
 #include <sstream>
 #include <iomanip>
@@ -389,6 +390,9 @@ void DebugAdapter::WriteMemoryArea(int area, u32 offset, const std::vector<u8>&
     {
         info.data[offset + i] = data[i];
     }
+
+    if (area == MEMORY_EDITOR_VRAM || area == MEMORY_EDITOR_CRAM)
+        m_core->GetVideo()->InvalidateVRAMCaches();
 }
 
 std::vector<DisasmLine> DebugAdapter::GetDisassembly(u16 start_address, u16 end_address, int bank, bool resolve_symbols)
@@ -899,7 +903,7 @@ json DebugAdapter::GetVDPStatus()
     return status;
 }
 
-json DebugAdapter::GetPSGStatus()
+json DebugAdapter::GetPSGStatus(bool include_waveform)
 {
     json status;
     Audio* audio = m_core->GetAudio();
@@ -914,6 +918,13 @@ json DebugAdapter::GetPSGStatus()
     std::ostringstream ss;
     ss << std::hex << std::uppercase << std::setfill('0');
 
+    bool waveform_pending = false;
+    if (include_waveform && !audio->IsPSGDebugEnabled())
+    {
+        audio->EnablePSGDebug(true);
+        waveform_pending = true;
+    }
+
     json channels = json::array();
     for (int c = 0; c < 4; c++)
     {
@@ -977,10 +988,27 @@ json DebugAdapter::GetPSGStatus()
             }
         }
 
+        if (include_waveform && !waveform_pending)
+        {
+            const int max_points = 128;
+            blip_sample_t* buffer = audio->GetDebugChannelBuffer(c);
+            int samples = audio->GetDebugChannelSamples(c);
+            int step = MAX(1, (samples + max_points - 1) / max_points);
+            json waveform = json::array();
+
+            for (int i = 0; buffer && (i < samples); i += step)
+                waveform.push_back(buffer[i]);
+
+            channel["waveform"] = waveform;
+            channel["waveform_step"] = step;
+        }
+
         channels.push_back(channel);
     }
 
     status["channels"] = channels;
+    if (waveform_pending)
+        status["waveform_pending"] = true;
     status["latch"] = psg_state.latch;
 
     ss << std::setw(2) << psg_state.ggstereo;
@@ -994,7 +1022,7 @@ json DebugAdapter::GetPSGStatus()
 json DebugAdapter::GetYM2413Status()
 {
     json status;
-    YM2413_OPLL* opll = (YM2413_OPLL*)YM2413GetContextPtr();
+    YM2413_OPLL* opll = m_core ? m_core->GetAudio()->GetYM2413()->GetChip() : NULL;
 
     if (opll == NULL)
     {
@@ -1165,7 +1193,51 @@ json DebugAdapter::GetYM2413Status()
     return status;
 }
 
-json DebugAdapter::GetScreenshot()
+json DebugAdapter::StartAudioRecording(const std::string& file_path)
+{
+    json result;
+
+    if (file_path.empty())
+    {
+        result["error"] = "File path is required";
+        Log("[MCP] StartAudioRecording failed: File path is required");
+        return result;
+    }
+
+    if (!emu_start_audio_recording(file_path.c_str()))
+    {
+        result["error"] = "Failed to start audio recording";
+        Log("[MCP] StartAudioRecording failed: %s", file_path.c_str());
+        return result;
+    }
+
+    result["success"] = true;
+    result["file_path"] = file_path;
+    result["sample_rate"] = m_core->GetAudio()->GetSampleRate();
+    result["channels"] = 2;
+
+    return result;
+}
+
+json DebugAdapter::StopAudioRecording()
+{
+    json result;
+
+    if (!emu_is_audio_recording())
+    {
+        result["error"] = "Audio recording is not active";
+        Log("[MCP] StopAudioRecording failed: Audio recording is not active");
+        return result;
+    }
+
+    emu_stop_audio_recording();
+
+    result["success"] = true;
+
+    return result;
+}
+
+json DebugAdapter::GetScreenshot(int scale, Scaler::Filter filter)
 {
     json result;
 
@@ -1178,8 +1250,10 @@ json DebugAdapter::GetScreenshot()
     GS_RuntimeInfo runtime;
     m_core->GetRuntimeInfo(runtime);
 
+    int factor = Scaler::FactorForFilter(filter, scale);
+
     unsigned char* png_buffer = NULL;
-    int png_size = emu_get_screenshot_png(&png_buffer);
+    int png_size = emu_get_screenshot_png(&png_buffer, scale, filter);
 
     if (png_size == 0 || !png_buffer)
     {
@@ -1193,8 +1267,8 @@ json DebugAdapter::GetScreenshot()
     result["__mcp_image"] = true;
     result["data"] = base64_png;
     result["mimeType"] = "image/png";
-    result["width"] = runtime.screen_width;
-    result["height"] = runtime.screen_height;
+    result["width"] = runtime.screen_width * factor;
+    result["height"] = runtime.screen_height * factor;
 
     return result;
 }
@@ -1292,7 +1366,7 @@ json DebugAdapter::ListSaveStateSlots()
             slot["timestamp"] = emu_savestates[i].timestamp;
             slot["version"] = emu_savestates[i].version;
             slot["valid"] = (emu_savestates[i].version >= GS_SAVESTATE_MIN_VERSION && emu_savestates[i].version <= GS_SAVESTATE_VERSION);
-            slot["has_screenshot"] = IsValidPointer(emu_savestates_screenshots[i].data);
+            slot["has_screenshot"] = (emu_savestates[i].screenshot_size > 0);
 
             if (emu_savestates[i].emu_build[0] != 0)
                 slot["emu_build"] = emu_savestates[i].emu_build;
@@ -1343,7 +1417,14 @@ json DebugAdapter::SaveState()
     }
 
     int slot = config_emulator.save_slot + 1;
-    emu_save_state_slot(slot);
+
+    // The write runs in the background, wait for it so the reply is final
+    if (!emu_wait_state_save(emu_save_state_slot(slot, true)))
+    {
+        result["error"] = "Failed to save state";
+        Log("[MCP] SaveState failed: Slot %d", slot);
+        return result;
+    }
 
     result["success"] = true;
     result["slot"] = slot;
@@ -1400,7 +1481,7 @@ json DebugAdapter::SaveStateFile(const std::string& file_path)
         return result;
     }
 
-    if (!m_core->SaveState(file_path.c_str(), -1, false))
+    if (!emu_wait_state_save(emu_save_state_file(file_path.c_str(), true)))
     {
         result["error"] = "Failed to save state file";
         Log("[MCP] SaveStateFile failed: %s", file_path.c_str());
@@ -1431,6 +1512,8 @@ json DebugAdapter::LoadStateFile(const std::string& file_path)
         return result;
     }
 
+    emu_wait_state_saves();
+
     if (!m_core->LoadState(file_path.c_str()))
     {
         result["error"] = "Failed to load state file";
@@ -1438,6 +1521,7 @@ json DebugAdapter::LoadStateFile(const std::string& file_path)
         return result;
     }
 
+    movie_invalidate();
     events_sync_input();
     rewind_reset();
 
@@ -1447,6 +1531,191 @@ json DebugAdapter::LoadStateFile(const std::string& file_path)
     return result;
 }
 
+json DebugAdapter::StateDiffCapture()
+{
+    json result;
+
+    if (!m_core || !m_core->GetCartridge()->IsReady())
+    {
+        result["error"] = "No media loaded";
+        Log("[MCP] StateDiffCapture failed: No media loaded");
+        return result;
+    }
+
+    if (!emu_is_paused() && !emu_is_debug_idle())
+    {
+        result["error"] = "Pause the emulator before capturing a reference state";
+        return result;
+    }
+
+    size_t size = 0;
+
+    if (!m_core->SaveState(NULL, size, false))
+    {
+        result["error"] = "Failed to capture state";
+        Log("[MCP] StateDiffCapture failed: Unable to get state size");
+        return result;
+    }
+
+    m_state_reference.resize(size);
+
+    if (!m_core->SaveState(m_state_reference.data(), size, false))
+    {
+        m_state_reference.clear();
+        result["error"] = "Failed to capture state";
+        Log("[MCP] StateDiffCapture failed: Unable to save state");
+        return result;
+    }
+
+    m_state_reference_crc = m_core->GetCartridge()->GetCRC();
+
+    result["success"] = true;
+    result["size"] = size;
+
+    return result;
+}
+
+json DebugAdapter::StateDiff(int max_ranges)
+{
+    json result;
+
+    if (!m_core || !m_core->GetCartridge()->IsReady())
+    {
+        result["error"] = "No media loaded";
+        Log("[MCP] StateDiff failed: No media loaded");
+        return result;
+    }
+
+    if (!emu_is_paused() && !emu_is_debug_idle())
+    {
+        result["error"] = "Pause the emulator before comparing states";
+        return result;
+    }
+
+    if (m_state_reference.empty())
+    {
+        result["error"] = "No reference state, call state_diff_capture first";
+        return result;
+    }
+
+    if (m_state_reference_crc != m_core->GetCartridge()->GetCRC())
+    {
+        result["error"] = "Reference state was captured with a different ROM";
+        return result;
+    }
+
+    GS_State_Layout layout;
+
+    if (!m_core->GetStateLayout(&layout))
+    {
+        result["error"] = "Failed to get state layout";
+        Log("[MCP] StateDiff failed: Unable to get state layout");
+        return result;
+    }
+
+    // The layout only matches the reference while the state size is the same
+    if (layout.size != m_state_reference.size())
+    {
+        result["error"] = "State size changed since the reference was captured";
+        return result;
+    }
+
+    std::vector<u8> current(layout.size);
+    size_t size = layout.size;
+
+    if (!m_core->SaveState(current.data(), size, false))
+    {
+        result["error"] = "Failed to save current state";
+        Log("[MCP] StateDiff failed: Unable to save state");
+        return result;
+    }
+
+    int count = m_core->DiffStates(m_state_reference.data(), current.data(), &layout, NULL, 0);
+
+    if (count < 0)
+    {
+        result["error"] = "Failed to compare states";
+        return result;
+    }
+
+    std::vector<GS_State_Range> ranges(count);
+
+    if (count > 0)
+        m_core->DiffStates(m_state_reference.data(), current.data(), &layout, ranges.data(), count);
+
+    if (max_ranges < 0)
+        max_ranges = 0;
+
+    u32 section_ranges[GS_State_Section_Count] = { };
+    u32 section_bytes[GS_State_Section_Count] = { };
+    json changes = json::array();
+    int total = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        const GS_State_Range& range = ranges[i];
+
+        // The footer carries a timestamp, so it differs on every save
+        if (range.section == GS_State_Section_Footer)
+            continue;
+
+        section_ranges[range.section]++;
+        section_bytes[range.section] += range.size;
+        total++;
+
+        if ((int)changes.size() >= max_ranges)
+            continue;
+
+        // Sections split in several runs are counted as one contiguous block
+        u32 section_offset = 0;
+
+        for (u32 j = 0; j < layout.count; j++)
+        {
+            const GS_State_Range& owner = layout.ranges[j];
+
+            if (owner.section != range.section)
+                continue;
+
+            if ((range.offset >= owner.offset) && (range.offset < (owner.offset + owner.size)))
+            {
+                section_offset += range.offset - owner.offset;
+                break;
+            }
+
+            section_offset += owner.size;
+        }
+
+        json change;
+        change["section"] = m_core->GetStateSectionName(range.section);
+        change["offset"] = range.offset;
+        change["section_offset"] = section_offset;
+        change["size"] = range.size;
+        changes.push_back(change);
+    }
+
+    json sections = json::array();
+
+    for (int i = 0; i < GS_State_Section_Count; i++)
+    {
+        if (section_ranges[i] == 0)
+            continue;
+
+        json section;
+        section["section"] = m_core->GetStateSectionName(i);
+        section["ranges"] = section_ranges[i];
+        section["bytes"] = section_bytes[i];
+        sections.push_back(section);
+    }
+
+    result["state_size"] = layout.size;
+    result["total_ranges"] = total;
+    result["sections"] = sections;
+    result["ranges"] = changes;
+    result["truncated"] = total > (int)changes.size();
+
+    return result;
+}
+
 json DebugAdapter::SetFastForwardSpeed(int speed)
 {
     json result;
@@ -1498,6 +1767,7 @@ json DebugAdapter::GetRewindStatus()
         fps = 1;
 
     result["buffered_seconds"] = (double)(rewind_get_snapshot_count() * fps) / 60.0;
+    result["memory_bytes"] = rewind_get_memory_usage();
 
     return result;
 }
@@ -83,6 +83,7 @@ public:
     DebugAdapter(GearsystemCore* core)
     {
         m_core = core;
+        m_state_reference_crc = 0;
     }
 
     // Execution control
@@ -118,9 +119,11 @@ public:
     json GetZ80Status();
     json GetVDPRegisters();
     json GetVDPStatus();
-    json GetPSGStatus();
+    json GetPSGStatus(bool include_waveform = false);
     json GetYM2413Status();
-    json GetScreenshot();
+    json StartAudioRecording(const std::string& file_path);
+    json StopAudioRecording();
+    json GetScreenshot(int scale = 1, Scaler::Filter filter = Scaler::FilterNearest);
     json ListSprites();
     json GetSpriteImage(int sprite_index);
 
@@ -136,6 +139,8 @@ public:
     json LoadState();
     json SaveStateFile(const std::string& file_path);
     json LoadStateFile(const std::string& file_path);
+    json StateDiffCapture();
+    json StateDiff(int max_ranges);
     json SetFastForwardSpeed(int speed);
     json ToggleFastForward(bool enabled);
     json GetRewindStatus();
@@ -178,6 +183,8 @@ public:
 
 private:
     GearsystemCore* m_core;
+    std::vector<u8> m_state_reference;
+    u32 m_state_reference_crc;
 
     const char* GetBreakpointTypeName(int type);
     MemoryAreaInfo GetMemoryAreaInfo(int area);
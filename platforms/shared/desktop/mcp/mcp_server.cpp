@@ -762,11 +762,16 @@ json McpServer::BuildToolList()
     tools.push_back({
         {"name", "get_psg_status"},
         {"title", "Get PSG Status"},
-        {"description", "Read SN76489 PSG audio state: 3 tone channels, noise, volume, period, frequency, GG stereo."},
+        {"description", "Read SN76489 PSG audio state: 3 tone channels, noise, volume, period, frequency, GG stereo. Optionally include each channel's waveform for the last frame."},
         {"annotations", {{"readOnlyHint", true}, {"destructiveHint", false}, {"idempotentHint", true}, {"openWorldHint", false}}},
         {"inputSchema", {
             {"type", "object"},
-            {"properties", json::object()},
+            {"properties", {
+                {"include_waveform", {
+                    {"type", "boolean"},
+                    {"description", "Include up to 128 waveform points per channel. The first request enables capture and the data is available from the next frame. Default false."}
+                }}
+            }},
             {"additionalProperties", false}
         }}
     });
@@ -783,14 +788,56 @@ json McpServer::BuildToolList()
         }}
     });
 
+    tools.push_back({
+        {"name", "start_audio_recording"},
+        {"title", "Start Audio Recording"},
+        {"description", "Record the mixed audio output to a 16-bit stereo WAV file at the current sample rate."},
+        {"annotations", {{"readOnlyHint", false}, {"destructiveHint", true}, {"idempotentHint", false}, {"openWorldHint", true}}},
+        {"inputSchema", {
+            {"type", "object"},
+            {"properties", {
+                {"file_path", {
+                    {"type", "string"},
+                    {"description", "Absolute destination WAV file path."}
+                }}
+            }},
+            {"required", json::array({"file_path"})},
+            {"additionalProperties", false}
+        }}
+    });
+
+    tools.push_back({
+        {"name", "stop_audio_recording"},
+        {"title", "Stop Audio Recording"},
+        {"description", "Stop the active audio recording and finalize the WAV file."},
+        {"annotations", {{"readOnlyHint", false}, {"destructiveHint", false}, {"idempotentHint", true}, {"openWorldHint", true}}},
+        {"inputSchema", {
+            {"type", "object"},
+            {"properties", json::object()},
+            {"additionalProperties", false}
+        }}
+    });
+
     tools.push_back({
         {"name", "get_screenshot"},
         {"title", "Get Screenshot"},
-        {"description", "Capture current screen/frame/video output as PNG screenshot image."},
+        {"description", "Capture current screen/frame/video output as PNG screenshot image. Optionally upscaled on the CPU."},
         {"annotations", {{"readOnlyHint", true}, {"destructiveHint", false}, {"idempotentHint", true}, {"openWorldHint", false}}},
         {"inputSchema", {
             {"type", "object"},
-            {"properties", json::object()},
+            {"properties", {
+                {"scale", {
+                    {"type", "integer"},
+                    {"description", "Integer scale factor. Ignored by scale2x and scale3x. Default 1."},
+                    {"minimum", 1},
+                    {"maximum", 4}
+                }},
+                {"filter", {
+                    {"type", "string"},
+                    {"description", "Upscaling filter. Default nearest."},
+                    {"enum", json::array({"nearest", "scale2x", "scale3x", "lcd", "scanlines"})}
+                }}
+            }},
             {"additionalProperties", false}
         }}
     });
@@ -864,7 +911,7 @@ json McpServer::BuildToolList()
     tools.push_back({
         {"name", "save_state"},
         {"title", "Save State"},
-        {"description", "Save emulator state to active save-state slot."},
+        {"description", "Save emulator state to active save-state slot. Replies once the file is written."},
         {"annotations", {{"readOnlyHint", false}, {"destructiveHint", true}, {"idempotentHint", false}, {"openWorldHint", true}}},
         {"inputSchema", {
             {"type", "object"},
@@ -888,7 +935,7 @@ json McpServer::BuildToolList()
     tools.push_back({
         {"name", "save_state_file"},
         {"title", "Save State File"},
-        {"description", "Save emulator state to an explicit file path."},
+        {"description", "Save emulator state to an explicit file path. Replies once the file is written."},
         {"annotations", {{"readOnlyHint", false}, {"destructiveHint", true}, {"idempotentHint", false}, {"openWorldHint", true}}},
         {"inputSchema", {
             {"type", "object"},
@@ -921,6 +968,36 @@ json McpServer::BuildToolList()
         }}
     });
 
+    tools.push_back({
+        {"name", "state_diff_capture"},
+        {"title", "State Diff Capture"},
+        {"description", "Keep the current emulator state as reference for state_diff; emulator must be paused."},
+        {"annotations", {{"readOnlyHint", false}, {"destructiveHint", false}, {"idempotentHint", false}, {"openWorldHint", false}}},
+        {"inputSchema", {
+            {"type", "object"},
+            {"properties", json::object()},
+            {"additionalProperties", false}
+        }}
+    });
+
+    tools.push_back({
+        {"name", "state_diff"},
+        {"title", "State Diff"},
+        {"description", "Compare current emulator state against the state_diff_capture reference; reports changed byte runs per section."},
+        {"annotations", {{"readOnlyHint", true}, {"destructiveHint", false}, {"idempotentHint", true}, {"openWorldHint", false}}},
+        {"inputSchema", {
+            {"type", "object"},
+            {"properties", {
+                {"max_ranges", {
+                    {"type", "integer"},
+                    {"description", "Maximum changed ranges to list (default 64)."},
+                    {"minimum", 0}
+                }}
+            }},
+            {"additionalProperties", false}
+        }}
+    });
+
     tools.push_back({
         {"name", "set_fast_forward_speed"},
         {"title", "Set Fast Forward Speed"},
@@ -960,7 +1037,7 @@ json McpServer::BuildToolList()
     tools.push_back({
         {"name", "get_rewind_status"},
         {"title", "Get Rewind Status"},
-        {"description", "Read rewind buffer: enabled, snapshot count, capacity, buffered seconds."},
+        {"description", "Read rewind buffer: enabled, snapshot count, capacity, buffered seconds, compressed memory usage."},
         {"annotations", {{"readOnlyHint", true}, {"destructiveHint", false}, {"idempotentHint", true}, {"openWorldHint", false}}},
         {"inputSchema", {
             {"type", "object"},
@@ -2375,15 +2452,48 @@ json McpServer::ExecuteCommand(const std::string& toolName, const json& argument
     }
     else if (normalizedTool == "get_psg_status")
     {
-        return m_debugAdapter.GetPSGStatus();
+        bool include_waveform = arguments.value("include_waveform", false);
+        return m_debugAdapter.GetPSGStatus(include_waveform);
     }
     else if (normalizedTool == "get_ym2413_status")
     {
         return m_debugAdapter.GetYM2413Status();
     }
+    else if (normalizedTool == "start_audio_recording")
+    {
+        if (!arguments.contains("file_path") || !arguments["file_path"].is_string())
+            return {{"error", "File path is required"}};
+
+        std::string file_path = arguments["file_path"];
+        return m_debugAdapter.StartAudioRecording(file_path);
+    }
+    else if (normalizedTool == "stop_audio_recording")
+    {
+        return m_debugAdapter.StopAudioRecording();
+    }
     else if (normalizedTool == "get_screenshot")
     {
-        return m_debugAdapter.GetScreenshot();
+        int scale = arguments.value("scale", 1);
+        std::string filter_name = arguments.value("filter", "nearest");
+        Scaler::Filter filter;
+
+        if (scale < 1 || scale > GS_SCALER_MAX_FACTOR)
+            return {{"error", "Invalid scale value (must be 1-4)"}};
+
+        if (filter_name == "nearest")
+            filter = Scaler::FilterNearest;
+        else if (filter_name == "scale2x")
+            filter = Scaler::FilterScale2x;
+        else if (filter_name == "scale3x")
+            filter = Scaler::FilterScale3x;
+        else if (filter_name == "lcd")
+            filter = Scaler::FilterLCD;
+        else if (filter_name == "scanlines")
+            filter = Scaler::FilterScanlines;
+        else
+            return {{"error", "Invalid filter (must be nearest, scale2x, scale3x, lcd or scanlines)"}};
+
+        return m_debugAdapter.GetScreenshot(scale, filter);
     }
     // Media and state management
     else if (normalizedTool == "load_media")
@@ -2428,6 +2538,15 @@ json McpServer::ExecuteCommand(const std::string& toolName, const json& argument
         std::string file_path = arguments["file_path"];
         return m_debugAdapter.LoadStateFile(file_path);
     }
+    else if (normalizedTool == "state_diff_capture")
+    {
+        return m_debugAdapter.StateDiffCapture();
+    }
+    else if (normalizedTool == "state_diff")
+    {
+        int max_ranges = arguments.value("max_ranges", 64);
+        return m_debugAdapter.StateDiff(max_ranges);
+    }
     else if (normalizedTool == "set_fast_forward_speed")
     {
         int speed = arguments["speed"];
@@ -204,7 +204,7 @@ static const McpToolCategory kMcpToolCategories[] =
     {"disassembly", "Disassembly", "Read executed-code disassembly, run to addresses, inspect call stacks, and manage disassembly bookmarks."},
     {"symbols", "Symbols", "Add, remove, load, list, and look up debug symbols or labels."},
     {"hardware_video", "Video Hardware", "Inspect VDP registers, display timing, status, sprites, scanlines, and video state."},
-    {"hardware_audio", "Audio Hardware", "Inspect SN76489 PSG and YM2413 FM audio state, channels, mixer, and sound registers."},
+    {"hardware_audio", "Audio Hardware", "Inspect SN76489 PSG and YM2413 FM audio state, channels, mixer, and sound registers, or record audio output to WAV."},
     {"media", "Media", "Load ROMs, list recent media, load symbols, and inspect loaded cartridge/media information."},
     {"capture", "Capture", "Capture current screenshots and SMS/Game Gear sprite images or sprite metadata."},
     {"state", "Save States", "List save slots, select a slot, save emulator state, and load emulator state."},
@@ -259,7 +259,7 @@ static const char* const kMcpVideoTools[] =
 
 static const char* const kMcpAudioTools[] =
 {
-    "get_psg_status", "get_ym2413_status"
+    "get_psg_status", "get_ym2413_status", "start_audio_recording", "stop_audio_recording"
 };
 
 static const char* const kMcpMediaTools[] =
@@ -275,7 +275,7 @@ static const char* const kMcpCaptureTools[] =
 static const char* const kMcpStateTools[] =
 {
     "list_save_state_slots", "select_save_state_slot", "save_state", "load_state",
-    "save_state_file", "load_state_file"
+    "save_state_file", "load_state_file", "state_diff_capture", "state_diff"
 };
 
 static const char* const kMcpRewindTools[] =
@@ -0,0 +1,654 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "emu.h"
+#include "events.h"
+#include "rewind.h"
+#include "gearsystem.h"
+#include "Input.h"
+
+#define MOVIE_IMPORT
+#include "movie.h"
+
+// Sync keyframes must be loaded during playback: they follow anything that
+// changed the machine outside of the recorded input (resets, state loads,
+// rewinds or frames run from the debugger)
+#define MOVIE_KEYFRAME_SYNC 0x01
+
+// Limits checked before allocating anything read from a movie file. A day
+// of input at 60 fps, and a savestate several times larger than any the
+// core produces.
+#define MOVIE_MAX_FRAMES            (60 * 60 * 60 * 24)
+#define MOVIE_MAX_STATE_SIZE        0x400000
+
+enum Movie_State
+{
+    Movie_State_None,
+    Movie_State_Recording,
+    Movie_State_Playing
+};
+
+struct Movie_Header
+{
+    u32 magic;
+    u32 version;
+    u32 rom_crc;
+    u32 frame_count;
+    u32 keyframe_count;
+    u32 keyframe_interval;
+};
+
+struct Keyframe
+{
+    u32 frame;
+    u32 flags;
+    u32 state_size;
+    std::vector<u8> data;
+};
+
+static const GS_Keys movie_keys[] = { Key_Up, Key_Down, Key_Left, Key_Right, Key_1, Key_2, Key_Start };
+static const int movie_key_count = sizeof(movie_keys) / sizeof(movie_keys[0]);
+
+static Movie_State state = Movie_State_None;
+static std::vector<Movie_Frame> frames;
+static std::vector<Keyframe> keyframes;
+static std::string movie_path;
+static u32 position = 0;
+static u32 rom_crc = 0;
+static bool sync_pending = false;
+static bool phaser_latched = false;
+static Input::stPhaser latched_phaser;
+static u8* state_buffer = NULL;
+static size_t state_buffer_size = 0;
+static u8* scratch_frame_buffer = NULL;
+static s16* scratch_sample_buffer = NULL;
+
+static void clear(void);
+static void ensure_state_buffer(size_t size);
+static bool add_keyframe(u32 frame, u32 flags);
+static bool load_keyframe(const Keyframe& keyframe);
+static const Keyframe* find_keyframe(u32 frame);
+static void capture(Movie_Frame& frame);
+static void apply(const Movie_Frame& frame);
+static bool write_file(const char* file_path);
+static bool read_file(const char* file_path);
+static u64 hash_bytes(u64 hash, const u8* data, size_t size);
+
+void movie_init(void)
+{
+    clear();
+    scratch_frame_buffer = new u8[GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN * 4];
+    scratch_sample_buffer = new s16[GS_AUDIO_BUFFER_SIZE];
+}
+
+void movie_destroy(void)
+{
+    movie_stop();
+    SafeDeleteArray(state_buffer);
+    state_buffer_size = 0;
+    SafeDeleteArray(scratch_frame_buffer);
+    SafeDeleteArray(scratch_sample_buffer);
+}
+
+bool movie_record(const char* file_path)
+{
+    movie_stop();
+
+    if (emu_is_empty())
+        return false;
+
+    FILE* file = fopen_utf8(file_path, "wb");
+    if (!IsValidPointer(file))
+    {
+        Error("Movie: unable to create %s", file_path);
+        return false;
+    }
+    fclose(file);
+
+    movie_path = file_path;
+    rom_crc = emu_get_core()->GetCartridge()->GetCRC();
+    sync_pending = true;
+    state = Movie_State_Recording;
+
+    Log("Movie: recording to %s", file_path);
+    return true;
+}
+
+bool movie_play(const char* file_path)
+{
+    movie_stop();
+
+    if (emu_is_empty())
+        return false;
+
+    if (!read_file(file_path) || !load_keyframe(keyframes[0]))
+    {
+        clear();
+        return false;
+    }
+
+    movie_path = file_path;
+    position = 0;
+    state = Movie_State_Playing;
+    rewind_reset();
+
+    Log("Movie: playing %s (%u frames)", file_path, (u32)frames.size());
+    return true;
+}
+
+void movie_stop(void)
+{
+    Movie_State previous = state;
+    state = Movie_State_None;
+
+    if (previous == Movie_State_Recording)
+    {
+        if (write_file(movie_path.c_str()))
+            Log("Movie: saved %u frames to %s", (u32)frames.size(), movie_path.c_str());
+    }
+    else if (previous == Movie_State_Playing)
+    {
+        Log("Movie: playback stopped at frame %u", position);
+        events_sync_input();
+    }
+
+    clear();
+}
+
+bool movie_seek(u32 frame)
+{
+    if ((state != Movie_State_Playing) || (frame > frames.size()))
+        return false;
+
+    const Keyframe* keyframe = find_keyframe(frame);
+    if (!IsValidPointer(keyframe) || !load_keyframe(*keyframe))
+        return false;
+
+    GearsystemCore* core = emu_get_core();
+    int sample_count = 0;
+
+    // Seeking also works while the emulator is paused
+    bool paused = core->IsPaused();
+    if (paused)
+        core->Pause(false);
+
+    // Only the frame before the target is rendered, so it can be shown
+    for (u32 f = keyframe->frame; f < frame; f++)
+    {
+        apply(frames[f]);
+        core->RunToVBlank(scratch_frame_buffer, scratch_sample_buffer, &sample_count, NULL, (f + 1) == frame);
+    }
+
+    if (paused)
+        core->Pause(true);
+
+    if (frame > keyframe->frame)
+        emu_render_current_frame();
+
+    position = frame;
+    rewind_reset();
+    return true;
+}
+
+void movie_update(void)
+{
+    if (state == Movie_State_Recording)
+    {
+        u32 frame = (u32)frames.size();
+        bool ok = true;
+
+        if (sync_pending)
+            ok = add_keyframe(frame, MOVIE_KEYFRAME_SYNC);
+        else if ((frame % MOVIE_KEYFRAME_INTERVAL) == 0)
+            ok = add_keyframe(frame, 0);
+
+        if (!ok)
+        {
+            Error("Movie: unable to store keyframe, recording stopped");
+            movie_stop();
+            return;
+        }
+
+        sync_pending = false;
+
+        Movie_Frame record;
+        capture(record);
+        frames.push_back(record);
+        position = (u32)frames.size();
+    }
+    else if (state == Movie_State_Playing)
+    {
+        if (position >= frames.size())
+        {
+            Log("Movie: playback finished");
+            movie_stop();
+            return;
+        }
+
+        const Keyframe* keyframe = find_keyframe(position);
+        if ((position > 0) && (keyframe->frame == position) && (keyframe->flags & MOVIE_KEYFRAME_SYNC))
+            load_keyframe(*keyframe);
+
+        apply(frames[position]);
+        position++;
+    }
+}
+
+void movie_invalidate(void)
+{
+    if (state == Movie_State_Recording)
+        sync_pending = true;
+    else if (state == Movie_State_Playing)
+        movie_stop();
+}
+
+void movie_key_pressed(GS_Joypads pad, GS_Keys key)
+{
+    // The Light Phaser samples the pointer when the trigger is pressed, keep
+    // that position even if the pointer moves again before the next frame
+    if ((state == Movie_State_Recording) && (pad == Joypad_1) && (key == Key_1))
+    {
+        latched_phaser = *emu_get_core()->GetInput()->GetPhaser();
+        phaser_latched = true;
+    }
+}
+
+bool movie_is_recording(void)
+{
+    return state == Movie_State_Recording;
+}
+
+bool movie_is_playing(void)
+{
+    return state == Movie_State_Playing;
+}
+
+u32 movie_get_frame(void)
+{
+    return position;
+}
+
+u32 movie_get_frame_count(void)
+{
+    return (u32)frames.size();
+}
+
+int movie_replay(const char* file_path)
+{
+    if (emu_is_empty())
+    {
+        Error("Movie: no media loaded");
+        return 1;
+    }
+
+    movie_stop();
+
+    if (!read_file(file_path) || !load_keyframe(keyframes[0]))
+    {
+        clear();
+        return 1;
+    }
+
+    // Hashes only depend on the movie, not on the audio device
+    GearsystemCore* core = emu_get_core();
+    core->Pause(false);
+    core->GetAudio()->Mute(false);
+    core->GetAudio()->SetSampleRate(GS_AUDIO_SAMPLE_RATE);
+
+    const u64 fnv_offset = 0xCBF29CE484222325ULL;
+    u64 video_total = fnv_offset;
+    u64 audio_total = fnv_offset;
+    u64 state_total = fnv_offset;
+    u64 state_hashes[GS_State_Section_Count];
+    u32 count = (u32)frames.size();
+
+    // Section hashes tell which component diverged first
+    printf("# frame video audio");
+    for (int i = 0; i < GS_State_Section_Footer; i++)
+        printf(" %s", core->GetStateSectionName(i));
+    printf("\n");
+
+    for (u32 f = 0; f < count; f++)
+    {
+        const Keyframe* keyframe = find_keyframe(f);
+        if ((f > 0) && (keyframe->frame == f) && (keyframe->flags & MOVIE_KEYFRAME_SYNC))
+            load_keyframe(*keyframe);
+
+        apply(frames[f]);
+
+        int sample_count = 0;
+        core->RunToVBlank(scratch_frame_buffer, scratch_sample_buffer, &sample_count);
+
+        GS_RuntimeInfo runtime;
+        core->GetRuntimeInfo(runtime);
+
+        u64 video = hash_bytes(fnv_offset, scratch_frame_buffer, runtime.screen_width * runtime.screen_height * 4);
+        u64 audio = hash_bytes(fnv_offset, reinterpret_cast<u8*>(scratch_sample_buffer), sample_count * sizeof(s16));
+        video_total = hash_bytes(video_total, reinterpret_cast<u8*>(&video), sizeof(video));
+        audio_total = hash_bytes(audio_total, reinterpret_cast<u8*>(&audio), sizeof(audio));
+
+        core->GetStateHashes(state_hashes);
+        state_total = hash_bytes(state_total, reinterpret_cast<u8*>(state_hashes), sizeof(state_hashes));
+
+        printf("%u %016llx %016llx", f, (unsigned long long)video, (unsigned long long)audio);
+        for (int i = 0; i < GS_State_Section_Footer; i++)
+            printf(" %016llx", (unsigned long long)state_hashes[i]);
+        printf("\n");
+    }
+
+    printf("frames %u video %016llx audio %016llx state %016llx\n", count, (unsigned long long)video_total, (unsigned long long)audio_total, (unsigned long long)state_total);
+    fflush(stdout);
+
+    clear();
+    return 0;
+}
+
+static void clear(void)
+{
+    frames.clear();
+    keyframes.clear();
+    movie_path.clear();
+    position = 0;
+    rom_crc = 0;
+    sync_pending = false;
+    phaser_latched = false;
+}
+
+static void ensure_state_buffer(size_t size)
+{
+    if (size <= state_buffer_size)
+        return;
+
+    SafeDeleteArray(state_buffer);
+    state_buffer = new u8[size];
+    state_buffer_size = size;
+}
+
+static bool add_keyframe(u32 frame, u32 flags)
+{
+    GearsystemCore* core = emu_get_core();
+    size_t size = 0;
+
+    if (!core->SaveState(NULL, size, false))
+        return false;
+
+    ensure_state_buffer(size);
+
+    if (!core->SaveState(state_buffer, size, false))
+        return false;
+
+    Keyframe keyframe;
+    keyframe.frame = frame;
+    keyframe.flags = flags;
+    keyframe.state_size = (u32)size;
+
+    mz_ulong packed_size = mz_compressBound((mz_ulong)size);
+    keyframe.data.resize(packed_size);
+
+    if (mz_compress2(&keyframe.data[0], &packed_size, state_buffer, (mz_ulong)size, MZ_BEST_SPEED) != MZ_OK)
+        return false;
+
+    keyframe.data.resize(packed_size);
+    keyframes.push_back(keyframe);
+    return true;
+}
+
+static bool load_keyframe(const Keyframe& keyframe)
+{
+    ensure_state_buffer(keyframe.state_size);
+
+    mz_ulong size = keyframe.state_size;
+
+    if ((mz_uncompress(state_buffer, &size, &keyframe.data[0], (mz_ulong)keyframe.data.size()) != MZ_OK) || (size != keyframe.state_size))
+    {
+        Error("Movie: corrupted keyframe at frame %u", keyframe.frame);
+        return false;
+    }
+
+    return emu_get_core()->LoadState(state_buffer, size);
+}
+
+static const Keyframe* find_keyframe(u32 frame)
+{
+    struct Compare
+    {
+        bool operator()(u32 f, const Keyframe& k) const { return f < k.frame; }
+    };
+
+    std::vector<Keyframe>::const_iterator it = std::upper_bound(keyframes.begin(), keyframes.end(), frame, Compare());
+
+    if (it == keyframes.begin())
+        return NULL;
+
+    return &(*(it - 1));
+}
+
+static void capture(Movie_Frame& frame)
+{
+    Input* input = emu_get_core()->GetInput();
+
+    frame.joypad1 = 0xFF;
+    frame.joypad2 = 0xFF;
+
+    for (int i = 0; i < movie_key_count; i++)
+    {
+        if (input->IsKeyPressed(Joypad_1, movie_keys[i]))
+            frame.joypad1 &= ~movie_keys[i];
+        if (input->IsKeyPressed(Joypad_2, movie_keys[i]))
+            frame.joypad2 &= ~movie_keys[i];
+    }
+
+    Input::stPhaser* phaser = phaser_latched ? &latched_phaser : input->GetPhaser();
+
+    frame.flags = input->IsResetPressed() ? MOVIE_FRAME_RESET : 0;
+    frame.reserved = 0;
+    frame.phaser_x = (s16)phaser->x;
+    frame.phaser_y = (s16)phaser->y;
+    frame.paddle = input->GetPaddle()->x;
+
+    phaser_latched = false;
+}
+
+static void apply(const Movie_Frame& frame)
+{
+    Input* input = emu_get_core()->GetInput();
+
+    input->SetPhaser(frame.phaser_x, frame.phaser_y);
+
+    input->GetPaddle()->x = frame.paddle;
+    input->SetPaddle(0.0f);
+
+    input->SetReset((frame.flags & MOVIE_FRAME_RESET) != 0);
+
+    // Only changes go through KeyPressed, it raises the pause NMI and
+    // latches the Light Phaser just like live input does
+    for (int i = 0; i < movie_key_count; i++)
+    {
+        GS_Keys key = movie_keys[i];
+
+        bool pressed1 = !(frame.joypad1 & key);
+        if (pressed1 != input->IsKeyPressed(Joypad_1, key))
+        {
+            if (pressed1)
+                input->KeyPressed(Joypad_1, key);
+            else
+                input->KeyReleased(Joypad_1, key);
+        }
+
+        bool pressed2 = !(frame.joypad2 & key);
+        if (pressed2 != input->IsKeyPressed(Joypad_2, key))
+        {
+            if (pressed2)
+                input->KeyPressed(Joypad_2, key);
+            else
+                input->KeyReleased(Joypad_2, key);
+        }
+    }
+}
+
+static bool write_file(const char* file_path)
+{
+    FILE* file = fopen_utf8(file_path, "wb");
+
+    if (!IsValidPointer(file))
+    {
+        Error("Movie: unable to write %s", file_path);
+        return false;
+    }
+
+    Movie_Header header;
+    header.magic = MOVIE_MAGIC;
+    header.version = MOVIE_VERSION;
+    header.rom_crc = rom_crc;
+    header.frame_count = (u32)frames.size();
+    header.keyframe_count = (u32)keyframes.size();
+    header.keyframe_interval = MOVIE_KEYFRAME_INTERVAL;
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    if (ok && (header.frame_count > 0))
+        ok = fwrite(&frames[0], sizeof(Movie_Frame), frames.size(), file) == frames.size();
+
+    for (size_t i = 0; ok && (i < keyframes.size()); i++)
+    {
+        const Keyframe& keyframe = keyframes[i];
+        u32 data_size = (u32)keyframe.data.size();
+
+        ok = (fwrite(&keyframe.frame, sizeof(keyframe.frame), 1, file) == 1) &&
+             (fwrite(&keyframe.flags, sizeof(keyframe.flags), 1, file) == 1) &&
+             (fwrite(&keyframe.state_size, sizeof(keyframe.state_size), 1, file) == 1) &&
+             (fwrite(&data_size, sizeof(data_size), 1, file) == 1) &&
+             (fwrite(&keyframe.data[0], 1, data_size, file) == data_size);
+    }
+
+    fclose(file);
+
+    if (!ok)
+        Error("Movie: error writing %s", file_path);
+
+    return ok;
+}
+
+static bool read_file(const char* file_path)
+{
+    clear();
+
+    FILE* file = fopen_utf8(file_path, "rb");
+
+    if (!IsValidPointer(file))
+    {
+        Error("Movie: unable to open %s", file_path);
+        return false;
+    }
+
+    Movie_Header header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1;
+
+    if (!ok || (header.magic != MOVIE_MAGIC) || (header.version != MOVIE_VERSION))
+    {
+        Error("Movie: %s is not a valid movie file", file_path);
+        fclose(file);
+        return false;
+    }
+
+    u32 crc = emu_get_core()->GetCartridge()->GetCRC();
+
+    if (header.rom_crc != crc)
+    {
+        Error("Movie: recorded with ROM CRC %08X, loaded ROM is %08X", header.rom_crc, crc);
+        fclose(file);
+        return false;
+    }
+
+    // Sizes read from the file are checked against what is left of it
+    // before anything is allocated
+    long file_size = -1;
+    if (fseek(file, 0, SEEK_END) == 0)
+        file_size = ftell(file);
+    if ((file_size < (long)sizeof(header)) || (fseek(file, sizeof(header), SEEK_SET) != 0))
+        ok = false;
+
+    if ((header.frame_count > MOVIE_MAX_FRAMES) || (header.keyframe_count == 0) || (header.keyframe_count > header.frame_count + 1))
+        ok = false;
+
+    if (ok && ((u64)header.frame_count * sizeof(Movie_Frame) > (u64)(file_size - sizeof(header))))
+        ok = false;
+
+    if (ok && (header.frame_count > 0))
+    {
+        frames.resize(header.frame_count);
+        ok = fread(&frames[0], sizeof(Movie_Frame), header.frame_count, file) == header.frame_count;
+    }
+
+    for (u32 i = 0; ok && (i < header.keyframe_count); i++)
+    {
+        Keyframe keyframe;
+        u32 data_size = 0;
+
+        ok = (fread(&keyframe.frame, sizeof(keyframe.frame), 1, file) == 1) &&
+             (fread(&keyframe.flags, sizeof(keyframe.flags), 1, file) == 1) &&
+             (fread(&keyframe.state_size, sizeof(keyframe.state_size), 1, file) == 1) &&
+             (fread(&data_size, sizeof(data_size), 1, file) == 1);
+
+        // Keyframes are stored in frame order, the first one opens the movie
+        if (ok)
+            ok = (data_size > 0) && (keyframe.state_size > 0) && (keyframe.frame <= header.frame_count) &&
+                 ((i == 0) ? (keyframe.frame == 0) : (keyframe.frame > keyframes.back().frame));
+
+        if (ok)
+            ok = (keyframe.state_size <= MOVIE_MAX_STATE_SIZE) && ((long)data_size <= file_size - ftell(file));
+
+        if (ok)
+        {
+            keyframe.data.resize(data_size);
+            ok = fread(&keyframe.data[0], 1, data_size, file) == data_size;
+        }
+
+        if (ok)
+            keyframes.push_back(keyframe);
+    }
+
+    fclose(file);
+
+    if (!ok)
+    {
+        Error("Movie: %s is truncated or corrupted", file_path);
+        clear();
+        return false;
+    }
+
+    rom_crc = header.rom_crc;
+    return true;
+}
+
+static u64 hash_bytes(u64 hash, const u8* data, size_t size)
+{
+    // 64-bit FNV-1a
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
@@ -0,0 +1,70 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include "gearsystem.h"
+
+#ifdef MOVIE_IMPORT
+    #define EXTERN
+#else
+    #define EXTERN extern
+#endif
+
+#define MOVIE_MAGIC                 0x564D5347
+#define MOVIE_VERSION               1
+
+// A savestate keyframe is embedded every MOVIE_KEYFRAME_INTERVAL frames, so
+// seeking to any frame replays at most that many frames.
+#define MOVIE_KEYFRAME_INTERVAL     300
+
+// Input as seen by the core at the start of one frame. Joypad masks use the
+// same active-low layout as Input.
+struct Movie_Frame
+{
+    u8 joypad1;
+    u8 joypad2;
+    u8 flags;
+    u8 reserved;
+    s16 phaser_x;
+    s16 phaser_y;
+    float paddle;
+};
+
+#define MOVIE_FRAME_RESET           0x01
+
+EXTERN void movie_init(void);
+EXTERN void movie_destroy(void);
+EXTERN bool movie_record(const char* file_path);
+EXTERN bool movie_play(const char* file_path);
+EXTERN void movie_stop(void);
+EXTERN bool movie_seek(u32 frame);
+EXTERN void movie_update(void);
+EXTERN void movie_invalidate(void);
+EXTERN void movie_key_pressed(GS_Joypads pad, GS_Keys key);
+EXTERN bool movie_is_recording(void);
+EXTERN bool movie_is_playing(void);
+EXTERN u32 movie_get_frame(void);
+EXTERN u32 movie_get_frame_count(void);
+EXTERN int movie_replay(const char* file_path);
+
+#undef MOVIE_IMPORT
+#undef EXTERN
+#endif /* MOVIE_H */
@@ -44,6 +44,27 @@ static OglRendererScreenGeometry screen_geometry;
 static int savestates_texture_slot = -1;
 static u32 savestates_texture_generation = 0;
 
+enum Emu_Output
+{
+    Emu_Output_None,
+    Emu_Output_Normal,
+    Emu_Output_Shader_Chain
+};
+
+struct EmuOutputState
+{
+    Emu_Output output;
+    u32 frame_generation;
+    u32 preset_generation;
+    int width;
+    int height;
+    int physical_width;
+    int physical_height;
+    float background_color[3];
+};
+
+static EmuOutputState emu_output_state;
+
 static uint32_t quad_shader_program = 0;
 static uint32_t quad_vao = 0;
 static uint32_t quad_vbo = 0;
@@ -66,6 +87,8 @@ static void bind_texture_unit(int unit, uint32_t texture, uint32_t fallback_text
 static void render_quad(uint32_t program, uint32_t texture, int viewport_width, int viewport_height, float tex_h, float tex_v, float red, float green, float blue, float alpha);
 static void render_quad_preset(int pass_index, uint32_t program, uint32_t texture, int input_width, int input_height, int viewport_width, int viewport_height);
 static void update_system_texture(void);
+static void get_emu_output_state(Emu_Output output, EmuOutputState* state);
+static bool is_emu_output_current(const EmuOutputState* state);
 static void update_debug_textures(void);
 static void update_savestates_texture(void);
 static void load_configured_shader_preset(void);
@@ -342,6 +365,14 @@ static bool should_use_internal_shader_chain(void)
 
 static void render_internal_shader_chain(void)
 {
+    // The last output is still valid when neither the frame nor anything
+    // the passes read has changed since it was rendered
+    EmuOutputState state;
+    get_emu_output_state(Emu_Output_Shader_Chain, &state);
+
+    if (ogl_shader_chain_preset_is_static() && is_emu_output_current(&state))
+        return;
+
     bool filter_linear = ogl_shader_chain_get_preset_filter_linear();
 
     OglShaderChainSourceTexture source_texture;
@@ -357,6 +388,7 @@ static void render_internal_shader_chain(void)
     }
 
     render_external_shader_chain();
+    emu_output_state = state;
 }
 
 static void render_external_shader_chain(void)
@@ -450,6 +482,12 @@ static void render_internal_shader_chain_feedback(void)
 
 static void render_emu_normal(void)
 {
+    EmuOutputState state;
+    get_emu_output_state(Emu_Output_Normal, &state);
+
+    if (is_emu_output_current(&state))
+        return;
+
     float tex_h = (float)current_runtime.screen_width / (float)SYSTEM_TEXTURE_WIDTH;
     float tex_v = (float)current_runtime.screen_height / (float)SYSTEM_TEXTURE_HEIGHT;
 
@@ -465,6 +503,8 @@ static void render_emu_normal(void)
     render_quad(quad_shader_program, system_texture, viewport_width, viewport_height, tex_h, tex_v, 1.0f, 1.0f, 1.0f, 1.0f);
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    emu_output_state = state;
 }
 
 static void update_system_texture(void)
@@ -474,6 +514,30 @@ static void update_system_texture(void)
             GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*) emu_frame_buffer);
 }
 
+static void get_emu_output_state(Emu_Output output, EmuOutputState* state)
+{
+    memset(state, 0, sizeof(EmuOutputState));
+    state->output = output;
+    state->frame_generation = emu_frame_generation;
+    state->width = current_runtime.screen_width;
+    state->height = current_runtime.screen_height;
+
+    if (output == Emu_Output_Shader_Chain)
+    {
+        state->preset_generation = ogl_shader_chain_get_preset_generation();
+        state->physical_width = screen_geometry.physical_width;
+        state->physical_height = screen_geometry.physical_height;
+
+        for (int i = 0; i < 3; i++)
+            state->background_color[i] = config_video.background_color[config_emulator.theme][i];
+    }
+}
+
+static bool is_emu_output_current(const EmuOutputState* state)
+{
+    return memcmp(state, &emu_output_state, sizeof(EmuOutputState)) == 0;
+}
+
 static void update_debug_textures(void)
 {
     if (config_debug.show_video_nametable)
@@ -513,12 +577,14 @@ static void update_savestates_texture(void)
     savestates_texture_slot = i;
     savestates_texture_generation = emu_savestates_generation;
 
-    if (IsValidPointer(emu_savestates_screenshots[i].data))
+    GS_SaveState_Screenshot* screenshot = emu_get_savestate_screenshot(i);
+
+    if (IsValidPointer(screenshot))
     {
-        int width = emu_savestates_screenshots[i].width;
-        int height = emu_savestates_screenshots[i].height;
+        int width = screenshot->width;
+        int height = screenshot->height;
         glBindTexture(GL_TEXTURE_2D, ogl_renderer_emu_savestates);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*) emu_savestates_screenshots[i].data);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*) screenshot->data);
     }
 }
 
@@ -95,6 +95,7 @@ static PresetProgramState preset_programs[SHADER_PRESET_MAX_PASSES];
 static bool preset_loaded = false;
 static char last_error[2048];
 static int preset_frame_count = 0;
+static uint32_t preset_generation = 0;
 
 static void configure_texture_2d(bool filter_linear);
 static void resize_texture_2d(uint32_t texture, int width, int height, int internal_format, uint32_t format, uint32_t type, const void* pixels, bool filter_linear);
@@ -390,6 +391,7 @@ bool ogl_shader_chain_load_preset(const char* path)
     memcpy(preset_programs, new_programs, sizeof(preset_programs));
     preset_loaded = true;
     preset_frame_count = 0;
+    preset_generation++;
     last_error[0] = '\0';
 
     for (int i = 0; i < active_preset.pass_count; i++)
@@ -526,6 +528,37 @@ bool ogl_shader_chain_preset_uses_feedback(void)
     return false;
 }
 
+bool ogl_shader_chain_preset_is_static(void)
+{
+    if (!preset_loaded)
+        return false;
+
+    // The output only depends on the current source when no pass reads
+    // previous frames or the frame counter
+    for (int i = 0; i < active_preset.pass_count; i++)
+    {
+        const PresetProgramState* state = &preset_programs[i];
+
+        if (active_preset.passes[i].history || active_preset.passes[i].feedback)
+            return false;
+        if (state->uses_feedback || (state->uniform_frame_count >= 0))
+            return false;
+
+        for (int j = 0; j < SHADER_PRESET_MAX_HISTORY_TEXTURES; j++)
+        {
+            if (state->uses_source_history[j])
+                return false;
+        }
+    }
+
+    return true;
+}
+
+uint32_t ogl_shader_chain_get_preset_generation(void)
+{
+    return preset_generation;
+}
+
 void ogl_shader_chain_get_preset_pass_output_size(int index, const OglShaderChainPassSize* pass_size, int* width, int* height)
 {
     if (width)
@@ -568,6 +601,7 @@ bool ogl_shader_chain_set_parameter(int index, float value)
 
     ShaderPresetParameter* parameter = &active_preset.parameters[index];
     parameter->value = CLAMP(value, parameter->minimum, parameter->maximum);
+    preset_generation++;
     return true;
 }
 
@@ -582,6 +616,7 @@ bool ogl_shader_chain_restore_default_parameters(void)
         parameter->value = CLAMP(parameter->default_value, parameter->minimum, parameter->maximum);
     }
 
+    preset_generation++;
     return true;
 }
 
@@ -882,6 +917,7 @@ static void clear_preset_state(void)
     memset(preset_programs, 0, sizeof(preset_programs));
     preset_loaded = false;
     preset_frame_count = 0;
+    preset_generation++;
     release_intermediate_textures(0);
     clear_all_pass_history_textures();
 }
@@ -94,6 +94,8 @@ EXTERN bool ogl_shader_chain_get_preset_pass_uses_feedback_sampler(int index);
 EXTERN bool ogl_shader_chain_get_preset_pass_uses_history_sampler(int pass_index, int history_index);
 EXTERN bool ogl_shader_chain_get_preset_pass_uses_pass_output_sampler(int pass_index, int output_index);
 EXTERN bool ogl_shader_chain_preset_uses_feedback(void);
+EXTERN bool ogl_shader_chain_preset_is_static(void);
+EXTERN uint32_t ogl_shader_chain_get_preset_generation(void);
 EXTERN void ogl_shader_chain_get_preset_pass_output_size(int index, const OglShaderChainPassSize* pass_size, int* width, int* height);
 EXTERN int ogl_shader_chain_get_parameter_count(void);
 EXTERN const ShaderPresetParameter* ogl_shader_chain_get_parameter(int index);
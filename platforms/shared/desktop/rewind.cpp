@@ -18,6 +18,9 @@
  */
 
 #include <string.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "emu.h"
 #include "config.h"
 #include "gearsystem.h"
@@ -26,8 +29,30 @@
 #define REWIND_IMPORT
 #include "rewind.h"
 
-static u8* buffer = NULL;
-static size_t sizes[REWIND_MAX_SNAPSHOTS] = { 0 };
+// Zero runs shorter than this are cheaper to keep inside a literal
+#define REWIND_MIN_ZERO_RUN 8
+
+struct Snapshot
+{
+    size_t offset;
+    size_t size;
+    size_t state_size;
+    int keyframe;
+    u32 serial;
+};
+
+// Frames recently shown by seeks, so scrubbing back and forth over the same
+// snapshots doesn't emulate them again
+struct Cached_Frame
+{
+    u32 serial;
+    u32 last_use;
+    int width;
+    int height;
+    u8* pixels;
+};
+
+static Snapshot* snapshots = NULL;
 static int head = 0;
 static int count = 0;
 static int capacity = 0;
@@ -35,28 +60,80 @@ static int frame_accum = 0;
 static bool active = false;
 static bool storage_dirty = true;
 static int seek_age = -1;
-static size_t slot_size = 0;
-static size_t allocated_size = 0;
+static u8* ring = NULL;
+static size_t ring_size = 0;
+static size_t ring_head = 0;
+static size_t ring_used = 0;
+static u8* state = NULL;
+static u8* key_state = NULL;
+static u8* packed = NULL;
+static size_t state_capacity = 0;
+static int key_slot = -1;
+static int key_count = 0;
+static u32 next_serial = 0;
+static Cached_Frame frame_cache[REWIND_FRAME_CACHE_SIZE];
+static u32 frame_cache_clock = 0;
+
+// Raw states are handed to the worker thread through two staging buffers,
+// the emulation thread only pays for SaveState
+static u8* staging[2] = { NULL, NULL };
+static size_t staging_sizes[2] = { 0, 0 };
+static unsigned int staged = 0;
+static unsigned int stored = 0;
+static bool worker_quit = false;
+static std::thread worker;
+static std::mutex worker_mutex;
+static std::condition_variable work_condition;
+static std::condition_variable done_condition;
 
 static int slot_at(int age);
 static int get_target_capacity(void);
-static size_t get_target_slot_size(void);
+static size_t get_target_state_size(void);
 static bool ensure_storage(void);
+static bool ensure_scratch(size_t size);
 static void release_storage(void);
+static void clear_snapshots(void);
+static bool allocate(size_t size, size_t& offset);
+static bool grow_ring(size_t size);
+static void evict_oldest_group(void);
+static void drop_newest(int n);
+static void sync_keyframe(void);
+static bool decode_snapshot(int idx, size_t& size);
+static void store_snapshot(const u8* src, size_t size);
+static void run_worker(void);
+static void wait_worker(void);
+static size_t delta_encode(const u8* src, const u8* base, size_t size, u8* dst);
+static bool delta_apply(const u8* src, size_t src_size, u8* dst, size_t dst_size);
 static void truncate_to_seek_position(void);
-static void restore_screenshot(const u8* slot, size_t size);
+static bool restore_snapshot(int idx, size_t size);
+static void clear_frame_cache(void);
 
 bool rewind_init(void)
 {
+    worker_quit = false;
+    staged = 0;
+    stored = 0;
+    worker = std::thread(run_worker);
+
     rewind_reset();
     return true;
 }
 
 void rewind_destroy(void)
 {
+    wait_worker();
+
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex);
+        worker_quit = true;
+    }
+
+    work_condition.notify_one();
+    if (worker.joinable())
+        worker.join();
+
     release_storage();
-    count = 0;
-    head = 0;
+    clear_frame_cache();
     frame_accum = 0;
     active = false;
     storage_dirty = true;
@@ -65,14 +142,13 @@ void rewind_destroy(void)
 
 void rewind_reset(void)
 {
-    head = 0;
-    count = 0;
+    wait_worker();
+    clear_snapshots();
+    clear_frame_cache();
     frame_accum = 0;
     active = false;
     storage_dirty = true;
     seek_age = -1;
-    for (int i = 0; i < REWIND_MAX_SNAPSHOTS; i++)
-        sizes[i] = 0;
 
     if (!config_rewind.enabled || emu_is_empty())
     {
@@ -80,7 +156,6 @@ void rewind_reset(void)
         return;
     }
 
-    capacity = get_target_capacity();
     ensure_storage();
 }
 
@@ -88,7 +163,7 @@ void rewind_push(void)
 {
     if (!config_rewind.enabled)
         return;
-    if (!IsValidPointer(buffer))
+    if (!IsValidPointer(snapshots))
         return;
     if (emu_is_empty() || emu_is_paused())
         return;
@@ -103,51 +178,64 @@ void rewind_push(void)
     if (!ensure_storage())
         return;
 
-    u8* slot = buffer + ((size_t)head * slot_size);
-    size_t size = slot_size;
+    // Only blocks when the worker is two snapshots behind
+    {
+        std::unique_lock<std::mutex> lock(worker_mutex);
+        while ((staged - stored) >= 2)
+            done_condition.wait(lock);
+    }
 
-    if (!emu_get_core()->SaveState(slot, size, true))
+    int index = staged & 1;
+    size_t size = state_capacity;
+
+    if (!emu_get_core()->SaveState(staging[index], size))
     {
         storage_dirty = true;
         if (!ensure_storage())
             return;
 
-        slot = buffer + ((size_t)head * slot_size);
-        size = slot_size;
-        if (!emu_get_core()->SaveState(slot, size, true))
+        size = state_capacity;
+        if (!emu_get_core()->SaveState(staging[index], size))
         {
-            Log("Rewind: failed to save snapshot into %zu-byte slot", slot_size);
+            Log("Rewind: failed to save snapshot into %zu-byte buffer", state_capacity);
             return;
         }
     }
 
-    sizes[head] = size;
-    head = (head + 1) % capacity;
-    if (count < capacity)
-        count++;
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex);
+        staging_sizes[index] = size;
+        staged++;
+    }
+
+    work_condition.notify_one();
 }
 
-bool rewind_pop(void)
+// Steps back several snapshots at once. Only the last one is restored, the
+// ones in between are dropped without being drawn so they do not evict the
+// frames kept for scrubbing.
+bool rewind_pop(int steps)
 {
-    if (count == 0)
+    wait_worker();
+
+    if (count == 0 || steps < 1)
         return false;
-    if (!IsValidPointer(buffer))
+    if (!IsValidPointer(snapshots))
         return false;
 
-    int idx = slot_at(0);
-    const u8* slot = buffer + ((size_t)idx * slot_size);
-    size_t size = sizes[idx];
+    if (steps > count)
+        steps = count;
+
+    drop_newest(steps - 1);
 
-    bool ok = emu_get_core()->LoadState(slot, size);
+    int idx = slot_at(0);
+    size_t size = 0;
+    bool ok = decode_snapshot(idx, size) && restore_snapshot(idx, size);
 
     if (ok)
-    {
-        restore_screenshot(slot, size);
         events_sync_input();
-    }
 
-    head = idx;
-    count--;
+    drop_newest(1);
     seek_age = -1;
     return ok;
 }
@@ -171,30 +259,32 @@ bool rewind_is_active(void)
 
 int rewind_get_snapshot_count(void)
 {
-    return count;
+    // Snapshots still being compressed are counted as stored
+    std::lock_guard<std::mutex> lock(worker_mutex);
+    return count + (int)(staged - stored);
 }
 
 size_t rewind_get_memory_usage(void)
 {
-    return allocated_size;
+    std::lock_guard<std::mutex> lock(worker_mutex);
+    return ring_used;
 }
 
 bool rewind_seek(int age)
 {
+    wait_worker();
+
     if (age < 0 || age >= count)
         return false;
-    if (!IsValidPointer(buffer))
+    if (!IsValidPointer(snapshots))
         return false;
 
     int idx = slot_at(age);
-    const u8* slot = buffer + ((size_t)idx * slot_size);
-    size_t size = sizes[idx];
-
-    bool ok = emu_get_core()->LoadState(slot, size);
+    size_t size = 0;
+    bool ok = decode_snapshot(idx, size) && restore_snapshot(idx, size);
 
     if (ok)
     {
-        restore_screenshot(slot, size);
         events_sync_input();
         seek_age = age;
     }
@@ -229,22 +319,20 @@ static int get_target_capacity(void)
     int target = (config_rewind.buffer_seconds * 60 + fps - 1) / fps;
     if (target < 1)
         target = 1;
-    if (target > REWIND_MAX_SNAPSHOTS)
-        target = REWIND_MAX_SNAPSHOTS;
 
     return target;
 }
 
-static size_t get_target_slot_size(void)
+static size_t get_target_state_size(void)
 {
     if (emu_is_empty())
         return 0;
 
-    size_t target_slot_size = 0;
-    if (!emu_get_core()->SaveState(NULL, target_slot_size, true))
+    size_t target_state_size = 0;
+    if (!emu_get_core()->SaveState(NULL, target_state_size))
         return 0;
 
-    return target_slot_size;
+    return target_state_size;
 }
 
 static bool ensure_storage(void)
@@ -255,56 +343,489 @@ static bool ensure_storage(void)
         return false;
     }
 
-    int target_capacity = get_target_capacity();
-    if (!storage_dirty && IsValidPointer(buffer) && (capacity == target_capacity))
+    // Whole groups are evicted at once, the extra slots keep at least the
+    // configured number of snapshots around
+    int target_capacity = get_target_capacity() + REWIND_KEYFRAME_INTERVAL;
+    if (!storage_dirty && IsValidPointer(snapshots) && (capacity == target_capacity))
         return true;
 
-    size_t target_slot_size = get_target_slot_size();
-    if (target_slot_size == 0)
+    wait_worker();
+
+    size_t target_state_size = get_target_state_size();
+    if (target_state_size == 0)
         return false;
 
-    if (storage_dirty && IsValidPointer(buffer) && (capacity == target_capacity) && (slot_size >= target_slot_size))
+    if (IsValidPointer(snapshots) && (capacity == target_capacity))
     {
+        if (!ensure_scratch(target_state_size))
+            return false;
+
         storage_dirty = false;
         return true;
     }
 
-    size_t target_size = (size_t)target_capacity * target_slot_size;
-    u8* new_buffer = new (std::nothrow) u8[target_size];
-    if (!IsValidPointer(new_buffer))
+    Snapshot* new_snapshots = new (std::nothrow) Snapshot[target_capacity];
+    if (!IsValidPointer(new_snapshots))
     {
-        Log("Rewind: failed to allocate %zu bytes", target_size);
+        Log("Rewind: failed to allocate %d snapshot entries", target_capacity);
         return false;
     }
 
-    SafeDeleteArray(buffer);
-    buffer = new_buffer;
-    allocated_size = target_size;
-    slot_size = target_slot_size;
+    release_storage();
+    snapshots = new_snapshots;
     capacity = target_capacity;
-    head = 0;
-    count = 0;
+
+    if (!ensure_scratch(target_state_size))
+    {
+        release_storage();
+        return false;
+    }
+
     frame_accum = 0;
     active = false;
     storage_dirty = false;
     seek_age = -1;
-    for (int i = 0; i < REWIND_MAX_SNAPSHOTS; i++)
-        sizes[i] = 0;
 
-    Log("Rewind: allocated %.1f MB ring buffer (%d snapshots, %zu-byte slots)",
-        (double)target_size / (1024.0 * 1024.0), target_capacity, target_slot_size);
+    Log("Rewind: ready for %d snapshots (%zu-byte states, up to %.1f MB compressed)",
+        get_target_capacity(), target_state_size, (double)REWIND_MAX_MEMORY / (1024.0 * 1024.0));
+
+    return true;
+}
+
+static bool ensure_scratch(size_t size)
+{
+    if (size <= state_capacity)
+        return true;
+
+    // Worst case for the encoder is a literal every REWIND_MIN_ZERO_RUN bytes
+    u8* new_state = new (std::nothrow) u8[size];
+    u8* new_key_state = new (std::nothrow) u8[size];
+    u8* new_packed = new (std::nothrow) u8[(size * 2) + 64];
+    u8* new_staging_0 = new (std::nothrow) u8[size];
+    u8* new_staging_1 = new (std::nothrow) u8[size];
+
+    if (!IsValidPointer(new_state) || !IsValidPointer(new_key_state) || !IsValidPointer(new_packed) ||
+        !IsValidPointer(new_staging_0) || !IsValidPointer(new_staging_1))
+    {
+        Log("Rewind: failed to allocate %zu-byte state buffers", size);
+        SafeDeleteArray(new_state);
+        SafeDeleteArray(new_key_state);
+        SafeDeleteArray(new_packed);
+        SafeDeleteArray(new_staging_0);
+        SafeDeleteArray(new_staging_1);
+        return false;
+    }
 
+    if (IsValidPointer(key_state))
+        memcpy(new_key_state, key_state, state_capacity);
+
+    SafeDeleteArray(state);
+    SafeDeleteArray(key_state);
+    SafeDeleteArray(packed);
+    SafeDeleteArray(staging[0]);
+    SafeDeleteArray(staging[1]);
+    state = new_state;
+    key_state = new_key_state;
+    packed = new_packed;
+    staging[0] = new_staging_0;
+    staging[1] = new_staging_1;
+    state_capacity = size;
     return true;
 }
 
 static void release_storage(void)
 {
-    SafeDeleteArray(buffer);
-    allocated_size = 0;
-    slot_size = 0;
+    wait_worker();
+    clear_snapshots();
+    SafeDeleteArray(snapshots);
+    SafeDeleteArray(ring);
+    SafeDeleteArray(state);
+    SafeDeleteArray(key_state);
+    SafeDeleteArray(packed);
+    SafeDeleteArray(staging[0]);
+    SafeDeleteArray(staging[1]);
+    ring_size = 0;
+    state_capacity = 0;
     capacity = 0;
 }
 
+static void clear_snapshots(void)
+{
+    head = 0;
+    count = 0;
+    ring_head = 0;
+    ring_used = 0;
+    key_slot = -1;
+    key_count = 0;
+}
+
+static bool allocate(size_t size, size_t& offset)
+{
+    // Records are laid out oldest to newest, wrapping to the start of the
+    // ring when the tail end is too short
+    while (true)
+    {
+        if (count == 0)
+        {
+            ring_head = 0;
+            if (size <= ring_size)
+            {
+                offset = 0;
+                return true;
+            }
+        }
+        else
+        {
+            size_t tail = snapshots[slot_at(count - 1)].offset;
+
+            if (ring_head > tail)
+            {
+                if ((ring_size - ring_head) >= size)
+                {
+                    offset = ring_head;
+                    return true;
+                }
+                if (tail >= size)
+                {
+                    offset = 0;
+                    return true;
+                }
+            }
+            else if ((tail - ring_head) >= size)
+            {
+                offset = ring_head;
+                return true;
+            }
+        }
+
+        if (grow_ring(size))
+            continue;
+        if (count == 0)
+            return false;
+
+        evict_oldest_group();
+    }
+}
+
+static bool grow_ring(size_t size)
+{
+    if (ring_size >= REWIND_MAX_MEMORY)
+        return false;
+
+    size_t new_size = MAX(ring_size * 2, MAX(ring_used + size, state_capacity));
+    new_size = MIN(new_size, (size_t)REWIND_MAX_MEMORY);
+
+    if (new_size <= ring_size)
+        return false;
+
+    u8* new_ring = new (std::nothrow) u8[new_size];
+    if (!IsValidPointer(new_ring))
+    {
+        Log("Rewind: failed to grow ring buffer to %zu bytes", new_size);
+        return false;
+    }
+
+    size_t pos = 0;
+
+    for (int age = count - 1; age >= 0; age--)
+    {
+        Snapshot& snapshot = snapshots[slot_at(age)];
+        memcpy(new_ring + pos, ring + snapshot.offset, snapshot.size);
+        snapshot.offset = pos;
+        pos += snapshot.size;
+    }
+
+    SafeDeleteArray(ring);
+    ring = new_ring;
+    ring_size = new_size;
+    ring_head = pos;
+    return true;
+}
+
+static void evict_oldest_group(void)
+{
+    // Deltas are useless without their keyframe, drop them together
+    do
+    {
+        int idx = slot_at(count - 1);
+        ring_used -= snapshots[idx].size;
+        if (idx == key_slot)
+            key_slot = -1;
+        count--;
+    }
+    while ((count > 0) && (snapshots[slot_at(count - 1)].keyframe != slot_at(count - 1)));
+
+    if (count == 0)
+        clear_snapshots();
+}
+
+static void drop_newest(int n)
+{
+    for (int i = 0; (i < n) && (count > 0); i++)
+    {
+        int idx = slot_at(0);
+        ring_used -= snapshots[idx].size;
+        head = idx;
+        count--;
+    }
+
+    sync_keyframe();
+}
+
+static void sync_keyframe(void)
+{
+    if (count == 0)
+    {
+        clear_snapshots();
+        return;
+    }
+
+    int newest = slot_at(0);
+    const Snapshot& snapshot = snapshots[newest];
+    ring_head = snapshot.offset + snapshot.size;
+    key_count = ((newest - snapshot.keyframe + capacity) % capacity) + 1;
+
+    if (snapshot.keyframe == key_slot)
+        return;
+
+    // The next delta is encoded against the keyframe of the newest group
+    const Snapshot& key = snapshots[snapshot.keyframe];
+    memset(key_state, 0, key.state_size);
+
+    if (delta_apply(ring + key.offset, key.size, key_state, key.state_size))
+        key_slot = snapshot.keyframe;
+    else
+        key_slot = -1;
+}
+
+static void store_snapshot(const u8* src, size_t size)
+{
+    // Runs on the worker thread. The emulation thread waits for it before
+    // touching the ring, the lock only guards the counters it reads.
+    if (count == capacity)
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex);
+        evict_oldest_group();
+    }
+
+    bool keyframe = (key_slot < 0) || (key_count >= REWIND_KEYFRAME_INTERVAL) ||
+                    (snapshots[key_slot].state_size != size);
+
+    size_t packed_size = delta_encode(src, keyframe ? NULL : key_state, size, packed);
+
+    // A delta that outgrew its keyframe means the state drifted too far
+    if (!keyframe && (packed_size >= snapshots[key_slot].size))
+    {
+        keyframe = true;
+        packed_size = delta_encode(src, NULL, size, packed);
+    }
+
+    std::lock_guard<std::mutex> lock(worker_mutex);
+    size_t offset = 0;
+
+    while (true)
+    {
+        if (!allocate(packed_size, offset))
+        {
+            Log("Rewind: failed to store %zu-byte snapshot", packed_size);
+            return;
+        }
+
+        // Making room may have dropped the group this delta refers to
+        if (keyframe || (key_slot >= 0))
+            break;
+
+        keyframe = true;
+        packed_size = delta_encode(src, NULL, size, packed);
+    }
+
+    memcpy(ring + offset, packed, packed_size);
+    ring_head = offset + packed_size;
+    ring_used += packed_size;
+
+    Snapshot& snapshot = snapshots[head];
+    snapshot.offset = offset;
+    snapshot.size = packed_size;
+    snapshot.state_size = size;
+    snapshot.keyframe = keyframe ? head : key_slot;
+    snapshot.serial = next_serial++;
+
+    if (keyframe)
+    {
+        memcpy(key_state, src, size);
+        key_slot = head;
+        key_count = 0;
+    }
+
+    key_count++;
+    head = (head + 1) % capacity;
+    count++;
+}
+
+static void run_worker(void)
+{
+    std::unique_lock<std::mutex> lock(worker_mutex);
+
+    while (true)
+    {
+        while (!worker_quit && (stored == staged))
+            work_condition.wait(lock);
+
+        if (worker_quit)
+            break;
+
+        int index = stored & 1;
+
+        lock.unlock();
+        store_snapshot(staging[index], staging_sizes[index]);
+        lock.lock();
+
+        stored++;
+        done_condition.notify_all();
+    }
+}
+
+static void wait_worker(void)
+{
+    std::unique_lock<std::mutex> lock(worker_mutex);
+
+    while (stored != staged)
+        done_condition.wait(lock);
+}
+
+static bool decode_snapshot(int idx, size_t& size)
+{
+    const Snapshot& snapshot = snapshots[idx];
+    const Snapshot& key = snapshots[snapshot.keyframe];
+
+    if (snapshot.keyframe == key_slot)
+        memcpy(state, key_state, key.state_size);
+    else
+    {
+        memset(state, 0, key.state_size);
+        if (!delta_apply(ring + key.offset, key.size, state, key.state_size))
+            return false;
+    }
+
+    if ((idx != snapshot.keyframe) && !delta_apply(ring + snapshot.offset, snapshot.size, state, snapshot.state_size))
+        return false;
+
+    size = snapshot.state_size;
+    return true;
+}
+
+static INLINE u8* write_varint(u8* dst, size_t value)
+{
+    while (value >= 0x80)
+    {
+        *dst++ = (u8)(value | 0x80);
+        value >>= 7;
+    }
+    *dst++ = (u8)value;
+    return dst;
+}
+
+static INLINE bool read_varint(const u8* src, size_t src_size, size_t& pos, size_t& value)
+{
+    value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (pos >= src_size)
+            return false;
+
+        u8 byte = src[pos++];
+        value |= (size_t)(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+static INLINE u8 diff_at(const u8* src, const u8* base, size_t i)
+{
+    return IsValidPointer(base) ? (src[i] ^ base[i]) : src[i];
+}
+
+static INLINE bool words_equal(const u8* src, const u8* base, size_t i)
+{
+    u64 a = 0;
+    u64 b = 0;
+    memcpy(&a, src + i, sizeof(a));
+    if (IsValidPointer(base))
+        memcpy(&b, base + i, sizeof(b));
+    return a == b;
+}
+
+// Encodes src XOR base (or src alone for keyframes) as a sequence of
+// (zero run length, literal length, literal bytes)
+static size_t delta_encode(const u8* src, const u8* base, size_t size, u8* dst)
+{
+    u8* out = dst;
+    size_t i = 0;
+
+    while (i < size)
+    {
+        size_t zero_start = i;
+
+        while (((i + 8) <= size) && words_equal(src, base, i))
+            i += 8;
+        while ((i < size) && (diff_at(src, base, i) == 0))
+            i++;
+
+        size_t literal_start = i;
+        size_t zeros = 0;
+
+        while ((i < size) && (zeros < REWIND_MIN_ZERO_RUN))
+        {
+            if (diff_at(src, base, i) == 0)
+                zeros++;
+            else
+                zeros = 0;
+            i++;
+        }
+
+        i -= zeros;
+
+        out = write_varint(out, literal_start - zero_start);
+        out = write_varint(out, i - literal_start);
+
+        for (size_t j = literal_start; j < i; j++)
+            *out++ = diff_at(src, base, j);
+    }
+
+    return (size_t)(out - dst);
+}
+
+static bool delta_apply(const u8* src, size_t src_size, u8* dst, size_t dst_size)
+{
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < src_size)
+    {
+        size_t zeros = 0;
+        size_t literal = 0;
+
+        if (!read_varint(src, src_size, in, zeros) || !read_varint(src, src_size, in, literal))
+            return false;
+        if ((zeros > (dst_size - out)) || (literal > (dst_size - out - zeros)) || (literal > (src_size - in)))
+            return false;
+
+        out += zeros;
+
+        for (size_t j = 0; j < literal; j++)
+            dst[out + j] ^= src[in + j];
+
+        in += literal;
+        out += literal;
+    }
+
+    return true;
+}
+
 static void truncate_to_seek_position(void)
 {
     if (seek_age <= 0)
@@ -313,34 +834,65 @@ static void truncate_to_seek_position(void)
         return;
     }
 
-    int idx = slot_at(seek_age);
-    head = (idx + 1) % capacity;
-    count -= seek_age;
+    wait_worker();
+    drop_newest(seek_age);
     seek_age = -1;
 }
 
-static void restore_screenshot(const u8* slot, size_t size)
+static bool restore_snapshot(int idx, size_t size)
 {
-    if (size <= sizeof(GS_SaveState_Header))
-        return;
+    GearsystemCore* core = emu_get_core();
+    u32 serial = snapshots[idx].serial;
+    Cached_Frame* target = &frame_cache[0];
 
-    GS_SaveState_Header header;
-    memcpy(&header, slot + size - sizeof(GS_SaveState_Header), sizeof(header));
+    for (int i = 0; i < REWIND_FRAME_CACHE_SIZE; i++)
+    {
+        Cached_Frame* entry = &frame_cache[i];
 
-    if (header.magic != GS_SAVESTATE_MAGIC)
-        return;
-    if (header.screenshot_size == 0)
-        return;
+        if (IsValidPointer(entry->pixels) && (entry->serial == serial))
+        {
+            if (!core->LoadState(state, size))
+                return false;
+
+            entry->last_use = ++frame_cache_clock;
+            memcpy(emu_frame_buffer, entry->pixels, entry->width * entry->height * 4);
+            core->GetVideo()->InvalidateFrameCache();
+            emu_frame_generation++;
+            return true;
+        }
 
-    size_t max_screenshot_size = (size_t)512 * 512 * 4;
-    if (header.screenshot_size > max_screenshot_size)
-        return;
+        if (!IsValidPointer(entry->pixels) || (IsValidPointer(target->pixels) && (entry->last_use < target->last_use)))
+            target = entry;
+    }
 
-    if (header.screenshot_size > (size - sizeof(GS_SaveState_Header)))
-        return;
+    if (!core->RenderState(state, size, emu_frame_buffer))
+        return false;
+
+    GS_RuntimeInfo runtime;
+    core->GetRuntimeInfo(runtime);
+
+    if (!IsValidPointer(target->pixels))
+        target->pixels = new u8[GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN * 4];
 
-    size_t screenshot_offset = size - sizeof(GS_SaveState_Header) - header.screenshot_size;
-    const u8* screenshot_data = slot + screenshot_offset;
+    target->serial = serial;
+    target->last_use = ++frame_cache_clock;
+    target->width = runtime.screen_width;
+    target->height = runtime.screen_height;
+    memcpy(target->pixels, emu_frame_buffer, target->width * target->height * 4);
+
+    core->GetVideo()->InvalidateFrameCache();
+    emu_frame_generation++;
+    return true;
+}
+
+static void clear_frame_cache(void)
+{
+    for (int i = 0; i < REWIND_FRAME_CACHE_SIZE; i++)
+    {
+        SafeDeleteArray(frame_cache[i].pixels);
+        frame_cache[i].serial = 0;
+        frame_cache[i].last_use = 0;
+    }
 
-    memcpy(emu_frame_buffer, screenshot_data, header.screenshot_size);
+    frame_cache_clock = 0;
 }
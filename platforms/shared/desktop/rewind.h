@@ -31,15 +31,25 @@
 // Comfortable upper bound for one Gearsystem savestate without screenshots.
 #define REWIND_MAX_STATE_SIZE       (256 * 1024)
 
-// Absolute hard cap for the ring buffer. Effective capacity is derived from
-// config_rewind (buffer_seconds / frames_per_snapshot) and clamped to this.
-#define REWIND_MAX_SNAPSHOTS        600
+// Snapshots are stored as compressed XOR deltas against the keyframe that
+// opens their group. A new keyframe is taken every REWIND_KEYFRAME_INTERVAL
+// snapshots, so loading any snapshot decodes at most one keyframe and one delta.
+#define REWIND_KEYFRAME_INTERVAL    60
+
+// Hard cap for the compressed ring buffer. Effective capacity is derived from
+// config_rewind (buffer_seconds / frames_per_snapshot); the oldest groups are
+// dropped when the ring reaches this size first.
+#define REWIND_MAX_MEMORY           (64 * 1024 * 1024)
+
+// Snapshots don't carry a screenshot. Seeking emulates the next frame to
+// draw it, and this many recently shown frames are kept for scrubbing.
+#define REWIND_FRAME_CACHE_SIZE     16
 
 EXTERN bool rewind_init(void);
 EXTERN void rewind_destroy(void);
 EXTERN void rewind_reset(void);
 EXTERN void rewind_push(void);
-EXTERN bool rewind_pop(void);
+EXTERN bool rewind_pop(int steps);
 EXTERN bool rewind_seek(int age);
 EXTERN void rewind_commit_seek(void);
 EXTERN void rewind_set_active(bool a);
@@ -17,31 +17,78 @@
  *
  */
 
+#include <string>
+#include <vector>
 #include "emu.h"
 #include "config.h"
 #include "gearsystem.h"
+#include "Input.h"
 
 #define RUNAHEAD_IMPORT
 #include "runahead.h"
 
 static u8* runahead_buffer = NULL;
-static s16* runahead_audio = NULL;
 static size_t runahead_buffer_size = 0;
 
+// Second instance mode: a speculative core that mirrors the primary one
+static GearsystemCore* secondary = NULL;
+static bool secondary_unavailable = false;
+static u64 secondary_presented_frame = 0;
+static Cartridge::ForceConfiguration secondary_config;
+static std::vector<std::string> secondary_cheats;
+
 static bool ensure_buffer(void);
+static bool speculate_rollback(GearsystemCore* core, int frames, u8* frame_buffer);
+static bool speculate_second_instance(GearsystemCore* core, int frames, u8* frame_buffer);
+static bool sync_secondary(GearsystemCore* core);
+static bool create_secondary(GearsystemCore* core);
+static void sync_secondary_settings(GearsystemCore* core);
 
 void runahead_init(void)
 {
-    runahead_audio = new s16[GS_AUDIO_BUFFER_SIZE];
     runahead_buffer = NULL;
     runahead_buffer_size = 0;
+    secondary = NULL;
+    secondary_unavailable = false;
+    secondary_presented_frame = 0;
+    secondary_config.type = Cartridge::CartridgeNotSupported;
+    secondary_config.zone = Cartridge::CartridgeUnknownZone;
+    secondary_config.region = Cartridge::CartridgeUnknownRegion;
+    secondary_config.system = Cartridge::CartridgeUnknownSystem;
+    secondary_cheats.clear();
 }
 
 void runahead_destroy(void)
 {
-    SafeDeleteArray(runahead_audio);
+    SafeDelete(secondary);
     SafeDeleteArray(runahead_buffer);
     runahead_buffer_size = 0;
+    secondary_cheats.clear();
+}
+
+void runahead_reset(Cartridge::ForceConfiguration config)
+{
+    // The secondary instance is rebuilt from the new media on the next frame
+    SafeDelete(secondary);
+    secondary_unavailable = false;
+    secondary_config = config;
+    secondary_cheats.clear();
+}
+
+void runahead_add_cheat(const char* cheat)
+{
+    secondary_cheats.push_back(cheat);
+
+    if (IsValidPointer(secondary))
+        secondary->SetCheat(cheat);
+}
+
+void runahead_clear_cheats(void)
+{
+    secondary_cheats.clear();
+
+    if (IsValidPointer(secondary))
+        secondary->ClearCheats();
 }
 
 int runahead_get_frames(void)
@@ -54,18 +101,31 @@ int runahead_get_frames(void)
     return frames;
 }
 
-void runahead_run(int frames, u8* frame_buffer, s16* sample_buffer, int* sample_count)
+bool runahead_run(int frames, u8* frame_buffer, s16* sample_buffer, int* sample_count)
 {
     GearsystemCore* core = emu_get_core();
 
     // Run the authoritative frame, keeping its audio while the real state advances.
     core->RunToVBlank(frame_buffer, sample_buffer, sample_count, NULL, false);
 
+    if (config_emulator.runahead_second_instance && !secondary_unavailable)
+    {
+        if (sync_secondary(core))
+            return speculate_second_instance(core, frames, frame_buffer);
+    }
+    else if (!config_emulator.runahead_second_instance)
+        SafeDelete(secondary);
+
+    return speculate_rollback(core, frames, frame_buffer);
+}
+
+static bool speculate_rollback(GearsystemCore* core, int frames, u8* frame_buffer)
+{
     // Allocate the reusable snapshot buffer on first use.
     if (!IsValidPointer(runahead_buffer) && !ensure_buffer())
     {
         core->RenderFrameBuffer(frame_buffer);
-        return;
+        return core->IsFrameDirty();
     }
 
     size_t saved_size = runahead_buffer_size;
@@ -75,18 +135,19 @@ void runahead_run(int frames, u8* frame_buffer, s16* sample_buffer, int* sample_
         // frame; later frames reuse the larger buffer.
         ensure_buffer();
         core->RenderFrameBuffer(frame_buffer);
-        return;
+        return core->IsFrameDirty();
     }
 
-    // Run the speculative frames with the same input, discarding their audio
-    // and keeping only the last rendered frame.
+    // Run the speculative frames with the same input and keep only the last
+    // rendered frame. Their audio is never heard, so none is synthesized.
     for (int i = 0; i < frames; i++)
     {
-        int discarded_samples = 0;
         bool render = (i == (frames - 1));
-        core->RunToVBlank(frame_buffer, runahead_audio, &discarded_samples, NULL, render);
+        core->RunToVBlank(frame_buffer, NULL, NULL, NULL, render);
     }
 
+    bool dirty = core->IsFrameDirty();
+
     // Roll back to the authoritative frame. If restoring ever fails, the
     // authoritative state is unrecoverable, so keep the (valid) speculative
     // state as the new timeline and disable run-ahead. Emulation continues
@@ -96,6 +157,132 @@ void runahead_run(int frames, u8* frame_buffer, s16* sample_buffer, int* sample_
         Log("Run-ahead: failed to restore state, disabling run-ahead");
         config_emulator.runahead = 0;
     }
+
+    return dirty;
+}
+
+static bool speculate_second_instance(GearsystemCore* core, int frames, u8* frame_buffer)
+{
+    // Whatever was presented since the last speculative frame did not come
+    // from the secondary instance, so its frame cache no longer matches the
+    // output buffer.
+    if (secondary_presented_frame + 1 != emu_frame_counter)
+        secondary->GetVideo()->InvalidateFrameCache();
+
+    // The primary instance never rolls back. Only the secondary one runs
+    // ahead, silently, and renders the presented frame.
+    for (int i = 0; i < frames; i++)
+    {
+        bool render = (i == (frames - 1));
+        secondary->RunToVBlank(frame_buffer, NULL, NULL, NULL, render);
+    }
+
+    // The primary instance did not render this frame
+    core->GetVideo()->InvalidateFrameCache();
+    secondary_presented_frame = emu_frame_counter;
+
+    return secondary->IsFrameDirty();
+}
+
+static bool sync_secondary(GearsystemCore* core)
+{
+    if (IsValidPointer(secondary) && (secondary->GetCartridge()->GetCRC() != core->GetCartridge()->GetCRC()))
+        SafeDelete(secondary);
+
+    if (!IsValidPointer(secondary) && !create_secondary(core))
+        return false;
+
+    if (!IsValidPointer(runahead_buffer) && !ensure_buffer())
+        return false;
+
+    size_t saved_size = runahead_buffer_size;
+    if (!core->SaveState(runahead_buffer, saved_size, false))
+    {
+        ensure_buffer();
+        return false;
+    }
+
+    // The secondary instance is only ever a copy, so a state it cannot take
+    // means it does not mirror the primary one. Fall back to rolling back the
+    // primary instance until the media changes.
+    if (!secondary->LoadState(runahead_buffer, saved_size))
+    {
+        Log("Run-ahead: second instance out of sync, using single instance");
+        SafeDelete(secondary);
+        secondary_unavailable = true;
+        return false;
+    }
+
+    sync_secondary_settings(core);
+    return true;
+}
+
+static bool create_secondary(GearsystemCore* core)
+{
+    Cartridge* cartridge = core->GetCartridge();
+
+    if (!cartridge->IsReady())
+        return false;
+
+    GearsystemCore* instance = new (std::nothrow) GearsystemCore();
+    if (!IsValidPointer(instance))
+    {
+        secondary_unavailable = true;
+        return false;
+    }
+
+    instance->Init();
+
+    // The bootrom rule is part of the savestate, so the same bootrom must be
+    // mapped in both instances.
+    Memory* memory = core->GetMemory();
+    if (memory->IsBootromEnabled())
+    {
+        bool gg = cartridge->IsGameGear();
+        instance->GetMemory()->LoadBootromFromBuffer(memory->GetBootrom(), memory->GetBootromSize(), gg);
+        instance->GetMemory()->EnableBootromSMS(!gg);
+        instance->GetMemory()->EnableBootromGG(gg);
+    }
+
+    // Load the pristine media so cheats are applied exactly once
+    bool loaded = (strlen(cartridge->GetFilePath()) > 0) ?
+            instance->LoadROM(cartridge->GetFilePath(), &secondary_config) :
+            instance->LoadROMFromBuffer(cartridge->GetROM(), cartridge->GetROMSize(), &secondary_config);
+
+    if (!loaded || (instance->GetCartridge()->GetCRC() != cartridge->GetCRC()))
+    {
+        Log("Run-ahead: failed to create second instance, using single instance");
+        SafeDelete(instance);
+        secondary_unavailable = true;
+        return false;
+    }
+
+    for (size_t i = 0; i < secondary_cheats.size(); i++)
+        instance->SetCheat(secondary_cheats[i].c_str());
+
+    secondary = instance;
+    return true;
+}
+
+static void sync_secondary_settings(GearsystemCore* core)
+{
+    // Settings that shape the speculative frames but are not part of a
+    // savestate. They are cheap to copy, so they are mirrored every frame.
+    Video* video = core->GetVideo();
+    Video* secondary_video = secondary->GetVideo();
+
+    secondary_video->SetOverscan(video->GetOverscan());
+    secondary_video->SetHideLeftBar(video->GetHideLeftBar());
+    secondary_video->SetNoSpriteLimit(video->IsNoSpriteLimit());
+    secondary_video->SetLightPhaserCrosshair(video->IsLightPhaserCrosshair(), video->GetLightPhaserCrosshairShape(), video->GetLightPhaserCrosshairColor());
+    secondary_video->SetThreadedRendering(video->IsThreadedRendering());
+
+    Input::stPhaser* offset = core->GetInput()->GetPhaserOffset();
+    secondary->SetPhaserOffset(offset->x, offset->y);
+    secondary->SetGlassesConfig(core->GetGlassesConfig());
+
+    if (secondary->GetAudio()->IsYM2413Disabled() != core->GetAudio()->IsYM2413Disabled())
+        secondary->GetAudio()->DisableYM2413(core->GetAudio()->IsYM2413Disabled());
 }
 
 static bool ensure_buffer(void)
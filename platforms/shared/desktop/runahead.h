@@ -30,8 +30,11 @@
 
 EXTERN void runahead_init(void);
 EXTERN void runahead_destroy(void);
+EXTERN void runahead_reset(Cartridge::ForceConfiguration config);
+EXTERN void runahead_add_cheat(const char* cheat);
+EXTERN void runahead_clear_cheats(void);
 EXTERN int runahead_get_frames(void);
-EXTERN void runahead_run(int frames, u8* frame_buffer, s16* sample_buffer, int* sample_count);
+EXTERN bool runahead_run(int frames, u8* frame_buffer, s16* sample_buffer, int* sample_count);
 
 #undef RUNAHEAD_IMPORT
 #undef EXTERN
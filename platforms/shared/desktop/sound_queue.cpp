@@ -18,6 +18,8 @@
  */
 
 #include <string>
+#include <atomic>
+#include <math.h>
 #define SOUND_QUEUE_IMPORT
 #include "sound_queue.h"
 #include "utils.h"
@@ -25,12 +27,31 @@
 #define SOUND_QUEUE_DEBUG(...) { }
 //#define SOUND_QUEUE_DEBUG(x, ...) Debug(x, ## __VA_ARGS__)
 
+// Samples, power of two
+#define SOUND_QUEUE_RING_SIZE 16384
+#define SOUND_QUEUE_RING_MASK (SOUND_QUEUE_RING_SIZE - 1)
+#define SOUND_QUEUE_MAX_RATIO_DELTA 0.005f
+#define SOUND_QUEUE_FILL_SMOOTHING 0.05f
+
 static SDL_AudioStream* sound_queue_stream;
 static bool sound_queue_sound_open;
-static int sound_queue_max_queued_bytes;
+static int sound_queue_capacity;
+static int sound_queue_target;
 static int sound_queue_buffer_size;
-static int sound_queue_bytes_per_second;
-
+static int sound_queue_samples_per_second;
+static float sound_queue_fill;
+static float sound_queue_ratio;
+
+// Single producer (emulation thread), single consumer (SDL audio thread)
+static s16 sound_queue_ring[SOUND_QUEUE_RING_SIZE];
+static std::atomic<u32> sound_queue_ring_read;
+static std::atomic<u32> sound_queue_ring_write;
+static std::atomic<u32> sound_queue_underruns;
+static std::atomic<u32> sound_queue_overruns;
+
+static void SDLCALL sound_queue_callback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount);
+static int sound_queue_ring_count(void);
+static void sound_queue_update_rate(int queued);
 static bool is_running_in_wsl(void);
 
 void sound_queue_init(void)
@@ -91,8 +112,15 @@ bool sound_queue_start(int sample_rate, int channel_count, int buffer_size, int
     Debug("Sound Queue: Starting with %d Hz, %d channels, %d buffer size, %d buffers ...", sample_rate, channel_count, buffer_size, buffer_count);
 
     sound_queue_buffer_size = buffer_size;
-    sound_queue_max_queued_bytes = buffer_size * buffer_count * (int)sizeof(s16);
-    sound_queue_bytes_per_second = sample_rate * channel_count * (int)sizeof(s16);
+    sound_queue_capacity = MIN(buffer_size * buffer_count, SOUND_QUEUE_RING_SIZE);
+    sound_queue_target = sound_queue_capacity / 2;
+    sound_queue_samples_per_second = sample_rate * channel_count;
+    sound_queue_fill = 0.5f;
+    sound_queue_ratio = 1.0f;
+    sound_queue_ring_read.store(0);
+    sound_queue_ring_write.store(0);
+    sound_queue_underruns.store(0);
+    sound_queue_overruns.store(0);
 
     SDL_AudioSpec spec;
     spec.freq = sample_rate;
@@ -101,7 +129,7 @@ bool sound_queue_start(int sample_rate, int channel_count, int buffer_size, int
 
     Debug("Sound Queue: Spec - frequency: %d format: 0x%04X channels: %d", spec.freq, spec.format, spec.channels);
 
-    sound_queue_stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, NULL, NULL);
+    sound_queue_stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, sound_queue_callback, NULL);
 
     if (!sound_queue_stream)
     {
@@ -135,11 +163,37 @@ void sound_queue_stop(void)
     }
 }
 
+int sound_queue_get_device_sample_rate(void)
+{
+    SDL_AudioSpec spec;
+
+    if (!SDL_GetAudioDeviceFormat(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, NULL))
+    {
+        SDL_ERROR("SDL_GetAudioDeviceFormat");
+        return 0;
+    }
+
+    Debug("Sound Queue: Default device frequency: %d", spec.freq);
+
+    return spec.freq;
+}
+
 int sound_queue_get_sample_count(void)
 {
     if (!sound_queue_stream)
         return 0;
-    return SDL_GetAudioStreamQueued(sound_queue_stream) / (int)sizeof(s16);
+    return sound_queue_ring_count() + (SDL_GetAudioStreamQueued(sound_queue_stream) / (int)sizeof(s16));
+}
+
+void sound_queue_get_stats(SoundQueueStats* stats)
+{
+    stats->queued_samples = sound_queue_sound_open ? sound_queue_ring_count() : 0;
+    stats->capacity_samples = sound_queue_capacity;
+    stats->latency_ms = (sound_queue_samples_per_second > 0) ? (stats->queued_samples * 1000.0f) / sound_queue_samples_per_second : 0.0f;
+    stats->fill = sound_queue_fill;
+    stats->ratio = sound_queue_ratio;
+    stats->underruns = sound_queue_underruns.load(std::memory_order_relaxed);
+    stats->overruns = sound_queue_overruns.load(std::memory_order_relaxed);
 }
 
 bool sound_queue_is_open(void)
@@ -152,41 +206,111 @@ void sound_queue_write(s16* samples, int count, bool sync)
     if (!sound_queue_sound_open || !sound_queue_stream)
         return;
 
-    int bytes = count * (int)sizeof(s16);
-    int queued = SDL_GetAudioStreamQueued(sound_queue_stream);
-
     if (count > sound_queue_buffer_size)
     {
         Log("Sound Queue: Write exceeds queue buffer size (%d > %d)", count, sound_queue_buffer_size);
     }
 
+    int queued = sound_queue_ring_count();
+
     if (queued == 0)
     {
         SOUND_QUEUE_DEBUG("Sound Queue: Underrun detected, queue was empty");
     }
 
-    if (sync)
+    if (sync && (queued > sound_queue_target))
     {
-        int room = sound_queue_max_queued_bytes - queued;
-        if (room < bytes)
-        {
-            SOUND_QUEUE_DEBUG("Sound Queue: Sync wait, need %d bytes but only %d free (queued %d, max %d)", bytes, room, queued, sound_queue_max_queued_bytes);
-            int needed = bytes - room;
-            int wait_ms = (needed * 1000) / sound_queue_bytes_per_second;
-            if (wait_ms >= 1)
-                SDL_Delay(wait_ms);
-        }
+        // Without vsync the audio device paces the emulator. Wait until the
+        // consumer brings the queue back to the target level.
+        int wait_ms = ((queued - sound_queue_target) * 1000) / sound_queue_samples_per_second;
+        SOUND_QUEUE_DEBUG("Sound Queue: Sync wait %d ms (queued %d, target %d)", wait_ms, queued, sound_queue_target);
+        if (wait_ms >= 1)
+            SDL_Delay(wait_ms);
+        queued = sound_queue_ring_count();
+    }
+
+    sound_queue_update_rate(queued);
+
+    if (count > (sound_queue_capacity - queued))
+    {
+        SOUND_QUEUE_DEBUG("Sound Queue: Overrun, dropping frame (queued %d, capacity %d)", queued, sound_queue_capacity);
+        sound_queue_overruns.fetch_add(1, std::memory_order_relaxed);
+        return;
     }
-    else
+
+    u32 write = sound_queue_ring_write.load(std::memory_order_relaxed);
+    int offset = (int)(write & SOUND_QUEUE_RING_MASK);
+    int first = MIN(count, SOUND_QUEUE_RING_SIZE - offset);
+
+    memcpy(&sound_queue_ring[offset], samples, first * sizeof(s16));
+    memcpy(sound_queue_ring, samples + first, (count - first) * sizeof(s16));
+
+    sound_queue_ring_write.store(write + count, std::memory_order_release);
+}
+
+static void SDLCALL sound_queue_callback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount)
+{
+    UNUSED(userdata);
+    UNUSED(total_amount);
+
+    int needed = additional_amount / (int)sizeof(s16);
+
+    while (needed > 0)
     {
-        if (queued >= sound_queue_max_queued_bytes)
+        u32 read = sound_queue_ring_read.load(std::memory_order_relaxed);
+        u32 write = sound_queue_ring_write.load(std::memory_order_acquire);
+        int available = (int)(write - read);
+
+        if (available <= 0)
         {
-            SOUND_QUEUE_DEBUG("Sound Queue: Async overrun, dropping frame (queued %d >= max %d)", queued, sound_queue_max_queued_bytes);
-            return;
+            static const s16 silence[256] = { };
+
+            // Running dry before the first write is just the startup
+            if (write != 0)
+                sound_queue_underruns.fetch_add(1, std::memory_order_relaxed);
+
+            while (needed > 0)
+            {
+                int n = MIN(needed, 256);
+                SDL_PutAudioStreamData(stream, silence, n * (int)sizeof(s16));
+                needed -= n;
+            }
+            break;
         }
+
+        int offset = (int)(read & SOUND_QUEUE_RING_MASK);
+        int n = MIN(MIN(needed, available), SOUND_QUEUE_RING_SIZE - offset);
+
+        SDL_PutAudioStreamData(stream, &sound_queue_ring[offset], n * (int)sizeof(s16));
+        sound_queue_ring_read.store(read + n, std::memory_order_release);
+        needed -= n;
     }
+}
+
+static int sound_queue_ring_count(void)
+{
+    u32 write = sound_queue_ring_write.load(std::memory_order_acquire);
+    u32 read = sound_queue_ring_read.load(std::memory_order_acquire);
+    return (int)(write - read);
+}
+
+static void sound_queue_update_rate(int queued)
+{
+    // Dynamic rate control: consume slightly faster above the target fill
+    // and slightly slower below it, so the queue settles around the target
+    // without blocking the emulation thread when vsync drives the timing
+    float fill = (float)queued / (float)sound_queue_capacity;
+    sound_queue_fill += (fill - sound_queue_fill) * SOUND_QUEUE_FILL_SMOOTHING;
+
+    float target = (float)sound_queue_target / (float)sound_queue_capacity;
+    float ratio = 1.0f + (((sound_queue_fill - target) / target) * SOUND_QUEUE_MAX_RATIO_DELTA);
+    ratio = CLAMP(ratio, 1.0f - SOUND_QUEUE_MAX_RATIO_DELTA, 1.0f + SOUND_QUEUE_MAX_RATIO_DELTA);
+
+    if (fabsf(ratio - sound_queue_ratio) < 0.0001f)
+        return;
 
-    SDL_PutAudioStreamData(sound_queue_stream, samples, bytes);
+    if (SDL_SetAudioStreamFrequencyRatio(sound_queue_stream, ratio))
+        sound_queue_ratio = ratio;
 }
 
 static bool is_running_in_wsl(void)
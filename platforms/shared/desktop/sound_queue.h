@@ -30,13 +30,26 @@
     #define EXTERN extern
 #endif
 
+struct SoundQueueStats
+{
+    int queued_samples;
+    int capacity_samples;
+    float latency_ms;
+    float fill;
+    float ratio;
+    u32 underruns;
+    u32 overruns;
+};
+
 EXTERN void sound_queue_init(void);
 EXTERN void sound_queue_destroy(void);
 EXTERN bool sound_queue_start(int sample_rate, int channel_count, int buffer_size = GS_AUDIO_QUEUE_SIZE, int buffer_count = 3);
 EXTERN void sound_queue_stop(void);
+EXTERN int sound_queue_get_device_sample_rate(void);
 EXTERN void sound_queue_write(s16* samples, int count, bool sync);
 EXTERN int sound_queue_get_sample_count(void);
 EXTERN bool sound_queue_is_open(void);
+EXTERN void sound_queue_get_stats(SoundQueueStats* stats);
 
 #undef SOUND_QUEUE_IMPORT
 #undef EXTERN
@@ -21,6 +21,12 @@
 #include "Memory.h"
 #include "Cartridge.h"
 
+#if defined(GS_SSE2)
+#include <emmintrin.h>
+#elif defined(GS_NEON)
+#include <arm_neon.h>
+#endif
+
 Audio::Audio(Cartridge * pCartridge)
 {
     m_pCartridge = pCartridge;
@@ -38,14 +44,20 @@ Audio::Audio(Cartridge * pCartridge)
     m_bYM2413ForceDisabled = false;
     m_bYM2413CartridgeNotSupported = false;
     m_bMute = false;
+    m_bOutputEnabled = true;
+    m_bOutputStale = false;
     m_master_volume = 1.0f;
     m_psg_volume = 1.0f;
     m_fm_volume = 1.0f;
+    InitPointer(m_pAlignBuffer);
+    UpdateMixerGains();
     m_bVgmRecordingEnabled = false;
+    m_bSilentReplay = false;
     for (int i = 0; i < 4; i++)
     {
         InitPointer(m_pDebugChannelBuffer[i]);
         m_iDebugChannelSamples[i] = 0;
+        m_bDebugChannelReady[i] = false;
     }
 }
 
@@ -127,12 +139,14 @@ Audio::~Audio()
     SafeDelete(m_pBuffer);
     SafeDeleteArray(m_pSampleBuffer);
     SafeDeleteArray(m_pYM2413Buffer);
+    SafeDeleteArray(m_pAlignBuffer);
     for (int i = 0; i < 4; i++)
         SafeDeleteArray(m_pDebugChannelBuffer[i]);
 }
 
-void Audio::Init()
+void Audio::Init(int sampleRate)
 {
+    m_iSampleRate = CLAMP(sampleRate, GS_AUDIO_SAMPLE_RATE_MIN, GS_AUDIO_SAMPLE_RATE_MAX);
     m_pSampleBuffer = new blip_sample_t[GS_AUDIO_BUFFER_SIZE];
 
     m_pApu = new Sms_Apu();
@@ -145,9 +159,10 @@ void Audio::Init()
     //m_pApu->treble_eq(-15.0);
 
     m_pYM2413Buffer = new s16[GS_AUDIO_BUFFER_SIZE];
+    m_pAlignBuffer = new s16[GS_AUDIO_BUFFER_SIZE];
 
     m_pYM2413 = new YM2413();
-    m_pYM2413->Init(m_bPAL ? (m_pCartridge->IsSG1000() ? GS_MASTER_CLOCK_PAL_SG1000 : GS_MASTER_CLOCK_PAL) : GS_MASTER_CLOCK_NTSC);
+    m_pYM2413->Init(m_bPAL ? (m_pCartridge->IsSG1000() ? GS_MASTER_CLOCK_PAL_SG1000 : GS_MASTER_CLOCK_PAL) : GS_MASTER_CLOCK_NTSC, m_iSampleRate);
 
     for (int i = 0; i < 4; i++)
         m_pDebugChannelBuffer[i] = new blip_sample_t[GS_AUDIO_BUFFER_SIZE];
@@ -162,6 +177,7 @@ void Audio::Reset(bool bPAL)
     m_pApu->reset(m_pCartridge->IsSG1000() && !m_pCartridge->IsSG1000II());
     m_pApu->volume(1.0);
     m_pBuffer->clear();
+    m_bOutputStale = false;
     m_pBuffer->clock_rate(m_bPAL ? (m_pCartridge->IsSG1000() ? GS_MASTER_CLOCK_PAL_SG1000 : GS_MASTER_CLOCK_PAL) : GS_MASTER_CLOCK_NTSC);
     m_pYM2413->Reset(m_bPAL ? (m_pCartridge->IsSG1000() ? GS_MASTER_CLOCK_PAL_SG1000 : GS_MASTER_CLOCK_PAL) : GS_MASTER_CLOCK_NTSC);
     m_ElapsedCycles = 0;
@@ -178,6 +194,72 @@ void Audio::Mute(bool bMute)
     m_bMute = bMute;
 }
 
+void Audio::SetOutputEnabled(bool bEnabled)
+{
+    // With the output disabled both chips keep their state in step with
+    // the CPU but nothing is synthesized, for frames that are never heard
+    if (bEnabled == m_bOutputEnabled)
+        return;
+
+    m_bOutputEnabled = bEnabled;
+    m_pApu->enable_synthesis(bEnabled);
+    m_pYM2413->SetOutputEnabled(bEnabled);
+
+    if (!bEnabled)
+        m_bOutputStale = true;
+    else if (m_bOutputStale)
+    {
+        // Unless a savestate restored it, the resampler is out of step
+        m_pBuffer->clear();
+        m_pApu->restart_output();
+        m_bOutputStale = false;
+    }
+}
+
+bool Audio::IsOutputEnabled() const
+{
+    return m_bOutputEnabled;
+}
+
+// Frames emulated again only to draw a picture already went to the VGM
+// file the first time, so their register writes are not recorded twice
+void Audio::SetSilentReplay(bool bSilent)
+{
+    m_bSilentReplay = bSilent;
+}
+
+void Audio::SetSampleRate(int sampleRate)
+{
+    // The frame buffers hold one frame of stereo samples, which limits the
+    // highest rate that can be synthesized
+    sampleRate = CLAMP(sampleRate, GS_AUDIO_SAMPLE_RATE_MIN, GS_AUDIO_SAMPLE_RATE_MAX);
+
+    if (sampleRate == m_iSampleRate)
+        return;
+
+    m_iSampleRate = sampleRate;
+
+    if (!IsValidPointer(m_pBuffer))
+        return;
+
+    Log("Audio: Output sample rate set to %d Hz", m_iSampleRate);
+
+    if (m_AudioRecorder.IsRecording())
+    {
+        Log("Audio: Sample rate changed, stopping audio recording");
+        m_AudioRecorder.Stop();
+    }
+
+    m_pBuffer->set_sample_rate(m_iSampleRate);
+    m_pYM2413->SetSampleRate(m_iSampleRate);
+
+    if (m_pApu->is_debug_enabled())
+    {
+        long clock = m_bPAL ? (m_pCartridge->IsSG1000() ? GS_MASTER_CLOCK_PAL_SG1000 : GS_MASTER_CLOCK_PAL) : GS_MASTER_CLOCK_NTSC;
+        m_pApu->init_debug_buffers(m_iSampleRate, clock);
+    }
+}
+
 bool Audio::IsYM2413OutputEnabled() const
 {
     return m_bYM2413Enabled && !m_bYM2413ForceDisabled && !m_bYM2413CartridgeNotSupported;
@@ -198,16 +280,24 @@ void Audio::SyncYM2413State()
 void Audio::EndFrame(s16* pSampleBuffer, int* pSampleCount)
 {
     m_pApu->end_frame(m_ElapsedCycles);
-    m_pBuffer->end_frame(m_ElapsedCycles);
 
-    int psg_count = static_cast<int>(m_pBuffer->read_samples(m_pSampleBuffer, GS_AUDIO_BUFFER_SIZE));
+    // Channel waveforms are only synthesized when the debugger asks for them
+    for (int i = 0; i < 4; i++)
+        m_bDebugChannelReady[i] = false;
 
-    if (m_pApu->is_debug_enabled())
+    if (!m_bOutputEnabled)
     {
-        for (int i = 0; i < 4; i++)
-            m_pApu->read_debug_samples(m_pDebugChannelBuffer[i], i, GS_AUDIO_BUFFER_SIZE, &m_iDebugChannelSamples[i]);
+        m_pYM2413->EndFrame(NULL);
+        if (IsValidPointer(pSampleCount))
+            *pSampleCount = 0;
+        m_ElapsedCycles = 0;
+        return;
     }
 
+    m_pBuffer->end_frame(m_ElapsedCycles);
+
+    int psg_count = static_cast<int>(m_pBuffer->read_samples(m_pSampleBuffer, GS_AUDIO_BUFFER_SIZE));
+
     int fm_count = m_pYM2413->EndFrame(m_pYM2413Buffer);
 
     if (IsValidPointer(pSampleBuffer) && IsValidPointer(pSampleCount))
@@ -221,32 +311,132 @@ void Audio::EndFrame(s16* pSampleBuffer, int* pSampleCount)
         {
             memset(pSampleBuffer, 0, sizeof(s16) * count);
         }
-        else if (m_bPSGEnabled && !ym2413_output_enabled && m_master_volume == 1.0f && m_psg_volume == 1.0f)
+        else
         {
-            memcpy(pSampleBuffer, m_pSampleBuffer, sizeof(s16) * psg_count);
+            const s16* psg = (m_bPSGEnabled && (psg_count > 0)) ? AlignPSGSamples(psg_count, count) : NULL;
+            const s16* fm = ym2413_output_enabled ? m_pYM2413Buffer : NULL;
+            MixSamples(pSampleBuffer, psg, m_iPSGGain, fm, m_iFMGain, count);
         }
-        else
+
+#ifndef GS_DISABLE_AUDIORECORDER
+        if (m_AudioRecorder.IsRecording())
+            m_AudioRecorder.PushSamples(pSampleBuffer, count);
+#endif
+    }
+
+    m_ElapsedCycles = 0;
+}
+
+void Audio::UpdateMixerGains()
+{
+    // Master volume is folded into both gains. Each volume is in the 0..2
+    // range so the products fit a signed 16 bit Q3.12 value.
+    m_iPSGGain = (s16)((m_psg_volume * m_master_volume * (1 << GS_AUDIO_GAIN_SHIFT)) + 0.5f);
+    m_iFMGain = (s16)((m_fm_volume * m_master_volume * (1 << GS_AUDIO_GAIN_SHIFT)) + 0.5f);
+}
+
+const s16* Audio::AlignPSGSamples(int psg_count, int count)
+{
+    if (psg_count == count)
+        return m_pSampleBuffer;
+
+    // Both streams are interleaved stereo. Stretch the PSG frames over the
+    // FM frames with linear interpolation, 16.16 source position.
+    int src_frames = psg_count >> 1;
+    int dst_frames = count >> 1;
+
+    if ((src_frames <= 0) || (dst_frames <= 0))
+    {
+        memset(m_pAlignBuffer, 0, sizeof(s16) * count);
+        return m_pAlignBuffer;
+    }
+
+    u32 step = ((u32)src_frames << 16) / (u32)dst_frames;
+    u32 pos = 0;
+
+    for (int i = 0; i < dst_frames; i++)
+    {
+        int index = pos >> 16;
+        int next = MIN(index + 1, src_frames - 1);
+        s32 frac = (pos >> 1) & 0x7FFF;
+
+        for (int c = 0; c < 2; c++)
         {
-            for (int i=0; i<count; i++)
-            {
-                s32 mix = 0;
+            s32 a = m_pSampleBuffer[(index << 1) + c];
+            s32 b = m_pSampleBuffer[(next << 1) + c];
+            m_pAlignBuffer[(i << 1) + c] = (s16)(a + (((b - a) * frac) >> 15));
+        }
+
+        pos += step;
+    }
 
-                mix += (m_bPSGEnabled && psg_count > 0) ? (s32)(m_pSampleBuffer[(i >= psg_count) ? psg_count-1 : i] * m_psg_volume) : 0;
-                mix += ym2413_output_enabled ? (s32)(m_pYM2413Buffer[i] * m_fm_volume) : 0;
-                mix = (s32)((float)mix * m_master_volume);
+    if (count & 1)
+        m_pAlignBuffer[count - 1] = m_pAlignBuffer[MAX(count - 2, 0)];
 
-                if (mix > 32767)
-                    mix = 32767;
-                else if (mix < -32768)
-                    mix = -32768;
+    return m_pAlignBuffer;
+}
+
+void Audio::MixSamples(s16* pOut, const s16* pPSG, s16 psgGain, const s16* pFM, s16 fmGain, int count)
+{
+    if (!IsValidPointer(pPSG) && !IsValidPointer(pFM))
+    {
+        memset(pOut, 0, sizeof(s16) * count);
+        return;
+    }
 
-                pSampleBuffer[i] = (s16)mix;
-            }
+    if (!IsValidPointer(pFM))
+    {
+        if (psgGain == (1 << GS_AUDIO_GAIN_SHIFT))
+        {
+            memcpy(pOut, pPSG, sizeof(s16) * count);
+            return;
         }
 
+        // A missing source is read from the other one with zero gain
+        pFM = pPSG;
+        fmGain = 0;
+    }
+    else if (!IsValidPointer(pPSG))
+    {
+        pPSG = pFM;
+        psgGain = 0;
     }
 
-    m_ElapsedCycles = 0;
+    int i = 0;
+
+#if defined(GS_SSE2)
+    const __m128i gains = _mm_set1_epi32((s32)((u32)(u16)psgGain | ((u32)(u16)fmGain << 16)));
+    const __m128i rounding = _mm_set1_epi32(1 << (GS_AUDIO_GAIN_SHIFT - 1));
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i psg = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPSG + i));
+        __m128i fm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pFM + i));
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(psg, fm), gains);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(psg, fm), gains);
+        lo = _mm_srai_epi32(_mm_add_epi32(lo, rounding), GS_AUDIO_GAIN_SHIFT);
+        hi = _mm_srai_epi32(_mm_add_epi32(hi, rounding), GS_AUDIO_GAIN_SHIFT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + i), _mm_packs_epi32(lo, hi));
+    }
+#elif defined(GS_NEON)
+    for (; i + 8 <= count; i += 8)
+    {
+        int16x8_t psg = vld1q_s16(pPSG + i);
+        int16x8_t fm = vld1q_s16(pFM + i);
+        int32x4_t lo = vmull_n_s16(vget_low_s16(psg), psgGain);
+        int32x4_t hi = vmull_n_s16(vget_high_s16(psg), psgGain);
+        lo = vmlal_n_s16(lo, vget_low_s16(fm), fmGain);
+        hi = vmlal_n_s16(hi, vget_high_s16(fm), fmGain);
+        vst1q_s16(pOut + i, vcombine_s16(vqrshrn_n_s32(lo, GS_AUDIO_GAIN_SHIFT), vqrshrn_n_s32(hi, GS_AUDIO_GAIN_SHIFT)));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        s32 mix = (pPSG[i] * psgGain) + (pFM[i] * fmGain);
+        mix = (mix + (1 << (GS_AUDIO_GAIN_SHIFT - 1))) >> GS_AUDIO_GAIN_SHIFT;
+        pOut[i] = (s16)CLAMP(mix, -32768, 32767);
+    }
 }
 
 void Audio::DisableYM2413(bool bDisable)
@@ -255,29 +445,51 @@ void Audio::DisableYM2413(bool bDisable)
     SyncYM2413State();
 }
 
-void Audio::SaveState(std::ostream& stream)
+bool Audio::IsYM2413Disabled() const
+{
+    return m_bYM2413ForceDisabled;
+}
+
+void Audio::SaveState(state_writer& stream)
 {
     using namespace std;
 
+    // The output buffers are refilled on every EndFrame
+    bool buffers = !stream.compact();
+
+    stream.section(GS_State_Section_Audio);
     stream.write(reinterpret_cast<const char*> (&m_ElapsedCycles), sizeof(m_ElapsedCycles));
-    stream.write(reinterpret_cast<const char*> (m_pSampleBuffer), sizeof(blip_sample_t) * GS_AUDIO_BUFFER_SIZE);
+    if (buffers)
+        stream.write(reinterpret_cast<const char*> (m_pSampleBuffer), sizeof(blip_sample_t) * GS_AUDIO_BUFFER_SIZE);
     stream.write(reinterpret_cast<const char*> (&m_bYM2413Enabled), sizeof(m_bYM2413Enabled));
     stream.write(reinterpret_cast<const char*> (&m_bPSGEnabled), sizeof(m_bPSGEnabled));
-    stream.write(reinterpret_cast<const char*> (m_pYM2413Buffer), sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
+    if (buffers)
+        stream.write(reinterpret_cast<const char*> (m_pYM2413Buffer), sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
+    stream.section(GS_State_Section_YM2413);
     m_pYM2413->SaveState(stream);
+    stream.section(GS_State_Section_PSG);
     m_pApu->SaveState(stream);
+    stream.section(GS_State_Section_Audio);
     m_pBuffer->SaveState(stream);
 }
 
-void Audio::LoadState(std::istream& stream, int version)
+void Audio::LoadState(state_reader& stream, int version)
 {
     using namespace std;
 
+    bool buffers = !stream.compact();
+
     stream.read(reinterpret_cast<char*> (&m_ElapsedCycles), sizeof(m_ElapsedCycles));
-    stream.read(reinterpret_cast<char*> (m_pSampleBuffer), sizeof(blip_sample_t) * GS_AUDIO_BUFFER_SIZE);
+    if (buffers)
+        stream.read(reinterpret_cast<char*> (m_pSampleBuffer), sizeof(blip_sample_t) * GS_AUDIO_BUFFER_SIZE);
+    else
+        memset(m_pSampleBuffer, 0, sizeof(blip_sample_t) * GS_AUDIO_BUFFER_SIZE);
     stream.read(reinterpret_cast<char*> (&m_bYM2413Enabled), sizeof(m_bYM2413Enabled));
     stream.read(reinterpret_cast<char*> (&m_bPSGEnabled), sizeof(m_bPSGEnabled));
-    stream.read(reinterpret_cast<char*> (m_pYM2413Buffer), sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
+    if (buffers)
+        stream.read(reinterpret_cast<char*> (m_pYM2413Buffer), sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
+    else
+        memset(m_pYM2413Buffer, 0, sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
     m_pYM2413->LoadState(stream);
 
     if (version >= 103)
@@ -296,19 +508,20 @@ void Audio::LoadState(std::istream& stream, int version)
         }
     }
 
+    m_bOutputStale = false;
     SyncYM2413State();
 }
 
-void Audio::LoadStateV1(std::istream& stream)
+void Audio::LoadStateV1(state_reader& stream)
 {
     using namespace std;
 
     stream.read(reinterpret_cast<char*> (&m_ElapsedCycles), sizeof(m_ElapsedCycles));
-    stream.seekg(sizeof(blip_sample_t) * GS_AUDIO_BUFFER_SIZE_V1, ios::cur);
+    stream.skip(sizeof(blip_sample_t) * GS_AUDIO_BUFFER_SIZE_V1);
     memset(m_pSampleBuffer, 0, sizeof(blip_sample_t) * GS_AUDIO_BUFFER_SIZE);
     stream.read(reinterpret_cast<char*> (&m_bYM2413Enabled), sizeof(m_bYM2413Enabled));
     stream.read(reinterpret_cast<char*> (&m_bPSGEnabled), sizeof(m_bPSGEnabled));
-    stream.seekg(sizeof(s16) * GS_AUDIO_BUFFER_SIZE_V1, ios::cur);
+    stream.skip(sizeof(s16) * GS_AUDIO_BUFFER_SIZE_V1);
     memset(m_pYM2413Buffer, 0, sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
     m_pYM2413->LoadStateV1(stream);
 
@@ -321,9 +534,35 @@ void Audio::LoadStateV1(std::istream& stream)
         m_pApu->init_debug_buffers(m_iSampleRate, clock);
     }
 
+    m_bOutputStale = false;
     SyncYM2413State();
 }
 
+blip_sample_t* Audio::GetDebugChannelBuffer(int channel)
+{
+    if (channel < 0 || channel >= 4)
+        return NULL;
+    RenderDebugChannel(channel);
+    return m_pDebugChannelBuffer[channel];
+}
+
+int Audio::GetDebugChannelSamples(int channel)
+{
+    if (channel < 0 || channel >= 4)
+        return 0;
+    RenderDebugChannel(channel);
+    return (int)m_iDebugChannelSamples[channel];
+}
+
+void Audio::RenderDebugChannel(int channel)
+{
+    if (m_bDebugChannelReady[channel])
+        return;
+
+    m_pApu->read_debug_samples(m_pDebugChannelBuffer[channel], channel, GS_AUDIO_BUFFER_SIZE, &m_iDebugChannelSamples[channel]);
+    m_bDebugChannelReady[channel] = true;
+}
+
 bool Audio::StartVgmRecording(const char* file_path, int clock_rate, bool is_pal, bool has_ym2413, const VgmMetadata& metadata)
 {
     if (m_bVgmRecordingEnabled)
@@ -347,3 +586,18 @@ bool Audio::IsVgmRecording() const
 {
     return m_bVgmRecordingEnabled;
 }
+
+bool Audio::StartAudioRecording(const char* file_path)
+{
+    return m_AudioRecorder.Start(file_path, m_iSampleRate, 2);
+}
+
+void Audio::StopAudioRecording()
+{
+    m_AudioRecorder.Stop();
+}
+
+bool Audio::IsAudioRecording() const
+{
+    return m_AudioRecorder.IsRecording();
+}
@@ -21,10 +21,12 @@
 #define	AUDIO_H
 
 #include "definitions.h"
+#include "state_serializer.h"
 #include "audio/Stereo_Buffer.h"
 #include "audio/Sms_Apu.h"
 #include "YM2413.h"
 #include "VgmRecorder.h"
+#include "AudioRecorder.h"
 #include "TraceLogger.h"
 
 class Cartridge;
@@ -34,9 +36,14 @@ class Audio
 public:
     Audio(Cartridge* pCartridge);
     ~Audio();
-    void Init();
+    void Init(int sampleRate = GS_AUDIO_SAMPLE_RATE);
     void Reset(bool bPAL);
     void Mute(bool bMute);
+    void SetOutputEnabled(bool bEnabled);
+    bool IsOutputEnabled() const;
+    void SetSilentReplay(bool bSilent);
+    void SetSampleRate(int sampleRate);
+    int GetSampleRate() const;
     void SetMasterVolume(float volume);
     void SetPSGVolume(float volume);
     void SetFMVolume(float volume);
@@ -48,27 +55,36 @@ public:
     void Tick(unsigned int clockCycles);
     void EndFrame(s16* pSampleBuffer, int* pSampleCount);
     void DisableYM2413(bool bDisable);
+    bool IsYM2413Disabled() const;
     Sms_Apu* GetPSG();
+    YM2413* GetYM2413();
     void EnablePSGDebug(bool enable);
     bool IsPSGDebugEnabled();
     blip_sample_t* GetDebugChannelBuffer(int channel);
     int GetDebugChannelSamples(int channel);
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream, int version);
-    void LoadStateV1(std::istream& stream);
+    void SaveState(state_writer& stream);
+    void LoadState(state_reader& stream, int version);
+    void LoadStateV1(state_reader& stream);
     bool StartVgmRecording(const char* file_path, int clock_rate, bool is_pal, bool has_ym2413, const VgmMetadata& metadata);
     void StopVgmRecording();
     bool IsVgmRecording() const;
+    bool StartAudioRecording(const char* file_path);
+    void StopAudioRecording();
+    bool IsAudioRecording() const;
 
 private:
     bool IsYM2413OutputEnabled() const;
     void SyncYM2413State();
+    void UpdateMixerGains();
+    const s16* AlignPSGSamples(int psg_count, int count);
+    static void MixSamples(s16* pOut, const s16* pPSG, s16 psgGain, const s16* pFM, s16 fmGain, int count);
     INLINE void TracePSGEvent(u8 value);
     INLINE void TracePSGStereoEvent(u8 value);
     INLINE void TraceYM2413Event(u8 port, u8 value, bool accepted);
     void LogPSGEvent(u8 value);
     void LogPSGStereoEvent(u8 value);
     void LogYM2413Event(u8 port, u8 value, bool accepted);
+    void RenderDebugChannel(int channel);
 
 private:
     YM2413* m_pYM2413;
@@ -85,14 +101,22 @@ private:
     Cartridge* m_pCartridge;
     s16* m_pYM2413Buffer;
     bool m_bMute;
+    bool m_bOutputEnabled;
+    bool m_bOutputStale;
     float m_master_volume;
     float m_psg_volume;
     float m_fm_volume;
+    s16 m_iPSGGain;
+    s16 m_iFMGain;
+    s16* m_pAlignBuffer;
     VgmRecorder m_VgmRecorder;
     bool m_bVgmRecordingEnabled;
+    bool m_bSilentReplay;
+    AudioRecorder m_AudioRecorder;
     TraceLogger* m_pTraceLogger;
     blip_sample_t* m_pDebugChannelBuffer[4];
     long m_iDebugChannelSamples[4];
+    bool m_bDebugChannelReady[4];
 };
 
 #include "Cartridge.h"
@@ -102,7 +126,7 @@ inline void Audio::Tick(unsigned int clockCycles)
     m_ElapsedCycles += clockCycles;
     m_pYM2413->Tick(clockCycles);
 #ifndef GS_DISABLE_VGMRECORDER
-    if (m_bVgmRecordingEnabled)
+    if (m_bVgmRecordingEnabled && !m_bSilentReplay)
         m_VgmRecorder.UpdateTiming(clockCycles);
 #endif
 }
@@ -112,7 +136,7 @@ inline void Audio::WriteAudioRegister(u8 value)
     m_pApu->write_data(m_ElapsedCycles, value);
     TracePSGEvent(value);
 #ifndef GS_DISABLE_VGMRECORDER
-    if (m_bVgmRecordingEnabled)
+    if (m_bVgmRecordingEnabled && !m_bSilentReplay)
         m_VgmRecorder.WritePSG(value);
 #endif
 }
@@ -122,7 +146,7 @@ inline void Audio::WriteGGStereoRegister(u8 value)
     m_pApu->write_ggstereo(m_ElapsedCycles, value);
     TracePSGStereoEvent(value);
 #ifndef GS_DISABLE_VGMRECORDER
-    if (m_bVgmRecordingEnabled)
+    if (m_bVgmRecordingEnabled && !m_bSilentReplay)
         m_VgmRecorder.WriteGGStereo(value);
 #endif
 }
@@ -158,7 +182,7 @@ inline void Audio::YM2413Write(u8 port, u8 value)
     TraceYM2413Event(port, value, true);
 
 #ifndef GS_DISABLE_VGMRECORDER
-    if (m_bVgmRecordingEnabled && (port == 0xF0 || port == 0xF1))
+    if (m_bVgmRecordingEnabled && !m_bSilentReplay && (port == 0xF0 || port == 0xF1))
         m_VgmRecorder.WriteYM2413(port, value);
 #endif
 }
@@ -194,6 +218,11 @@ inline Sms_Apu* Audio::GetPSG()
     return m_pApu;
 }
 
+inline YM2413* Audio::GetYM2413()
+{
+    return m_pYM2413;
+}
+
 inline void Audio::EnablePSGDebug(bool enable)
 {
     if (enable && !m_pApu->is_debug_enabled())
@@ -207,38 +236,32 @@ inline void Audio::EnablePSGDebug(bool enable)
     }
 }
 
-inline bool Audio::IsPSGDebugEnabled()
-{
-    return m_pApu->is_debug_enabled();
-}
-
-inline blip_sample_t* Audio::GetDebugChannelBuffer(int channel)
+inline int Audio::GetSampleRate() const
 {
-    if (channel < 0 || channel >= 4)
-        return NULL;
-    return m_pDebugChannelBuffer[channel];
+    return m_iSampleRate;
 }
 
-inline int Audio::GetDebugChannelSamples(int channel)
+inline bool Audio::IsPSGDebugEnabled()
 {
-    if (channel < 0 || channel >= 4)
-        return 0;
-    return (int)m_iDebugChannelSamples[channel];
+    return m_pApu->is_debug_enabled();
 }
 
 inline void Audio::SetMasterVolume(float volume)
 {
     m_master_volume = CLAMP(volume, 0.0f, 2.0f);
+    UpdateMixerGains();
 }
 
 inline void Audio::SetPSGVolume(float volume)
 {
     m_psg_volume = CLAMP(volume, 0.0f, 2.0f);
+    UpdateMixerGains();
 }
 
 inline void Audio::SetFMVolume(float volume)
 {
     m_fm_volume = CLAMP(volume, 0.0f, 2.0f);
+    UpdateMixerGains();
 }
 
 #endif	/* AUDIO_H */
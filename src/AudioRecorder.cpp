@@ -0,0 +1,206 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include "AudioRecorder.h"
+#include "common.h"
+#include "log.h"
+
+#if !defined(GS_DISABLE_AUDIORECORDER)
+#include <chrono>
+#endif
+
+AudioRecorder::AudioRecorder()
+{
+    m_bRecording = false;
+    m_iSampleRate = 0;
+    m_iChannels = 0;
+    m_DataSize = 0;
+    InitPointer(m_pSlots);
+#if !defined(GS_DISABLE_AUDIORECORDER)
+    m_SlotHead.store(0);
+    m_SlotTail.store(0);
+    m_Dropped.store(0);
+    m_bQuit.store(false);
+#endif
+}
+
+AudioRecorder::~AudioRecorder()
+{
+    Stop();
+}
+
+bool AudioRecorder::Start(const char* file_path, int sample_rate, int channels)
+{
+#if defined(GS_DISABLE_AUDIORECORDER)
+    UNUSED(file_path);
+    UNUSED(sample_rate);
+    UNUSED(channels);
+    Log("Audio Recorder: Not available in this build");
+    return false;
+#else
+    Stop();
+
+    m_File.open(file_path, std::ios::binary | std::ios::trunc);
+    if (!m_File.is_open())
+    {
+        Log("Audio Recorder: Unable to open %s", file_path);
+        return false;
+    }
+
+    m_FilePath = file_path;
+    m_iSampleRate = sample_rate;
+    m_iChannels = channels;
+    m_DataSize = 0;
+
+    // The sizes are patched in Stop()
+    WriteHeader(0);
+
+    m_pSlots = new Slot[GS_AUDIO_RECORDER_SLOTS];
+    m_SlotHead.store(0);
+    m_SlotTail.store(0);
+    m_Dropped.store(0);
+    m_bQuit.store(false);
+    m_Thread = std::thread(&AudioRecorder::Run, this);
+
+    m_bRecording = true;
+
+    Log("Audio Recorder: Recording %d Hz, %d channels to %s", sample_rate, channels, file_path);
+
+    return true;
+#endif
+}
+
+void AudioRecorder::Stop()
+{
+    if (!m_bRecording)
+        return;
+
+#if !defined(GS_DISABLE_AUDIORECORDER)
+    m_bQuit.store(true);
+    m_Thread.join();
+
+    // Anything queued after the worker last looked
+    WriteSlots();
+
+    u32 dropped = m_Dropped.load();
+    if (dropped > 0)
+        Log("Audio Recorder: %u frames dropped, the writer couldn't keep up", dropped);
+#endif
+
+    m_File.seekp(0);
+    WriteHeader(m_DataSize);
+
+    if (m_File.fail())
+        Log("Audio Recorder: Error writing %s", m_FilePath.c_str());
+
+    m_File.close();
+
+    SafeDeleteArray(m_pSlots);
+    m_bRecording = false;
+
+    Log("Audio Recorder: Stopped, %u bytes of audio written", m_DataSize);
+}
+
+void AudioRecorder::PushSamples(const s16* samples, int count)
+{
+#if defined(GS_DISABLE_AUDIORECORDER)
+    UNUSED(samples);
+    UNUSED(count);
+#else
+    if (!m_bRecording || (count <= 0))
+        return;
+
+    u32 head = m_SlotHead.load(std::memory_order_relaxed);
+    u32 tail = m_SlotTail.load(std::memory_order_acquire);
+
+    if ((head - tail) >= GS_AUDIO_RECORDER_SLOTS)
+    {
+        m_Dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Slot& slot = m_pSlots[head % GS_AUDIO_RECORDER_SLOTS];
+    slot.count = MIN(count, GS_AUDIO_BUFFER_SIZE);
+    memcpy(slot.samples, samples, slot.count * sizeof(s16));
+
+    m_SlotHead.store(head + 1, std::memory_order_release);
+#endif
+}
+
+void AudioRecorder::WriteHeader(u32 data_size)
+{
+    u8 header[44];
+    u32 block_align = m_iChannels * 2;
+
+    memcpy(&header[0], "RIFF", 4);
+    write_u32_le(&header[4], 36 + data_size);
+    memcpy(&header[8], "WAVE", 4);
+    memcpy(&header[12], "fmt ", 4);
+    write_u32_le(&header[16], 16);
+    write_u16_le(&header[20], 1);
+    write_u16_le(&header[22], (u16)m_iChannels);
+    write_u32_le(&header[24], (u32)m_iSampleRate);
+    write_u32_le(&header[28], (u32)m_iSampleRate * block_align);
+    write_u16_le(&header[32], (u16)block_align);
+    write_u16_le(&header[34], 16);
+    memcpy(&header[36], "data", 4);
+    write_u32_le(&header[40], data_size);
+
+    m_File.write(reinterpret_cast<const char*>(header), 44);
+}
+
+#if !defined(GS_DISABLE_AUDIORECORDER)
+void AudioRecorder::Run()
+{
+    while (!m_bQuit.load())
+    {
+        if (!WriteSlots())
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+bool AudioRecorder::WriteSlots()
+{
+    u32 tail = m_SlotTail.load(std::memory_order_relaxed);
+    u32 head = m_SlotHead.load(std::memory_order_acquire);
+
+    if (tail == head)
+        return false;
+
+    while (tail != head)
+    {
+        const Slot& slot = m_pSlots[tail % GS_AUDIO_RECORDER_SLOTS];
+
+#if defined(GS_BIG_ENDIAN)
+        u8 data[GS_AUDIO_BUFFER_SIZE * 2];
+        for (int i = 0; i < slot.count; i++)
+            write_u16_le(&data[i * 2], (u16)slot.samples[i]);
+        m_File.write(reinterpret_cast<const char*>(data), slot.count * 2);
+#else
+        m_File.write(reinterpret_cast<const char*>(slot.samples), slot.count * 2);
+#endif
+        m_DataSize += slot.count * 2;
+
+        tail++;
+        m_SlotTail.store(tail, std::memory_order_release);
+    }
+
+    return true;
+}
+#endif
@@ -0,0 +1,78 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef AUDIO_RECORDER_H
+#define AUDIO_RECORDER_H
+
+#include "definitions.h"
+#include <string>
+#include <fstream>
+
+#if !defined(GS_DISABLE_AUDIORECORDER)
+#include <thread>
+#include <atomic>
+#endif
+
+// Frames queued between the emulation and the writer thread
+#define GS_AUDIO_RECORDER_SLOTS 64
+
+// Captures the mixed output to a 16 bit PCM WAV file. The emulation thread
+// only copies each frame into a ring, the file is written by a worker.
+class AudioRecorder
+{
+public:
+    AudioRecorder();
+    ~AudioRecorder();
+
+    bool Start(const char* file_path, int sample_rate, int channels);
+    void Stop();
+    bool IsRecording() const { return m_bRecording; }
+    void PushSamples(const s16* samples, int count);
+
+private:
+    struct Slot
+    {
+        s16 samples[GS_AUDIO_BUFFER_SIZE];
+        int count;
+    };
+
+    void WriteHeader(u32 data_size);
+#if !defined(GS_DISABLE_AUDIORECORDER)
+    void Run();
+    bool WriteSlots();
+#endif
+
+private:
+    bool m_bRecording;
+    std::string m_FilePath;
+    std::ofstream m_File;
+    int m_iSampleRate;
+    int m_iChannels;
+    u32 m_DataSize;
+    Slot* m_pSlots;
+#if !defined(GS_DISABLE_AUDIORECORDER)
+    std::thread m_Thread;
+    std::atomic<u32> m_SlotHead;
+    std::atomic<u32> m_SlotTail;
+    std::atomic<u32> m_Dropped;
+    std::atomic<bool> m_bQuit;
+#endif
+};
+
+#endif /* AUDIO_RECORDER_H */
@@ -160,13 +160,13 @@ int BootromMemoryRule::GetBank(int index)
     }
 }
 
-void BootromMemoryRule::SaveState(std::ostream& stream)
+void BootromMemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_iMapperSlot), sizeof(m_iMapperSlot));
     stream.write(reinterpret_cast<const char*> (m_iMapperSlotAddress), sizeof(m_iMapperSlotAddress));
 }
 
-void BootromMemoryRule::LoadState(std::istream& stream, int)
+void BootromMemoryRule::LoadState(state_reader& stream, int)
 {
     stream.read(reinterpret_cast<char*> (m_iMapperSlot), sizeof(m_iMapperSlot));
     stream.read(reinterpret_cast<char*> (m_iMapperSlotAddress), sizeof(m_iMapperSlotAddress));
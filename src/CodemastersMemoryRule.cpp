@@ -177,7 +177,7 @@ int CodemastersMemoryRule::GetBank(int index)
     }
 }
 
-void CodemastersMemoryRule::SaveState(std::ostream& stream)
+void CodemastersMemoryRule::SaveState(state_writer& stream)
 {
     using namespace std;
 
@@ -187,7 +187,7 @@ void CodemastersMemoryRule::SaveState(std::ostream& stream)
     stream.write(reinterpret_cast<const char*> (&m_bRAMBankActive), sizeof(m_bRAMBankActive));
 }
 
-void CodemastersMemoryRule::LoadState(std::istream& stream, int)
+void CodemastersMemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
@@ -274,14 +274,14 @@ int Eeprom93C46MemoryRule::GetBank(int index)
     }
 }
 
-void Eeprom93C46MemoryRule::SaveState(std::ostream& stream)
+void Eeprom93C46MemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*>(m_iMapperSlot), sizeof(m_iMapperSlot));
     stream.write(reinterpret_cast<const char*>(m_iMapperSlotAddress), sizeof(m_iMapperSlotAddress));
     stream.write(reinterpret_cast<const char*>(&m_EEPROM), sizeof(m_EEPROM));
 }
 
-void Eeprom93C46MemoryRule::LoadState(std::istream& stream, int)
+void Eeprom93C46MemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
@@ -37,8 +37,8 @@ public:
     virtual u8* GetRamBanks();
     virtual u8* GetPage(int index);
     virtual int GetBank(int index);
-    virtual void SaveState(std::ostream& stream);
-    virtual void LoadState(std::istream& stream, int version);
+    virtual void SaveState(state_writer& stream);
+    virtual void LoadState(state_reader& stream, int version);
 
 private:
     // EEPROM 93C46 definitions
@@ -95,7 +95,7 @@ void GameGearIOPorts::Reset()
     m_Ports[5] = 0x00;
 }
 
-void GameGearIOPorts::SaveState(std::ostream& stream)
+void GameGearIOPorts::SaveState(state_writer& stream)
 {
     using namespace std;
 
@@ -103,7 +103,7 @@ void GameGearIOPorts::SaveState(std::ostream& stream)
     stream.write(reinterpret_cast<const char*> (m_Ports), sizeof(m_Ports));
 }
 
-void GameGearIOPorts::LoadState(std::istream& stream)
+void GameGearIOPorts::LoadState(state_reader& stream)
 {
     using namespace std;
 
@@ -37,8 +37,8 @@ public:
     void Reset();
     virtual u8 DoInput(u8 port);
     virtual void DoOutput(u8 port, u8 value);
-    virtual void SaveState(std::ostream& stream);
-    virtual void LoadState(std::istream& stream);
+    virtual void SaveState(state_writer& stream);
+    virtual void LoadState(state_reader& stream);
     void SetTraceLogger(TraceLogger* pTraceLogger);
 
 private:
@@ -53,7 +53,91 @@
 #include "BootromMemoryRule.h"
 #include "TraceLogger.h"
 #include "common.h"
-#include "memory_stream.h"
+
+static bool ReadSaveStateFileHeader(std::ifstream& stream, size_t size, GS_SaveState_File_Header* header)
+{
+    if (size < sizeof(GS_SaveState_File_Header))
+        return false;
+
+    stream.seekg(0, std::ios::beg);
+    stream.read(reinterpret_cast<char*>(header), sizeof(GS_SaveState_File_Header));
+
+    if (stream.fail() || (header->magic != GS_SAVESTATE_FILE_MAGIC))
+    {
+        stream.clear();
+        stream.seekg(0, std::ios::beg);
+        return false;
+    }
+
+    if (header->version != GS_SAVESTATE_FILE_VERSION)
+    {
+        Error("Unsupported save state file version %u", header->version);
+        return false;
+    }
+
+    if ((header->thumbnail_offset > size) || (header->thumbnail_packed_size > (size - header->thumbnail_offset)) ||
+        (header->state_offset > size) || (header->state_packed_size > (size - header->state_offset)))
+    {
+        Error("Invalid save state file header: size %zu", size);
+        return false;
+    }
+
+    header->rom_name[sizeof(header->rom_name) - 1] = 0;
+    header->emu_build[sizeof(header->emu_build) - 1] = 0;
+
+    return true;
+}
+
+// Halves the screenshot with a 2x2 box filter. 16 bit formats just drop
+// every other pixel to avoid unpacking each color layout.
+static void CreateSaveStateThumbnail(const u8* src, u8* dst, int width, int height, int bytes_per_pixel)
+{
+    int thumbnail_width = width / GS_SAVESTATE_THUMBNAIL_SCALE;
+    int thumbnail_height = height / GS_SAVESTATE_THUMBNAIL_SCALE;
+    int pitch = width * bytes_per_pixel;
+
+    for (int y = 0; y < thumbnail_height; y++)
+    {
+        const u8* src_line = src + (y * GS_SAVESTATE_THUMBNAIL_SCALE * pitch);
+
+        for (int x = 0; x < thumbnail_width; x++)
+        {
+            const u8* src_pixel = src_line + (x * GS_SAVESTATE_THUMBNAIL_SCALE * bytes_per_pixel);
+            u8* dst_pixel = dst + (((y * thumbnail_width) + x) * bytes_per_pixel);
+
+            if (bytes_per_pixel == 4)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    int sum = src_pixel[c] + src_pixel[4 + c] + src_pixel[pitch + c] + src_pixel[pitch + 4 + c];
+                    dst_pixel[c] = static_cast<u8>((sum + 2) >> 2);
+                }
+            }
+            else
+            {
+                dst_pixel[0] = src_pixel[0];
+                dst_pixel[1] = src_pixel[1];
+            }
+        }
+    }
+}
+
+static bool CompactStates()
+{
+#if defined(__LIBRETRO__)
+    // Netplay and run-ahead serialize every frame, so libretro states leave
+    // out everything that can be rebuilt and keep a constant size per ROM
+    return true;
+#else
+    return false;
+#endif
+}
+
+static const char* const k_state_section_names[GS_State_Section_Count] =
+{
+    "memory", "ram", "cpu", "audio", "ym2413", "psg", "vdp", "vram",
+    "cram", "vdp_registers", "input", "mapper", "bootrom", "io", "footer"
+};
 
 GearsystemCore::GearsystemCore()
 {
@@ -95,6 +179,7 @@ GearsystemCore::GearsystemCore()
     m_bPaused = true;
     m_pixelFormat = GS_PIXEL_RGBA8888;
     m_GlassesConfig = GearsystemCore::GlassesBothEyes;
+    m_bFrameDirty = false;
 }
 
 GearsystemCore::~GearsystemCore()
@@ -172,9 +257,14 @@ void GearsystemCore::Init(GS_Color_Format pixelFormat)
 bool GearsystemCore::RunToVBlank(u8* pFrameBuffer, s16* pSampleBuffer, int* pSampleCount, GS_Debug_Run* debug, bool render)
 {
     m_pFrameBuffer = pFrameBuffer;
+    m_bFrameDirty = false;
 
     if (!m_bPaused && m_pCartridge->IsReady())
     {
+        // Frames run without a sample buffer are never heard, the sound
+        // chips only keep their state in step
+        m_pAudio->SetOutputEnabled(IsValidPointer(pSampleBuffer));
+
 #if !defined(GS_DISABLE_DISASSEMBLER)
         bool debug_enable = false;
         bool instruction_completed = false;
@@ -420,6 +510,16 @@ void GearsystemCore::SetGlassesConfig(GlassesConfig config)
     m_GlassesConfig = config;
 }
 
+GearsystemCore::GlassesConfig GearsystemCore::GetGlassesConfig()
+{
+    return m_GlassesConfig;
+}
+
+bool GearsystemCore::IsFrameDirty()
+{
+    return m_bFrameDirty;
+}
+
 u64 GearsystemCore::GetMasterClockCycles()
 {
     return m_master_clock_cycles;
@@ -730,81 +830,211 @@ bool GearsystemCore::SaveState(const char* path, int index, bool screenshot)
     using namespace std;
 
     string full_path = GetSaveStatePath(path, index);
-    Debug("Saving state to %s...", full_path.c_str());
 
-    ofstream stream;
-    open_ofstream_utf8(stream, full_path.c_str(), ios::out | ios::binary);
+    GS_SaveState_Capture capture;
 
-    if (!stream.is_open())
+    if (!CaptureSaveState(&capture, screenshot))
     {
-        Error("Failed to open save state file for writing: %s", full_path.c_str());
+        Error("Failed to save state to file: %s", full_path.c_str());
         return false;
     }
 
+    bool ret = WriteSaveStateFile(full_path.c_str(), &capture);
+    ReleaseSaveStateCapture(&capture);
+    return ret;
+}
+
+// Only copies the state and the thumbnail, so it is cheap enough to run
+// within a frame. Compressing and writing is left to WriteSaveStateFile.
+bool GearsystemCore::CaptureSaveState(GS_SaveState_Capture* capture, bool screenshot)
+{
+    memset(capture, 0, sizeof(GS_SaveState_Capture));
+
+    // The screenshot is stored as a thumbnail in the file header area
+    // instead of at the end of the state
     size_t size = 0;
-    if (!SaveState(stream, size, screenshot))
+    if (!SaveState(NULL, size, false))
+        return false;
+
+    capture->state = new u8[size];
+
+    if (!SaveState(capture->state, size, false))
     {
-        stream.close();
-        Error("Failed to save state to file: %s", full_path.c_str());
+        ReleaseSaveStateCapture(capture);
         return false;
     }
 
-    stream.close();
+    GS_SaveState_File_Header& header = capture->header;
+    header.magic = GS_SAVESTATE_FILE_MAGIC;
+    header.version = GS_SAVESTATE_FILE_VERSION;
+    header.state_version = GS_SAVESTATE_VERSION;
+    header.rom_crc = m_pCartridge->GetCRC();
+    header.timestamp = time(NULL);
+    header.state_size = static_cast<u32>(size);
+    strncpy_fit(header.rom_name, m_pCartridge->GetFileName(), sizeof(header.rom_name));
+    strncpy_fit(header.emu_build, GS_VERSION, sizeof(header.emu_build));
 
-    if (!stream.good())
+    if (screenshot && IsValidPointer(m_pFrameBuffer))
     {
-        Error("Failed to write save state file: %s", full_path.c_str());
-        return false;
+        GS_RuntimeInfo runtime_info;
+        GetRuntimeInfo(runtime_info);
+
+        int bytes_per_pixel = 2;
+        if (m_pixelFormat == GS_PIXEL_RGBA8888 || m_pixelFormat == GS_PIXEL_BGRA8888)
+            bytes_per_pixel = 4;
+
+        header.thumbnail_width = runtime_info.screen_width / GS_SAVESTATE_THUMBNAIL_SCALE;
+        header.thumbnail_height = runtime_info.screen_height / GS_SAVESTATE_THUMBNAIL_SCALE;
+        header.thumbnail_size = header.thumbnail_width * header.thumbnail_height * bytes_per_pixel;
+
+        capture->thumbnail = new u8[header.thumbnail_size];
+        CreateSaveStateThumbnail(m_pFrameBuffer, capture->thumbnail, runtime_info.screen_width, runtime_info.screen_height, bytes_per_pixel);
     }
 
-    Log("Saved state to %s", full_path.c_str());
     return true;
 }
 
-bool GearsystemCore::SaveState(u8* buffer, size_t& size, bool screenshot)
+// Doesn't touch the core, so it can run on any thread. The file is written
+// next to its destination and renamed over it, so readers never see a
+// partially written state.
+bool GearsystemCore::WriteSaveStateFile(const char* full_path, GS_SaveState_Capture* capture)
 {
     using namespace std;
 
-    Debug("Saving state to buffer [%d bytes]...", size);
+    Debug("Saving state to %s...", full_path);
 
-    if (!m_pCartridge->IsReady())
+    if (!IsValidPointer(capture->state) || (capture->header.state_size == 0))
     {
-        Error("Cartridge is not ready when trying to save state");
+        Error("Invalid save state capture");
         return false;
     }
 
-    if (!IsValidPointer(buffer))
+    GS_SaveState_File_Header& header = capture->header;
+    u8* thumbnail_packed = NULL;
+    mz_ulong thumbnail_packed_size = 0;
+
+    if (IsValidPointer(capture->thumbnail) && (header.thumbnail_size > 0))
     {
-        stringstream stream;
-        if (!SaveState(stream, size, screenshot))
+        thumbnail_packed_size = mz_compressBound(header.thumbnail_size);
+        thumbnail_packed = new u8[thumbnail_packed_size];
+
+        if (mz_compress2(thumbnail_packed, &thumbnail_packed_size, capture->thumbnail, header.thumbnail_size, MZ_BEST_SPEED) != MZ_OK)
         {
-            Error("Failed to save state to stream to calculate size");
-            return false;
+            Error("Failed to compress save state thumbnail");
+            header.thumbnail_size = 0;
+            header.thumbnail_width = 0;
+            header.thumbnail_height = 0;
+            thumbnail_packed_size = 0;
         }
-        return true;
     }
     else
     {
-        memory_stream direct_stream(reinterpret_cast<char*>(buffer), size);
+        header.thumbnail_size = 0;
+        header.thumbnail_width = 0;
+        header.thumbnail_height = 0;
+    }
 
-        if (!SaveState(direct_stream, size, screenshot))
-        {
-            Error("Failed to save state to buffer");
-            return false;
-        }
+    mz_ulong state_packed_size = mz_compressBound(header.state_size);
+    u8* state_packed = new u8[state_packed_size];
 
-        if (!direct_stream.good())
-        {
-            Error("Failed to save state to buffer: output buffer is too small");
-            return false;
-        }
+    if (mz_compress2(state_packed, &state_packed_size, capture->state, header.state_size, MZ_BEST_SPEED) != MZ_OK)
+    {
+        SafeDeleteArray(state_packed);
+        SafeDeleteArray(thumbnail_packed);
+        Error("Failed to compress save state: %s", full_path);
+        return false;
+    }
 
-        size = direct_stream.size();
-        return true;
+    header.thumbnail_offset = sizeof(header);
+    header.thumbnail_packed_size = static_cast<u32>(thumbnail_packed_size);
+    header.state_offset = header.thumbnail_offset + header.thumbnail_packed_size;
+    header.state_packed_size = static_cast<u32>(state_packed_size);
+
+    Debug("Save state file thumbnail: %dx%d, %u bytes packed to %u", header.thumbnail_width, header.thumbnail_height, header.thumbnail_size, header.thumbnail_packed_size);
+    Debug("Save state file state: %u bytes packed to %u", header.state_size, header.state_packed_size);
+
+    string temp_path = string(full_path) + ".tmp";
+
+    FILE* file = fopen_utf8(temp_path.c_str(), "wb");
+
+    if (!IsValidPointer(file))
+    {
+        SafeDeleteArray(state_packed);
+        SafeDeleteArray(thumbnail_packed);
+        Error("Failed to open save state file for writing: %s", temp_path.c_str());
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    if (ok && (header.thumbnail_packed_size > 0))
+        ok = fwrite(thumbnail_packed, header.thumbnail_packed_size, 1, file) == 1;
+    if (ok)
+        ok = fwrite(state_packed, header.state_packed_size, 1, file) == 1;
+
+    // The data must be on disk before the rename replaces the old file,
+    // otherwise a crash can leave an empty file in its place
+    if (ok)
+        ok = sync_file(file);
+
+    ok = (fclose(file) == 0) && ok;
+    SafeDeleteArray(state_packed);
+    SafeDeleteArray(thumbnail_packed);
+
+    if (!ok)
+    {
+        remove_utf8(temp_path.c_str());
+        Error("Failed to write save state file: %s", temp_path.c_str());
+        return false;
     }
+
+    if (!rename_utf8(temp_path.c_str(), full_path))
+    {
+        remove_utf8(temp_path.c_str());
+        Error("Failed to replace save state file: %s", full_path);
+        return false;
+    }
+
+    Log("Saved state to %s", full_path);
+    return true;
 }
 
-bool GearsystemCore::SaveState(std::ostream& stream, size_t& size, bool screenshot)
+void GearsystemCore::ReleaseSaveStateCapture(GS_SaveState_Capture* capture)
+{
+    SafeDeleteArray(capture->state);
+    SafeDeleteArray(capture->thumbnail);
+}
+
+bool GearsystemCore::SaveState(u8* buffer, size_t& size, bool screenshot)
+{
+    using namespace std;
+
+    Debug("Saving state to buffer [%d bytes]...", size);
+
+    if (!m_pCartridge->IsReady())
+    {
+        Error("Cartridge is not ready when trying to save state");
+        return false;
+    }
+
+    // Without a buffer the writer only counts bytes
+    state_writer stream(reinterpret_cast<char*>(buffer), IsValidPointer(buffer) ? size : 0, CompactStates());
+
+    if (!SaveState(stream, size, screenshot))
+    {
+        Error("Failed to save state to buffer");
+        return false;
+    }
+
+    if (!stream.good())
+    {
+        Error("Failed to save state to buffer: output buffer is too small");
+        return false;
+    }
+
+    return true;
+}
+
+bool GearsystemCore::SaveState(state_writer& stream, size_t& size, bool screenshot)
 {
     using namespace std;
 
@@ -821,18 +1051,23 @@ bool GearsystemCore::SaveState(std::ostream& stream, size_t& size, bool screensh
     m_pAudio->SaveState(stream);
     m_pVideo->SaveState(stream);
     m_pInput->SaveState(stream);
+    stream.section(GS_State_Section_Mapper);
     m_pMemory->GetCurrentRule()->SaveState(stream);
+    stream.section(GS_State_Section_Bootrom);
     m_pMemory->GetBootromRule()->SaveState(stream);
+    stream.section(GS_State_Section_IO);
     m_pProcessor->GetIOPOrts()->SaveState(stream);
+    stream.section(GS_State_Section_Footer);
 
 #if defined(__LIBRETRO__)
     GS_SaveState_Header_Libretro header;
-    header.magic = GS_SAVESTATE_MAGIC;
+    header.magic = stream.compact() ? GS_SAVESTATE_MAGIC_COMPACT : GS_SAVESTATE_MAGIC;
     header.version = GS_SAVESTATE_VERSION;
     Debug("Save state header magic: 0x%08x", header.magic);
     Debug("Save state header version: %d", header.version);
 #else
     GS_SaveState_Header header;
+    memset(&header, 0, sizeof(header));
     header.magic = GS_SAVESTATE_MAGIC;
     header.version = GS_SAVESTATE_VERSION;
 
@@ -874,7 +1109,7 @@ bool GearsystemCore::SaveState(std::ostream& stream, size_t& size, bool screensh
     Debug("Save state header screenshot height: %d", header.screenshot_height);
 #endif
 
-    size = static_cast<size_t>(stream.tellp());
+    size = stream.size();
     size += sizeof(header);
 
 #if !defined(__LIBRETRO__)
@@ -883,6 +1118,7 @@ bool GearsystemCore::SaveState(std::ostream& stream, size_t& size, bool screensh
 #endif
 
     stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.end_section();
     return true;
 }
 
@@ -899,7 +1135,17 @@ bool GearsystemCore::LoadState(const char* path, int index)
 
     if (!stream.fail())
     {
-        ret = LoadState(stream);
+        stream.seekg(0, ios::end);
+        size_t size = static_cast<size_t>(stream.tellg());
+        stream.seekg(0, ios::beg);
+
+        u8* buffer = new u8[size > 0 ? size : 1];
+        stream.read(reinterpret_cast<char*>(buffer), size);
+
+        if (!stream.fail())
+            ret = LoadStateFile(buffer, size);
+
+        SafeDeleteArray(buffer);
 
         if (ret)
             Log("Loaded state from %s", full_path.c_str());
@@ -933,11 +1179,74 @@ bool GearsystemCore::LoadState(const u8* buffer, size_t size)
         return false;
     }
 
-    memory_input_stream direct_stream(reinterpret_cast<const char*>(buffer), size);
-    return LoadState(direct_stream);
+    state_reader stream(reinterpret_cast<const char*>(buffer), size);
+    return LoadState(stream);
+}
+
+// Savestates don't carry the picture, so the frame that follows the state
+// is emulated silently to draw it and then the state is loaded again
+bool GearsystemCore::RenderState(const u8* buffer, size_t size, u8* pFrameBuffer)
+{
+    if (!LoadState(buffer, size))
+        return false;
+
+    bool paused = m_bPaused;
+    u64 master_clock_cycles = m_master_clock_cycles;
+    u32 trace_flags = m_trace_logger->GetEnabledFlags();
+
+    // Neither the trace log nor a VGM recording should see the replayed frame
+    m_trace_logger->SetEnabledFlags(0);
+    m_pAudio->SetSilentReplay(true);
+
+    m_bPaused = false;
+    RunToVBlank(pFrameBuffer, NULL, NULL, NULL, true);
+    m_bPaused = paused;
+    m_master_clock_cycles = master_clock_cycles;
+
+    m_pAudio->SetSilentReplay(false);
+    m_trace_logger->SetEnabledFlags(trace_flags);
+
+    return LoadState(buffer, size);
+}
+
+bool GearsystemCore::LoadStateFile(const u8* buffer, size_t size)
+{
+    GS_SaveState_File_Header header;
+
+    // Files without the front header are raw states from older versions
+    if ((size < sizeof(header)) || (reinterpret_cast<const GS_SaveState_File_Header*>(buffer)->magic != GS_SAVESTATE_FILE_MAGIC))
+        return LoadState(buffer, size);
+
+    memcpy(&header, buffer, sizeof(header));
+
+    if (header.version != GS_SAVESTATE_FILE_VERSION)
+    {
+        Error("Unsupported save state file version %u", header.version);
+        return false;
+    }
+
+    if ((header.state_offset > size) || (header.state_packed_size > (size - header.state_offset)) || (header.state_size == 0))
+    {
+        Error("Invalid save state file: state offset %u, size %u", header.state_offset, header.state_packed_size);
+        return false;
+    }
+
+    u8* state = new u8[header.state_size];
+    mz_ulong state_size = header.state_size;
+
+    if ((mz_uncompress(state, &state_size, buffer + header.state_offset, header.state_packed_size) != MZ_OK) || (state_size != header.state_size))
+    {
+        SafeDeleteArray(state);
+        Error("Failed to decompress save state");
+        return false;
+    }
+
+    bool ret = LoadState(state, state_size);
+    SafeDeleteArray(state);
+    return ret;
 }
 
-bool GearsystemCore::LoadState(std::istream& stream)
+bool GearsystemCore::LoadState(state_reader& stream)
 {
     using namespace std;
 
@@ -952,14 +1261,13 @@ bool GearsystemCore::LoadState(std::istream& stream)
     bool is_desktop_savestate = false;
 #endif
 
-    stream.seekg(0, ios::end);
-    size_t size = static_cast<size_t>(stream.tellg());
+    size_t size = stream.size();
 
     // Try desktop header first (larger, contains all info)
     GS_SaveState_Header desktop_header = {};
     if (size >= sizeof(desktop_header))
     {
-        stream.seekg(size - sizeof(desktop_header), ios::beg);
+        stream.seek(size - sizeof(desktop_header));
         stream.read(reinterpret_cast<char*> (&desktop_header), sizeof(desktop_header));
 
         if (desktop_header.magic == GS_SAVESTATE_MAGIC)
@@ -976,11 +1284,18 @@ bool GearsystemCore::LoadState(std::istream& stream)
     // Fallback to libretro header
     if ((header.magic != GS_SAVESTATE_MAGIC) && (size >= sizeof(header)))
     {
-        stream.seekg(size - sizeof(header), ios::beg);
+        stream.seek(size - sizeof(header));
         stream.read(reinterpret_cast<char*> (&header), sizeof(header));
+
+        if (header.magic == GS_SAVESTATE_MAGIC_COMPACT)
+        {
+            Debug("Loading compact save state");
+            header.magic = GS_SAVESTATE_MAGIC;
+            stream.set_compact(true);
+        }
     }
 
-    stream.seekg(0, ios::beg);
+    stream.seek(0);
 
     Debug("Load state header magic: 0x%08x", header.magic);
     Debug("Load state header version: %d", header.version);
@@ -1032,7 +1347,7 @@ bool GearsystemCore::LoadState(std::istream& stream)
     return true;
 }
 
-bool GearsystemCore::LoadStateV1(std::istream& stream, size_t size)
+bool GearsystemCore::LoadStateV1(state_reader& stream, size_t size)
 {
     using namespace std;
 
@@ -1046,11 +1361,11 @@ bool GearsystemCore::LoadStateV1(std::istream& stream, size_t size)
     u32 v1_version = 0;
     u32 v1_size = 0;
 
-    stream.seekg(size - (3 * sizeof(u32)), ios::beg);
+    stream.seek(size - (3 * sizeof(u32)));
     stream.read(reinterpret_cast<char*>(&v1_magic), sizeof(v1_magic));
     stream.read(reinterpret_cast<char*>(&v1_version), sizeof(v1_version));
     stream.read(reinterpret_cast<char*>(&v1_size), sizeof(v1_size));
-    stream.seekg(0, ios::beg);
+    stream.seek(0);
 
     Debug("Load state V1 magic: 0x%08x", v1_magic);
     Debug("Load state V1 version: %d", v1_version);
@@ -1108,6 +1423,32 @@ bool GearsystemCore::GetSaveStateHeader(int index, const char* path, GS_SaveStat
     size_t savestate_size = static_cast<size_t>(stream.tellg());
     stream.seekg(0, ios::beg);
 
+    GS_SaveState_File_Header file_header;
+    memset(&file_header, 0, sizeof(file_header));
+
+    if (ReadSaveStateFileHeader(stream, savestate_size, &file_header))
+    {
+        stream.close();
+
+        memset(header, 0, sizeof(GS_SaveState_Header));
+        header->magic = GS_SAVESTATE_MAGIC;
+        header->version = file_header.state_version;
+        header->size = static_cast<u32>(savestate_size);
+        header->timestamp = file_header.timestamp;
+        strncpy_fit(header->rom_name, file_header.rom_name, sizeof(header->rom_name));
+        header->rom_crc = file_header.rom_crc;
+        header->screenshot_size = file_header.thumbnail_size;
+        header->screenshot_width = file_header.thumbnail_width;
+        header->screenshot_height = file_header.thumbnail_height;
+        strncpy_fit(header->emu_build, file_header.emu_build, sizeof(header->emu_build));
+        return true;
+    }
+    else if (file_header.magic == GS_SAVESTATE_FILE_MAGIC)
+    {
+        stream.close();
+        return false;
+    }
+
     if (savestate_size < sizeof(GS_SaveState_Header))
     {
         if (savestate_size < (3 * sizeof(u32)))
@@ -1207,6 +1548,56 @@ bool GearsystemCore::GetSaveStateScreenshot(int index, const char* path, GS_Save
         return false;
     }
 
+    stream.seekg(0, ios::end);
+    size_t savestate_size = static_cast<size_t>(stream.tellg());
+    stream.seekg(0, ios::beg);
+
+    GS_SaveState_File_Header file_header;
+    memset(&file_header, 0, sizeof(file_header));
+
+    if (ReadSaveStateFileHeader(stream, savestate_size, &file_header))
+    {
+        if (file_header.thumbnail_size == 0)
+        {
+            Debug("No screenshot data");
+            stream.close();
+            return false;
+        }
+
+        if (screenshot->size < file_header.thumbnail_size)
+        {
+            Error("Invalid screenshot buffer size %u < %u", screenshot->size, file_header.thumbnail_size);
+            stream.close();
+            return false;
+        }
+
+        u8* packed = new u8[file_header.thumbnail_packed_size];
+        stream.seekg(file_header.thumbnail_offset, ios::beg);
+        stream.read(reinterpret_cast<char*>(packed), file_header.thumbnail_packed_size);
+        stream.close();
+
+        mz_ulong thumbnail_size = file_header.thumbnail_size;
+        bool ok = !stream.fail() && (mz_uncompress(screenshot->data, &thumbnail_size, packed, file_header.thumbnail_packed_size) == MZ_OK) && (thumbnail_size == file_header.thumbnail_size);
+        SafeDeleteArray(packed);
+
+        if (!ok)
+        {
+            Error("Failed to decompress save state thumbnail");
+            return false;
+        }
+
+        screenshot->size = file_header.thumbnail_size;
+        screenshot->width = file_header.thumbnail_width;
+        screenshot->height = file_header.thumbnail_height;
+        return true;
+    }
+    else if (file_header.magic == GS_SAVESTATE_FILE_MAGIC)
+    {
+        Error("Invalid save state header");
+        stream.close();
+        return false;
+    }
+
     GS_SaveState_Header header;
 
     if (!GetSaveStateHeader(index, path, &header))
@@ -1223,35 +1614,168 @@ bool GearsystemCore::GetSaveStateScreenshot(int index, const char* path, GS_Save
         return false;
     }
 
-    if (screenshot->size < header.screenshot_size)
+    if (header.size < sizeof(header) + header.screenshot_size)
     {
-        Error("Invalid screenshot buffer size %d < %d", screenshot->size, header.screenshot_size);
+        Error("Invalid screenshot offset: header size %u too small for screenshot %u", header.size, header.screenshot_size);
         stream.close();
         return false;
     }
 
-    screenshot->size = header.screenshot_size;
-    screenshot->width = header.screenshot_width;
-    screenshot->height = header.screenshot_height;
+    // Older files keep the full size screenshot, which is downscaled to
+    // match the thumbnails of current files
+    int pixels = header.screenshot_width * header.screenshot_height;
+    int bytes_per_pixel = (pixels > 0) ? (header.screenshot_size / pixels) : 0;
+    u32 thumbnail_width = header.screenshot_width / GS_SAVESTATE_THUMBNAIL_SCALE;
+    u32 thumbnail_height = header.screenshot_height / GS_SAVESTATE_THUMBNAIL_SCALE;
+    u32 thumbnail_size = thumbnail_width * thumbnail_height * bytes_per_pixel;
 
-    Debug("Screenshot size: %d bytes", screenshot->size);
-    Debug("Screenshot width: %d", screenshot->width);
-    Debug("Screenshot height: %d", screenshot->height);
+    if ((bytes_per_pixel != 2) && (bytes_per_pixel != 4))
+    {
+        Error("Invalid screenshot format: %u bytes for %dx%d", header.screenshot_size, header.screenshot_width, header.screenshot_height);
+        stream.close();
+        return false;
+    }
 
-    if (header.size < sizeof(header) + screenshot->size)
+    if (screenshot->size < thumbnail_size)
     {
-        Error("Invalid screenshot offset: header size %d too small for screenshot %d", header.size, screenshot->size);
+        Error("Invalid screenshot buffer size %u < %u", screenshot->size, thumbnail_size);
         stream.close();
         return false;
     }
 
-    stream.seekg(header.size - sizeof(header) - screenshot->size, ios::beg);
-    stream.read(reinterpret_cast<char*> (screenshot->data), screenshot->size);
+    u8* full = new u8[header.screenshot_size];
+    stream.seekg(header.size - sizeof(header) - header.screenshot_size, ios::beg);
+    stream.read(reinterpret_cast<char*> (full), header.screenshot_size);
     stream.close();
 
+    if (stream.fail())
+    {
+        SafeDeleteArray(full);
+        Error("Failed to read save state screenshot");
+        return false;
+    }
+
+    CreateSaveStateThumbnail(full, screenshot->data, header.screenshot_width, header.screenshot_height, bytes_per_pixel);
+    SafeDeleteArray(full);
+
+    screenshot->size = thumbnail_size;
+    screenshot->width = thumbnail_width;
+    screenshot->height = thumbnail_height;
+
+    Debug("Screenshot size: %u bytes", screenshot->size);
+    Debug("Screenshot width: %u", screenshot->width);
+    Debug("Screenshot height: %u", screenshot->height);
+
     return true;
 }
 
+bool GearsystemCore::GetStateLayout(GS_State_Layout* layout)
+{
+    if (!m_pCartridge->IsReady() || !IsValidPointer(layout))
+        return false;
+
+    state_range ranges[GS_STATE_MAX_RANGES];
+    size_t size = 0;
+    state_writer stream(NULL, 0, CompactStates());
+    stream.set_ranges(ranges, GS_STATE_MAX_RANGES);
+
+    if (!SaveState(stream, size, false))
+        return false;
+
+    if (stream.ranges_overflow())
+    {
+        Error("State layout has more than %d ranges", GS_STATE_MAX_RANGES);
+        return false;
+    }
+
+    layout->size = static_cast<u32>(size);
+    layout->count = stream.range_count();
+
+    for (u32 i = 0; i < layout->count; i++)
+    {
+        layout->ranges[i].section = ranges[i].section;
+        layout->ranges[i].offset = static_cast<u32>(ranges[i].offset);
+        layout->ranges[i].size = static_cast<u32>(ranges[i].size);
+    }
+
+    return true;
+}
+
+// Hashes the current state without copying it. The footer hash is left at
+// zero because the footer carries a timestamp.
+bool GearsystemCore::GetStateHashes(u64* hashes)
+{
+    if (!m_pCartridge->IsReady() || !IsValidPointer(hashes))
+        return false;
+
+    for (int i = 0; i < GS_State_Section_Count; i++)
+        hashes[i] = state_writer::hash_seed();
+
+    size_t size = 0;
+    state_writer stream(NULL, 0, CompactStates());
+    stream.set_hashes(hashes, GS_State_Section_Footer);
+
+    if (!SaveState(stream, size, false))
+        return false;
+
+    hashes[GS_State_Section_Footer] = 0;
+    return true;
+}
+
+// Compares two states taken with the same ROM loaded and reports every run
+// of differing bytes, split at section boundaries. Returns the total number
+// of runs, which can be more than max_ranges, or -1 on invalid input.
+int GearsystemCore::DiffStates(const u8* state_a, const u8* state_b, const GS_State_Layout* layout, GS_State_Range* ranges, int max_ranges)
+{
+    if (!IsValidPointer(state_a) || !IsValidPointer(state_b) || !IsValidPointer(layout))
+        return -1;
+
+    int count = 0;
+
+    for (u32 i = 0; i < layout->count; i++)
+    {
+        const GS_State_Range& range = layout->ranges[i];
+
+        if ((range.offset + range.size) > layout->size)
+            return -1;
+
+        u32 end = range.offset + range.size;
+        u32 offset = range.offset;
+
+        while (offset < end)
+        {
+            if (state_a[offset] == state_b[offset])
+            {
+                offset++;
+                continue;
+            }
+
+            u32 start = offset;
+            while ((offset < end) && (state_a[offset] != state_b[offset]))
+                offset++;
+
+            if (IsValidPointer(ranges) && (count < max_ranges))
+            {
+                ranges[count].section = range.section;
+                ranges[count].offset = start;
+                ranges[count].size = offset - start;
+            }
+
+            count++;
+        }
+    }
+
+    return count;
+}
+
+const char* GearsystemCore::GetStateSectionName(int section)
+{
+    if (section < 0 || section >= GS_State_Section_Count)
+        return "unknown";
+
+    return k_state_section_names[section];
+}
+
 void GearsystemCore::SetCheat(const char* szCheat)
 {
     std::string s = szCheat;
@@ -1470,6 +1994,9 @@ void GearsystemCore::Reset()
 
 void GearsystemCore::RenderFrameBuffer(u8* finalFrameBuffer)
 {
+    m_pVideo->WaitForRender();
+    m_bFrameDirty = false;
+
     if (m_pInput->IsPhaserEnabled())
     {
         Input::stPhaser* phaser = m_pInput->GetPhaser();
@@ -1486,6 +2013,12 @@ void GearsystemCore::RenderFrameBuffer(u8* finalFrameBuffer)
             return;
     }
 
+    // Identical frames leave the previous output in place
+    if (!m_pVideo->CheckFrameChanged(finalFrameBuffer, m_pixelFormat))
+        return;
+
+    m_bFrameDirty = true;
+
     int size = GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN;
 
     switch (m_pixelFormat)
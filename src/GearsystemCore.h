@@ -81,6 +81,7 @@ public:
     void Init(GS_Color_Format pixelFormat = GS_PIXEL_RGBA8888);
     bool RunToVBlank(u8* pFrameBuffer, s16* pSampleBuffer, int* pSampleCount, GS_Debug_Run* debug = NULL, bool render = true);
     void RenderFrameBuffer(u8* finalFrameBuffer);
+    bool IsFrameDirty();
     bool LoadROM(const char* szFilePath, Cartridge::ForceConfiguration* config = NULL);
     bool LoadROMFromBuffer(const u8* buffer, int size, Cartridge::ForceConfiguration* config = NULL, const char* szFilePath = NULL);
     void SaveMemoryDump();
@@ -105,11 +106,20 @@ public:
     void LoadRam();
     void LoadRam(const char* szPath, bool fullPath = false);
     bool SaveState(const char* path = NULL, int index = -1, bool screenshot = false);
+    bool CaptureSaveState(GS_SaveState_Capture* capture, bool screenshot = false);
+    static bool WriteSaveStateFile(const char* full_path, GS_SaveState_Capture* capture);
+    static void ReleaseSaveStateCapture(GS_SaveState_Capture* capture);
     bool SaveState(u8* buffer, size_t& size, bool screenshot = false);
     bool LoadState(const char* path = NULL, int index = -1);
     bool LoadState(const u8* buffer, size_t size);
+    bool RenderState(const u8* buffer, size_t size, u8* pFrameBuffer);
     bool GetSaveStateHeader(int index, const char* path, GS_SaveState_Header* header);
     bool GetSaveStateScreenshot(int index, const char* path, GS_SaveState_Screenshot* screenshot);
+    std::string GetSaveStatePath(const char* path, int index);
+    bool GetStateLayout(GS_State_Layout* layout);
+    bool GetStateHashes(u64* hashes);
+    int DiffStates(const u8* state_a, const u8* state_b, const GS_State_Layout* layout, GS_State_Range* ranges, int max_ranges);
+    const char* GetStateSectionName(int section);
     void SetCheat(const char* szCheat);
     void ClearCheats();
     void SetRamModificationCallback(RamChangedCallback callback);
@@ -120,6 +130,7 @@ public:
     Video* GetVideo();
     Input* GetInput();
     void SetGlassesConfig(GlassesConfig config);
+    GlassesConfig GetGlassesConfig();
     u64 GetMasterClockCycles();
     void SetMasterClockCycles(u64 cycles);
     TraceLogger* GetTraceLogger();
@@ -128,10 +139,10 @@ private:
     void InitMemoryRules();
     bool AddMemoryRules();
     void Reset();
-    bool SaveState(std::ostream& stream, size_t& size, bool screenshot);
-    bool LoadState(std::istream& stream);
-    bool LoadStateV1(std::istream& stream, size_t size);
-    std::string GetSaveStatePath(const char* path, int index);
+    bool SaveState(state_writer& stream, size_t& size, bool screenshot);
+    bool LoadState(state_reader& stream);
+    bool LoadStateV1(state_reader& stream, size_t size);
+    bool LoadStateFile(const u8* buffer, size_t size);
 
 private:
     Memory* m_pMemory;
@@ -173,6 +184,7 @@ private:
     u64 m_master_clock_cycles;
     TraceLogger* m_trace_logger;
     u8* m_pFrameBuffer;
+    bool m_bFrameDirty;
 };
 
 #endif	/* CORE_H */
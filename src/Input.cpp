@@ -71,6 +71,11 @@ void Input::SetReset(bool pressed)
         TraceInputChangeEvent(0, Key_Start, previous ? 0 : 1, pressed ? 0 : 1);
 }
 
+bool Input::IsResetPressed()
+{
+    return m_bResetPressed;
+}
+
 void Input::KeyPressed(GS_Joypads joypad, GS_Keys key)
 {
     u8 previous = joypad == Joypad_1 ? m_Joypad1 : m_Joypad2;
@@ -151,6 +156,11 @@ void Input::SetPhaserOffset(int x, int y)
     m_PhaserOffset.y = y;
 }
 
+Input::stPhaser* Input::GetPhaserOffset()
+{
+    return &m_PhaserOffset;
+}
+
 Input::stPhaser* Input::GetPhaser()
 {
     return &m_Phaser;
@@ -178,6 +188,11 @@ void Input::SetPaddle(float x)
     m_Paddle.reg = (u8)floor(m_Paddle.x + 0.5f);
 }
 
+Input::stPaddle* Input::GetPaddle()
+{
+    return &m_Paddle;
+}
+
 bool Input::IsPaddleEnabled()
 {
     return m_bPaddle;
@@ -193,10 +208,12 @@ void Input::SetGlassesRegistry(u8 value)
     m_GlassesRegistry = value;
 }
 
-void Input::SaveState(std::ostream& stream)
+void Input::SaveState(state_writer& stream)
 {
     using namespace std;
 
+    stream.section(GS_State_Section_Input);
+
     stream.write(reinterpret_cast<const char*> (&m_Joypad1), sizeof(m_Joypad1));
     stream.write(reinterpret_cast<const char*> (&m_Joypad2), sizeof(m_Joypad2));
     stream.write(reinterpret_cast<const char*> (&m_GlassesRegistry), sizeof(m_GlassesRegistry));
@@ -206,7 +223,7 @@ void Input::SaveState(std::ostream& stream)
     stream.write(reinterpret_cast<const char*> (&m_Paddle), sizeof(m_Paddle));
 }
 
-void Input::LoadState(std::istream& stream)
+void Input::LoadState(state_reader& stream)
 {
     using namespace std;
 
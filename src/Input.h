@@ -21,6 +21,7 @@
 #define	INPUT_H
 
 #include "definitions.h"
+#include "state_serializer.h"
 
 class Memory;
 class Processor;
@@ -51,13 +52,16 @@ public:
     void KeyReleased(GS_Joypads joypad, GS_Keys key);
     bool IsKeyPressed(GS_Joypads joypad, GS_Keys key) const;
     void SetReset(bool pressed);
+    bool IsResetPressed();
     void EnablePhaser(bool enable);
     void SetPhaser(int x, int y);
     void SetPhaserOffset(int x, int y);
+    stPhaser* GetPhaserOffset();
     stPhaser* GetPhaser();
     bool IsPhaserEnabled();
     void EnablePaddle(bool enable);
     void SetPaddle(float x);
+    stPaddle* GetPaddle();
     bool IsPaddleEnabled();
     void SetTraceLogger(TraceLogger* pTraceLogger);
     u8 GetPortDC();
@@ -65,8 +69,8 @@ public:
     u8 GetPort00();
     u8 GetGlassesRegistry();
     void SetGlassesRegistry(u8 value);
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream);
+    void SaveState(state_writer& stream);
+    void LoadState(state_reader& stream);
 
 private:
     INLINE void TraceInputChangeEvent(u8 player, u8 key, u8 previous, u8 effective);
@@ -342,7 +342,7 @@ int IratahackMemoryRule::GetBank(int index)
     }
 }
 
-void IratahackMemoryRule::SaveState(std::ostream& stream)
+void IratahackMemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_pFlash), 0x80000);
     stream.write(reinterpret_cast<const char*> (m_iMapperSlot), sizeof(m_iMapperSlot));
@@ -352,7 +352,7 @@ void IratahackMemoryRule::SaveState(std::ostream& stream)
     stream.write(reinterpret_cast<const char*> (m_iFlashStep), sizeof(m_iFlashStep));
 }
 
-void IratahackMemoryRule::LoadState(std::istream& stream, int)
+void IratahackMemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
@@ -215,7 +215,7 @@ bool JanggunMemoryRule::Has8kBanks()
     return true;
 }
 
-void JanggunMemoryRule::SaveState(std::ostream& stream)
+void JanggunMemoryRule::SaveState(state_writer& stream)
 {
     int slotsWithFlags[4];
     for (int i = 0; i < 4; i++)
@@ -224,7 +224,7 @@ void JanggunMemoryRule::SaveState(std::ostream& stream)
     stream.write(reinterpret_cast<const char*> (m_iMapperSlotAddress), sizeof(m_iMapperSlotAddress));
 }
 
-void JanggunMemoryRule::LoadState(std::istream& stream, int)
+void JanggunMemoryRule::LoadState(state_reader& stream, int)
 {
     stream.read(reinterpret_cast<char*> (m_iMapperSlot), sizeof(m_iMapperSlot));
     stream.read(reinterpret_cast<char*> (m_iMapperSlotAddress), sizeof(m_iMapperSlotAddress));
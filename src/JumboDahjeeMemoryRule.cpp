@@ -70,12 +70,12 @@ int JumboDahjeeMemoryRule::GetBank(int index)
         return 0;
 }
 
-void JumboDahjeeMemoryRule::SaveState(std::ostream& stream)
+void JumboDahjeeMemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_pCartRAM), 0x2000);
 }
 
-void JumboDahjeeMemoryRule::LoadState(std::istream& stream, int version)
+void JumboDahjeeMemoryRule::LoadState(state_reader& stream, int version)
 {
     if (version >= 105)
         stream.read(reinterpret_cast<char*> (m_pCartRAM), 0x2000);
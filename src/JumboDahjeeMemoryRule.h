@@ -13,8 +13,8 @@ public:
     virtual void Reset();
     virtual u8* GetPage(int index);
     virtual int GetBank(int index);
-    virtual void SaveState(std::ostream& stream);
-    virtual void LoadState(std::istream& stream, int version);
+    virtual void SaveState(state_writer& stream);
+    virtual void LoadState(state_reader& stream, int version);
 
 private:
     u8* m_pCartRAM;
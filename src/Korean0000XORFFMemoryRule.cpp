@@ -132,13 +132,13 @@ bool Korean0000XORFFMemoryRule::Has8kBanks()
     return true;
 }
 
-void Korean0000XORFFMemoryRule::SaveState(std::ostream& stream)
+void Korean0000XORFFMemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_iPage), sizeof(m_iPage));
     stream.write(reinterpret_cast<const char*> (m_iPageAddress), sizeof(m_iPageAddress));
 }
 
-void Korean0000XORFFMemoryRule::LoadState(std::istream& stream, int)
+void Korean0000XORFFMemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
@@ -123,13 +123,13 @@ bool Korean2000XOR1FMemoryRule::Has8kBanks()
     return true;
 }
 
-void Korean2000XOR1FMemoryRule::SaveState(std::ostream& stream)
+void Korean2000XOR1FMemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_iPage), sizeof(m_iPage));
     stream.write(reinterpret_cast<const char*> (m_iPageAddress), sizeof(m_iPageAddress));
 }
 
-void Korean2000XOR1FMemoryRule::LoadState(std::istream& stream, int)
+void Korean2000XOR1FMemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
@@ -33,8 +33,8 @@ public:
     virtual u8* GetPage(int index);
     virtual int GetBank(int index);
     virtual bool Has8kBanks();
-    virtual void SaveState(std::ostream& stream);
-    virtual void LoadState(std::istream& stream, int version);
+    virtual void SaveState(state_writer& stream);
+    virtual void LoadState(state_reader& stream, int version);
 
 private:
     int m_iROMBankMask;
@@ -158,13 +158,13 @@ bool KoreanBFFCMemoryRule::Has8kBanks()
     return true;
 }
 
-void KoreanBFFCMemoryRule::SaveState(std::ostream& stream)
+void KoreanBFFCMemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_iPage), sizeof(m_iPage));
     stream.write(reinterpret_cast<const char*> (m_iPageAddress), sizeof(m_iPageAddress));
 }
 
-void KoreanBFFCMemoryRule::LoadState(std::istream& stream, int)
+void KoreanBFFCMemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
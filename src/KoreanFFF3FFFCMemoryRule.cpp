@@ -190,14 +190,14 @@ bool KoreanFFF3FFFCMemoryRule::Has8kBanks()
     return true;
 }
 
-void KoreanFFF3FFFCMemoryRule::SaveState(std::ostream& stream)
+void KoreanFFF3FFFCMemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_iPage), sizeof(m_iPage));
     stream.write(reinterpret_cast<const char*> (m_iPageAddress), sizeof(m_iPageAddress));
     stream.write(reinterpret_cast<const char*> (m_iRegister), sizeof(m_iRegister));
 }
 
-void KoreanFFF3FFFCMemoryRule::LoadState(std::istream& stream, int)
+void KoreanFFF3FFFCMemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
@@ -139,13 +139,13 @@ bool KoreanFFFEMemoryRule::Has8kBanks()
     return true;
 }
 
-void KoreanFFFEMemoryRule::SaveState(std::ostream& stream)
+void KoreanFFFEMemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_iPage), sizeof(m_iPage));
     stream.write(reinterpret_cast<const char*> (m_iPageAddress), sizeof(m_iPageAddress));
 }
 
-void KoreanFFFEMemoryRule::LoadState(std::istream& stream, int)
+void KoreanFFFEMemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
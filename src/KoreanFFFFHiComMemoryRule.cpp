@@ -102,13 +102,13 @@ int KoreanFFFFHiComMemoryRule::GetBank(int index)
     return m_iMapperSlot[index];
 }
 
-void KoreanFFFFHiComMemoryRule::SaveState(std::ostream& stream)
+void KoreanFFFFHiComMemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_iMapperSlotAddress), sizeof(m_iMapperSlotAddress));
     stream.write(reinterpret_cast<const char*> (m_iMapperSlot), sizeof(m_iMapperSlot));
 }
 
-void KoreanFFFFHiComMemoryRule::LoadState(std::istream& stream, int)
+void KoreanFFFFHiComMemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
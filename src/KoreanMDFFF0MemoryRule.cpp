@@ -157,14 +157,14 @@ bool KoreanMDFFF0MemoryRule::Has8kBanks()
     return true;
 }
 
-void KoreanMDFFF0MemoryRule::SaveState(std::ostream& stream)
+void KoreanMDFFF0MemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_iPage), sizeof(m_iPage));
     stream.write(reinterpret_cast<const char*> (m_iPageAddress), sizeof(m_iPageAddress));
     stream.write(reinterpret_cast<const char*> (m_iRegister), sizeof(m_iRegister));
 }
 
-void KoreanMDFFF0MemoryRule::LoadState(std::istream& stream, int)
+void KoreanMDFFF0MemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
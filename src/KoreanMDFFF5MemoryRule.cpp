@@ -152,14 +152,14 @@ bool KoreanMDFFF5MemoryRule::Has8kBanks()
     return true;
 }
 
-void KoreanMDFFF5MemoryRule::SaveState(std::ostream& stream)
+void KoreanMDFFF5MemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_iPage), sizeof(m_iPage));
     stream.write(reinterpret_cast<const char*> (m_iPageAddress), sizeof(m_iPageAddress));
     stream.write(reinterpret_cast<const char*> (&m_iRegister), sizeof(m_iRegister));
 }
 
-void KoreanMDFFF5MemoryRule::LoadState(std::istream& stream, int)
+void KoreanMDFFF5MemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
@@ -114,13 +114,13 @@ int KoreanMSX32KB2000MemoryRule::GetBank(int index)
     return m_iMapperSlot[index];
 }
 
-void KoreanMSX32KB2000MemoryRule::SaveState(std::ostream& stream)
+void KoreanMSX32KB2000MemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_iMapperSlotAddress), sizeof(m_iMapperSlotAddress));
     stream.write(reinterpret_cast<const char*> (m_iMapperSlot), sizeof(m_iMapperSlot));
 }
 
-void KoreanMSX32KB2000MemoryRule::LoadState(std::istream& stream, int)
+void KoreanMSX32KB2000MemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
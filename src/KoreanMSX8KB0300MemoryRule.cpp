@@ -108,13 +108,13 @@ bool KoreanMSX8KB0300MemoryRule::Has8kBanks()
     return true;
 }
 
-void KoreanMSX8KB0300MemoryRule::SaveState(std::ostream& stream)
+void KoreanMSX8KB0300MemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_iPageAddress), sizeof(m_iPageAddress));
     stream.write(reinterpret_cast<const char*> (m_iPage), sizeof(m_iPage));
 }
 
-void KoreanMSX8KB0300MemoryRule::LoadState(std::istream& stream, int)
+void KoreanMSX8KB0300MemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
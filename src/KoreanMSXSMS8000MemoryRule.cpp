@@ -138,14 +138,14 @@ bool KoreanMSXSMS8000MemoryRule::Has8kBanks()
     return true;
 }
 
-void KoreanMSXSMS8000MemoryRule::SaveState(std::ostream& stream)
+void KoreanMSXSMS8000MemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_iPage), sizeof(m_iPage));
     stream.write(reinterpret_cast<const char*> (m_iPageAddress), sizeof(m_iPageAddress));
     stream.write(reinterpret_cast<const char*> (&m_Register), sizeof(m_Register));
 }
 
-void KoreanMSXSMS8000MemoryRule::LoadState(std::istream& stream, int)
+void KoreanMSXSMS8000MemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
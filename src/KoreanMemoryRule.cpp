@@ -121,13 +121,13 @@ int KoreanMemoryRule::GetBank(int index)
     }
 }
 
-void KoreanMemoryRule::SaveState(std::ostream& stream)
+void KoreanMemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (&m_iMapperSlot2), sizeof(m_iMapperSlot2));
     stream.write(reinterpret_cast<const char*> (&m_iMapperSlot2Address), sizeof(m_iMapperSlot2Address));
 }
 
-void KoreanMemoryRule::LoadState(std::istream& stream, int)
+void KoreanMemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
@@ -115,13 +115,13 @@ int KoreanSMS32KB2000MemoryRule::GetBank(int index)
     return m_iMapperSlot[index];
 }
 
-void KoreanSMS32KB2000MemoryRule::SaveState(std::ostream& stream)
+void KoreanSMS32KB2000MemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_iMapperSlotAddress), sizeof(m_iMapperSlotAddress));
     stream.write(reinterpret_cast<const char*> (m_iMapperSlot), sizeof(m_iMapperSlot));
 }
 
-void KoreanSMS32KB2000MemoryRule::LoadState(std::istream& stream, int)
+void KoreanSMS32KB2000MemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
@@ -154,13 +154,13 @@ bool MSXMemoryRule::Has8kBanks()
     return true;
 }
 
-void MSXMemoryRule::SaveState(std::ostream& stream)
+void MSXMemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_iMapperSlot), sizeof(m_iMapperSlot));
     stream.write(reinterpret_cast<const char*> (m_iMapperSlotAddress), sizeof(m_iMapperSlotAddress));
 }
 
-void MSXMemoryRule::LoadState(std::istream& stream, int)
+void MSXMemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
@@ -193,11 +193,22 @@ void Memory::MemoryDump(const char* szFilePath)
     }
 }
 
-void Memory::SaveState(std::ostream& stream)
+void Memory::SaveState(state_writer& stream)
 {
     using namespace std;
 
-    stream.write(reinterpret_cast<const char*> (m_pMap), 0x10000);
+    // ROM slots are only ever loaded from the cartridge, except on SG-1000
+    // where cartridge RAM is mapped below $C000
+    if (!stream.compact() || m_pCartridge->IsSG1000())
+    {
+        stream.section(GS_State_Section_Memory);
+        stream.write(reinterpret_cast<const char*> (m_pMap), 0xC000);
+    }
+
+    stream.section(GS_State_Section_RAM);
+    stream.write(reinterpret_cast<const char*> (m_pMap + 0xC000), 0x4000);
+
+    stream.section(GS_State_Section_Memory);
     stream.write(reinterpret_cast<const char*> (&m_bIOEnabled), sizeof (m_bIOEnabled));
 
     u8 mediaSlot = (u8)m_MediaSlot;
@@ -209,11 +220,18 @@ void Memory::SaveState(std::ostream& stream)
     stream.write(reinterpret_cast<const char*> (&storedMediaSlot), sizeof(storedMediaSlot));
 }
 
-void Memory::LoadState(std::istream& stream, int version)
+void Memory::LoadState(state_reader& stream, int version)
 {
     using namespace std;
 
-    stream.read(reinterpret_cast<char*> (m_pMap), 0x10000);
+    if (stream.compact() && !m_pCartridge->IsSG1000())
+    {
+        LoadSlotsFromROM(m_pCartridge->GetROM(), m_pCartridge->GetROMSize());
+        stream.read(reinterpret_cast<char*> (m_pMap + 0xC000), 0x4000);
+    }
+    else
+        stream.read(reinterpret_cast<char*> (m_pMap), 0x10000);
+
     stream.read(reinterpret_cast<char*> (&m_bIOEnabled), sizeof (m_bIOEnabled));
 
     if (version >= 104)
@@ -21,6 +21,7 @@
 #define	MEMORY_H
 
 #include "definitions.h"
+#include "state_serializer.h"
 #include "log.h"
 #include "MemoryRule.h"
 #include <vector>
@@ -62,8 +63,8 @@ public:
     GS_Disassembler_Record** GetAllDisassemblerRecords();
     void LoadSlotsFromROM(u8* pTheROM, int size);
     void MemoryDump(const char* szFilePath);
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream, int version = GS_SAVESTATE_VERSION);
+    void SaveState(state_writer& stream);
+    void LoadState(state_reader& stream, int version = GS_SAVESTATE_VERSION);
     void EnableBootromSMS(bool enable);
     void EnableBootromGG(bool enable);
     void LoadBootromSMS(const char* szFilePath);
@@ -164,10 +164,10 @@ bool MemoryRule::Has8kBanks()
     return false;
 }
 
-void MemoryRule::SaveState(std::ostream&)
+void MemoryRule::SaveState(state_writer&)
 {
 }
 
-void MemoryRule::LoadState(std::istream&, int)
+void MemoryRule::LoadState(state_reader&, int)
 {
 }
@@ -21,6 +21,7 @@
 #define	MEMORYRULE_H
 
 #include "definitions.h"
+#include "state_serializer.h"
 #include "TraceLogger.h"
 #include "Cartridge.h"
 
@@ -46,8 +47,8 @@ public:
     virtual u8* GetPage(int index);
     virtual int GetBank(int index);
     virtual bool Has8kBanks();
-    virtual void SaveState(std::ostream& stream);
-    virtual void LoadState(std::istream& stream, int version = GS_SAVESTATE_VERSION);
+    virtual void SaveState(state_writer& stream);
+    virtual void LoadState(state_reader& stream, int version = GS_SAVESTATE_VERSION);
 
 protected:
     INLINE void TraceBankSwitchEvent(u16 address, u8 value, u8 flags = 0, u16 auxiliary = 0, bool flags_valid = false);
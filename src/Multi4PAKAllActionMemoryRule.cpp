@@ -123,13 +123,13 @@ int Multi4PAKAllActionMemoryRule::GetBank(int index)
     return m_iMapperSlotAddress[index] / 0x4000;
 }
 
-void Multi4PAKAllActionMemoryRule::SaveState(std::ostream& stream)
+void Multi4PAKAllActionMemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_iMapperSlotAddress), sizeof(m_iMapperSlotAddress));
     stream.write(reinterpret_cast<const char*> (m_iMapperSlot), sizeof(m_iMapperSlot));
 }
 
-void Multi4PAKAllActionMemoryRule::LoadState(std::istream& stream, int)
+void Multi4PAKAllActionMemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
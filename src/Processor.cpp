@@ -1239,10 +1239,12 @@ void Processor::CheckMemoryBreakpoints(int type, u16 address, bool read)
 #endif
 }
 
-void Processor::SaveState(std::ostream& stream)
+void Processor::SaveState(state_writer& stream)
 {
     using namespace std;
 
+    stream.section(GS_State_Section_CPU);
+
     u16 af = AF.GetValue();
     u16 bc = BC.GetValue();
     u16 de = DE.GetValue();
@@ -1292,12 +1294,13 @@ void Processor::SaveState(std::ostream& stream)
     stream.write(reinterpret_cast<const char*> (&m_QTemp), sizeof(m_QTemp));
 }
 
-void Processor::LoadState(std::istream& stream, int version)
+void Processor::LoadState(state_reader& stream, int version)
 {
     using namespace std;
 
-    u16 af, bc, de, hl, af2, bc2, de2, hl2, sp, pc, ix, iy, wz;
-    u8 i, r;
+    u16 af = 0, bc = 0, de = 0, hl = 0, af2 = 0, bc2 = 0, de2 = 0, hl2 = 0;
+    u16 sp = 0, pc = 0, ix = 0, iy = 0, wz = 0;
+    u8 i = 0, r = 0;
 
     stream.read(reinterpret_cast<char*> (&af), sizeof(af));
     stream.read(reinterpret_cast<char*> (&bc), sizeof(bc));
@@ -24,6 +24,7 @@
 #include <vector>
 #include <stack>
 #include "definitions.h"
+#include "state_serializer.h"
 #include "SixteenBitRegister.h"
 
 class Memory;
@@ -99,8 +100,8 @@ public:
     void RequestNMI();
     void SetIOPOrts(IOPorts* pIOPorts);
     IOPorts* GetIOPOrts();
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream, int version);
+    void SaveState(state_writer& stream);
+    void LoadState(state_reader& stream, int version);
     void SetProActionReplayCheat(const char* szCheat);
     void ClearProActionReplayCheats();
     ProcessorState* GetState();
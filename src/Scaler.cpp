@@ -0,0 +1,320 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include "Scaler.h"
+
+// Per-channel masks used to darken packed pixels without unpacking them.
+// half: (c >> 1) & half keeps the top bits of each channel
+// quarter: c - ((c >> 2) & quarter) is a 25% darken
+// keep: bits copied as-is (alpha)
+template <typename T>
+struct ScalerMasks
+{
+    T half;
+    T quarter;
+    T keep;
+};
+
+template <typename T>
+static INLINE T ScalerHalf(T c, const ScalerMasks<T>& masks)
+{
+    return (T)(((c >> 1) & masks.half) | (c & masks.keep));
+}
+
+template <typename T>
+static INLINE T ScalerDarken(T c, const ScalerMasks<T>& masks)
+{
+    return (T)(c - ((c >> 2) & masks.quarter));
+}
+
+template <typename T>
+static void ScalerNearestRow(const T* src, T* dst, int width, int factor)
+{
+    switch (factor)
+    {
+        case 1:
+            memcpy(dst, src, width * sizeof(T));
+            break;
+        case 2:
+            for (int x = 0; x < width; x++)
+            {
+                dst[(x * 2) + 0] = src[x];
+                dst[(x * 2) + 1] = src[x];
+            }
+            break;
+        case 3:
+            for (int x = 0; x < width; x++)
+            {
+                dst[(x * 3) + 0] = src[x];
+                dst[(x * 3) + 1] = src[x];
+                dst[(x * 3) + 2] = src[x];
+            }
+            break;
+        default:
+            for (int x = 0; x < width; x++)
+                for (int k = 0; k < factor; k++)
+                    dst[(x * factor) + k] = src[x];
+            break;
+    }
+}
+
+template <typename T>
+static void ScalerNearest(const T* src, T* dst, int width, int height, int factor)
+{
+    int dst_width = width * factor;
+
+    for (int y = 0; y < height; y++)
+    {
+        T* out = dst + (y * factor * dst_width);
+        ScalerNearestRow(src + (y * width), out, width, factor);
+
+        for (int k = 1; k < factor; k++)
+            memcpy(out + (k * dst_width), out, dst_width * sizeof(T));
+    }
+}
+
+template <typename T>
+static void ScalerLCD(const T* src, T* dst, int width, int height, int factor, const ScalerMasks<T>& masks)
+{
+    int dst_width = width * factor;
+
+    for (int y = 0; y < height; y++)
+    {
+        T* out = dst + (y * factor * dst_width);
+        ScalerNearestRow(src + (y * width), out, width, factor);
+
+        // Vertical grid line on the last column of every pixel
+        for (int x = factor - 1; x < dst_width; x += factor)
+            out[x] = ScalerDarken(out[x], masks);
+
+        for (int k = 1; k < factor - 1; k++)
+            memcpy(out + (k * dst_width), out, dst_width * sizeof(T));
+
+        // Horizontal grid line on the last row of every pixel
+        T* last = out + ((factor - 1) * dst_width);
+        for (int x = 0; x < dst_width; x++)
+            last[x] = ScalerDarken(out[x], masks);
+    }
+}
+
+template <typename T>
+static void ScalerScanlines(const T* src, T* dst, int width, int height, int factor, const ScalerMasks<T>& masks)
+{
+    int dst_width = width * factor;
+
+    for (int y = 0; y < height; y++)
+    {
+        T* out = dst + (y * factor * dst_width);
+        ScalerNearestRow(src + (y * width), out, width, factor);
+
+        for (int k = 1; k < factor - 1; k++)
+            memcpy(out + (k * dst_width), out, dst_width * sizeof(T));
+
+        T* last = out + ((factor - 1) * dst_width);
+        for (int x = 0; x < dst_width; x++)
+            last[x] = ScalerHalf(out[x], masks);
+    }
+}
+
+// Scale2x (EPX): every pixel E becomes a 2x2 block, corners take the color
+// of two matching orthogonal neighbours
+//   B
+// D E F
+//   H
+template <typename T>
+static void ScalerScale2x(const T* src, T* dst, int width, int height)
+{
+    int dst_width = width * 2;
+
+    for (int y = 0; y < height; y++)
+    {
+        const T* row = src + (y * width);
+        const T* up = (y > 0) ? row - width : row;
+        const T* down = (y < (height - 1)) ? row + width : row;
+        T* out0 = dst + (y * 2 * dst_width);
+        T* out1 = out0 + dst_width;
+
+        for (int x = 0; x < width; x++)
+        {
+            T b = up[x];
+            T d = row[(x > 0) ? x - 1 : x];
+            T e = row[x];
+            T f = row[(x < (width - 1)) ? x + 1 : x];
+            T h = down[x];
+
+            bool edge = (b != h) && (d != f);
+
+            out0[(x * 2) + 0] = (edge && (d == b)) ? d : e;
+            out0[(x * 2) + 1] = (edge && (b == f)) ? f : e;
+            out1[(x * 2) + 0] = (edge && (d == h)) ? d : e;
+            out1[(x * 2) + 1] = (edge && (h == f)) ? f : e;
+        }
+    }
+}
+
+// Scale3x (AdvMAME3x): every pixel E becomes a 3x3 block
+// A B C
+// D E F
+// G H I
+template <typename T>
+static void ScalerScale3x(const T* src, T* dst, int width, int height)
+{
+    int dst_width = width * 3;
+
+    for (int y = 0; y < height; y++)
+    {
+        const T* row = src + (y * width);
+        const T* up = (y > 0) ? row - width : row;
+        const T* down = (y < (height - 1)) ? row + width : row;
+        T* out0 = dst + (y * 3 * dst_width);
+        T* out1 = out0 + dst_width;
+        T* out2 = out1 + dst_width;
+
+        for (int x = 0; x < width; x++)
+        {
+            int xl = (x > 0) ? x - 1 : x;
+            int xr = (x < (width - 1)) ? x + 1 : x;
+            T a = up[xl], b = up[x], c = up[xr];
+            T d = row[xl], e = row[x], f = row[xr];
+            T g = down[xl], h = down[x], i = down[xr];
+            T* o0 = out0 + (x * 3);
+            T* o1 = out1 + (x * 3);
+            T* o2 = out2 + (x * 3);
+
+            if ((b != h) && (d != f))
+            {
+                o0[0] = (d == b) ? d : e;
+                o0[1] = (((d == b) && (e != c)) || ((b == f) && (e != a))) ? b : e;
+                o0[2] = (b == f) ? f : e;
+                o1[0] = (((d == b) && (e != g)) || ((d == h) && (e != a))) ? d : e;
+                o1[1] = e;
+                o1[2] = (((b == f) && (e != i)) || ((h == f) && (e != c))) ? f : e;
+                o2[0] = (d == h) ? d : e;
+                o2[1] = (((d == h) && (e != i)) || ((h == f) && (e != g))) ? h : e;
+                o2[2] = (h == f) ? f : e;
+            }
+            else
+            {
+                o0[0] = o0[1] = o0[2] = e;
+                o1[0] = o1[1] = o1[2] = e;
+                o2[0] = o2[1] = o2[2] = e;
+            }
+        }
+    }
+}
+
+template <typename T>
+static void ScalerRun(Scaler::Filter filter, int factor, const u8* srcFrameBuffer, u8* dstFrameBuffer, int width, int height, const ScalerMasks<T>& masks)
+{
+    const T* src = reinterpret_cast<const T*>(srcFrameBuffer);
+    T* dst = reinterpret_cast<T*>(dstFrameBuffer);
+
+    switch (filter)
+    {
+        case Scaler::FilterScale2x:
+            ScalerScale2x(src, dst, width, height);
+            break;
+        case Scaler::FilterScale3x:
+            ScalerScale3x(src, dst, width, height);
+            break;
+        case Scaler::FilterLCD:
+            if (factor > 1)
+                ScalerLCD(src, dst, width, height, factor, masks);
+            else
+                ScalerNearest(src, dst, width, height, factor);
+            break;
+        case Scaler::FilterScanlines:
+            if (factor > 1)
+                ScalerScanlines(src, dst, width, height, factor, masks);
+            else
+                ScalerNearest(src, dst, width, height, factor);
+            break;
+        default:
+            ScalerNearest(src, dst, width, height, factor);
+            break;
+    }
+}
+
+Scaler::Scaler()
+{
+    m_Filter = FilterNearest;
+    m_iFactor = 1;
+}
+
+Scaler::~Scaler()
+{
+}
+
+void Scaler::SetFilter(Filter filter, int factor)
+{
+    m_Filter = filter;
+    m_iFactor = FactorForFilter(filter, factor);
+}
+
+Scaler::Filter Scaler::GetFilter()
+{
+    return m_Filter;
+}
+
+int Scaler::GetFactor()
+{
+    return m_iFactor;
+}
+
+int Scaler::FactorForFilter(Filter filter, int factor)
+{
+    if (filter == FilterScale2x)
+        return 2;
+    else if (filter == FilterScale3x)
+        return 3;
+    else
+        return CLAMP(factor, 1, GS_SCALER_MAX_FACTOR);
+}
+
+int Scaler::BytesPerPixel(GS_Color_Format pixelFormat)
+{
+    return ((pixelFormat == GS_PIXEL_RGBA8888) || (pixelFormat == GS_PIXEL_BGRA8888)) ? 4 : 2;
+}
+
+void Scaler::Scale(const u8* srcFrameBuffer, u8* dstFrameBuffer, int width, int height, GS_Color_Format pixelFormat)
+{
+    switch (pixelFormat)
+    {
+        case GS_PIXEL_RGBA8888:
+        case GS_PIXEL_BGRA8888:
+        {
+            ScalerMasks<u32> masks = { 0x007F7F7F, 0x003F3F3F, 0xFF000000 };
+            ScalerRun<u32>(m_Filter, m_iFactor, srcFrameBuffer, dstFrameBuffer, width, height, masks);
+            break;
+        }
+        case GS_PIXEL_RGB565:
+        case GS_PIXEL_BGR565:
+        {
+            ScalerMasks<u16> masks = { 0x7BEF, 0x39E7, 0x0000 };
+            ScalerRun<u16>(m_Filter, m_iFactor, srcFrameBuffer, dstFrameBuffer, width, height, masks);
+            break;
+        }
+        default:
+        {
+            ScalerMasks<u16> masks = { 0x3DEF, 0x1CE7, 0x8000 };
+            ScalerRun<u16>(m_Filter, m_iFactor, srcFrameBuffer, dstFrameBuffer, width, height, masks);
+            break;
+        }
+    }
+}
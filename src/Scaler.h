@@ -0,0 +1,57 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef SCALER_H
+#define SCALER_H
+
+#include "definitions.h"
+
+#define GS_SCALER_MAX_FACTOR 4
+
+// Upscales a converted frame (any GS_Color_Format) on the CPU. Used by
+// frontends without a GPU pipeline: libretro software output, headless
+// screenshots and thumbnails.
+class Scaler
+{
+public:
+    enum Filter
+    {
+        FilterNearest,
+        FilterScale2x,
+        FilterScale3x,
+        FilterLCD,
+        FilterScanlines
+    };
+
+public:
+    Scaler();
+    ~Scaler();
+    void SetFilter(Filter filter, int factor);
+    Filter GetFilter();
+    int GetFactor();
+    void Scale(const u8* srcFrameBuffer, u8* dstFrameBuffer, int width, int height, GS_Color_Format pixelFormat);
+    static int FactorForFilter(Filter filter, int factor);
+    static int BytesPerPixel(GS_Color_Format pixelFormat);
+
+private:
+    Filter m_Filter;
+    int m_iFactor;
+};
+
+#endif /* SCALER_H */
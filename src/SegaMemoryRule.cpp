@@ -260,7 +260,7 @@ int SegaMemoryRule::GetBank(int index)
     }
 }
 
-void SegaMemoryRule::SaveState(std::ostream& stream)
+void SegaMemoryRule::SaveState(state_writer& stream)
 {
     stream.write(reinterpret_cast<const char*> (m_pRAMBanks), 0x8000);
     stream.write(reinterpret_cast<const char*> (m_iMapperSlot), sizeof(m_iMapperSlot));
@@ -270,7 +270,7 @@ void SegaMemoryRule::SaveState(std::ostream& stream)
     stream.write(reinterpret_cast<const char*> (&m_iPersistRAM), sizeof(m_iPersistRAM));
 }
 
-void SegaMemoryRule::LoadState(std::istream& stream, int)
+void SegaMemoryRule::LoadState(state_reader& stream, int)
 {
     using namespace std;
 
@@ -91,14 +91,14 @@ void SmsIOPorts::Reset()
     m_Port3F = 0xFF;
 }
 
-void SmsIOPorts::SaveState(std::ostream& stream)
+void SmsIOPorts::SaveState(state_writer& stream)
 {
     using namespace std;
 
     stream.write(reinterpret_cast<const char*> (&m_Port3F), sizeof(m_Port3F));
 }
 
-void SmsIOPorts::LoadState(std::istream& stream)
+void SmsIOPorts::LoadState(state_reader& stream)
 {
     using namespace std;
 
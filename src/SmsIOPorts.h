@@ -38,8 +38,8 @@ public:
     void Reset();
     u8 DoInput(u8 port);
     void DoOutput(u8 port, u8 value);
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream);
+    void SaveState(state_writer& stream);
+    void LoadState(state_reader& stream);
     void SetTraceLogger(TraceLogger* pTraceLogger);
 
 private:
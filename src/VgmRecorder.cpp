@@ -24,6 +24,7 @@
 VgmRecorder::VgmRecorder()
 {
     m_bRecording = false;
+    m_iActiveBuffer = 0;
     m_PendingWait = 0;
     m_TotalSamples = 0;
     m_ClockRate = 0;
@@ -31,6 +32,10 @@ VgmRecorder::VgmRecorder()
     m_bPAL = false;
     m_bHasYM2413 = false;
     m_YM2413Register = 0;
+#if !defined(GS_DISABLE_VGMRECORDER)
+    InitPointer(m_pPendingBuffer);
+    m_bQuit = false;
+#endif
 }
 
 VgmRecorder::~VgmRecorder()
@@ -53,13 +58,37 @@ void VgmRecorder::Start(const char* file_path, int clock_rate, bool is_pal, bool
     m_ClockRate = clock_rate;
     m_bPAL = is_pal;
     m_bHasYM2413 = has_ym2413;
-    m_bRecording = true;
     m_PendingWait = 0;
     m_TotalSamples = 0;
     m_TimingRemainder = 0;
     m_YM2413Register = 0;
-    m_CommandBuffer.clear();
-    m_CommandBuffer.reserve(1024 * 1024); // Reserve 1MB
+
+    m_File.open(m_FilePath.c_str(), std::ios::binary | std::ios::trunc);
+    if (!m_File.is_open())
+    {
+        Log("VGM Recorder: Unable to open %s", m_FilePath.c_str());
+        return;
+    }
+
+    // The sizes are patched in Stop(), once they are known
+    u8 header[256];
+    BuildHeader(header, 0, 0);
+    m_File.write(reinterpret_cast<const char*>(header), 256);
+
+    m_iActiveBuffer = 0;
+    for (int i = 0; i < 2; i++)
+    {
+        m_Buffers[i].clear();
+        m_Buffers[i].reserve(GS_VGM_FLUSH_SIZE + 16);
+    }
+
+#if !defined(GS_DISABLE_VGMRECORDER)
+    m_pPendingBuffer = NULL;
+    m_bQuit = false;
+    m_WriterThread = std::thread(&VgmRecorder::RunWriter, this);
+#endif
+
+    m_bRecording = true;
 }
 
 void VgmRecorder::Stop()
@@ -72,115 +101,156 @@ void VgmRecorder::Stop()
     // Write end of sound data command
     WriteCommand(0x66);
 
+    WaitWriter();
+
+#if !defined(GS_DISABLE_VGMRECORDER)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bQuit = true;
+    }
+    m_WorkCondition.notify_one();
+    m_WriterThread.join();
+#endif
+
+    std::vector<u8>& remaining = m_Buffers[m_iActiveBuffer];
+    if (!remaining.empty())
+        m_File.write(reinterpret_cast<const char*>(&remaining[0]), remaining.size());
+
+    u32 data_size = (u32)m_File.tellp() - 256;
+
     std::vector<u8> gd3_tag;
     BuildGD3Tag(gd3_tag, m_Metadata);
+    m_File.write(reinterpret_cast<const char*>(&gd3_tag[0]), gd3_tag.size());
+
+    u8 header[256];
+    BuildHeader(header, data_size, (u32)gd3_tag.size());
+    m_File.seekp(0);
+    m_File.write(reinterpret_cast<const char*>(header), 256);
+
+    if (m_File.fail())
+        Log("VGM Recorder: Error writing %s", m_FilePath.c_str());
+
+    m_File.close();
+
+    m_bRecording = false;
+
+    for (int i = 0; i < 2; i++)
+        std::vector<u8>().swap(m_Buffers[i]);
+}
+
+void VgmRecorder::BuildHeader(u8* header, u32 data_size, u32 gd3_size)
+{
+    memset(header, 0, 256);
+
+    // File identification "Vgm " (0x56 0x67 0x6d 0x20)
+    header[0x00] = 0x56;
+    header[0x01] = 0x67;
+    header[0x02] = 0x6d;
+    header[0x03] = 0x20;
+
+    // EOF offset (file length - 4)
+    u32 gd3_offset = 256 + data_size;
+    write_u32_le(&header[0x04], gd3_offset + gd3_size - 4);
+
+    // Version number (1.70 = 0x00000170)
+    write_u32_le(&header[0x08], 0x00000170);
+
+    // SN76489 clock
+    write_u32_le(&header[0x0C], (u32)m_ClockRate);
 
-    std::ofstream file(m_FilePath.c_str(), std::ios::binary);
-    if (file.is_open())
+    // YM2413 clock
+    if (m_bHasYM2413)
+        write_u32_le(&header[0x10], (u32)m_ClockRate);
+
+    // GD3 offset (relative from 0x14), 0 while the tag is not written yet
+    if (gd3_size > 0)
+        write_u32_le(&header[0x14], gd3_offset - 0x14);
+
+    // Total # samples
+    write_u32_le(&header[0x18], (u32)m_TotalSamples);
+
+    // Loop offset and loop # samples (0 = no loop)
+    write_u32_le(&header[0x1C], 0);
+    write_u32_le(&header[0x20], 0);
+
+    // Rate
+    write_u32_le(&header[0x24], m_bPAL ? 50 : 60);
+
+    // SN76489 feedback (0x0009 for SMS/GG)
+    header[0x28] = 0x09;
+    header[0x29] = 0x00;
+
+    // SN76489 shift register width (16 for SMS/GG)
+    header[0x2A] = 0x10;
+
+    // SN76489 Flags (bit 2 = GameGear stereo)
+    header[0x2B] = 0x00;
+
+    // VGM data offset (0x0000000C for version 1.50+)
+    // Data starts at 0x40, so offset from 0x34 is 0x0C
+    write_u32_le(&header[0x34], 0x0000000C);
+}
+
+void VgmRecorder::SubmitBuffer()
+{
+    std::vector<u8>& active = m_Buffers[m_iActiveBuffer];
+
+#if !defined(GS_DISABLE_VGMRECORDER)
     {
-        u8 header[256];
-        memset(header, 0, 256);
-
-        // File identification "Vgm " (0x56 0x67 0x6d 0x20)
-        header[0x00] = 0x56;
-        header[0x01] = 0x67;
-        header[0x02] = 0x6d;
-        header[0x03] = 0x20;
-
-        // EOF offset (file length - 4)
-        u32 gd3_offset = 256 + (u32)m_CommandBuffer.size();
-        u32 eof_offset = gd3_offset + (u32)gd3_tag.size() - 4;
-        header[0x04] = (eof_offset >> 0) & 0xFF;
-        header[0x05] = (eof_offset >> 8) & 0xFF;
-        header[0x06] = (eof_offset >> 16) & 0xFF;
-        header[0x07] = (eof_offset >> 24) & 0xFF;
-
-        // Version number (1.70 = 0x00000170)
-        header[0x08] = 0x70;
-        header[0x09] = 0x01;
-        header[0x0A] = 0x00;
-        header[0x0B] = 0x00;
-
-        // SN76489 clock
-        u32 psg_clock = m_ClockRate;
-        header[0x0C] = (psg_clock >> 0) & 0xFF;
-        header[0x0D] = (psg_clock >> 8) & 0xFF;
-        header[0x0E] = (psg_clock >> 16) & 0xFF;
-        header[0x0F] = (psg_clock >> 24) & 0xFF;
-
-        // YM2413 clock
-        if (m_bHasYM2413)
-        {
-            u32 ym2413_clock = m_ClockRate;
-            header[0x10] = (ym2413_clock >> 0) & 0xFF;
-            header[0x11] = (ym2413_clock >> 8) & 0xFF;
-            header[0x12] = (ym2413_clock >> 16) & 0xFF;
-            header[0x13] = (ym2413_clock >> 24) & 0xFF;
-        }
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        // The writer is still busy with the other buffer. Keep appending to
+        // this one instead of stalling the emulation, it will be handed over
+        // on the next command.
+        if (IsValidPointer(m_pPendingBuffer))
+            return;
 
-        // GD3 offset (relative from 0x14)
-        u32 gd3_relative_offset = gd3_offset - 0x14;
-        header[0x14] = (gd3_relative_offset >> 0) & 0xFF;
-        header[0x15] = (gd3_relative_offset >> 8) & 0xFF;
-        header[0x16] = (gd3_relative_offset >> 16) & 0xFF;
-        header[0x17] = (gd3_relative_offset >> 24) & 0xFF;
-
-        // Total # samples
-        header[0x18] = (m_TotalSamples >> 0) & 0xFF;
-        header[0x19] = (m_TotalSamples >> 8) & 0xFF;
-        header[0x1A] = (m_TotalSamples >> 16) & 0xFF;
-        header[0x1B] = (m_TotalSamples >> 24) & 0xFF;
-
-        // Loop offset (0 = no loop)
-        header[0x1C] = 0x00;
-        header[0x1D] = 0x00;
-        header[0x1E] = 0x00;
-        header[0x1F] = 0x00;
-
-        // Loop # samples (0 = no loop)
-        header[0x20] = 0x00;
-        header[0x21] = 0x00;
-        header[0x22] = 0x00;
-        header[0x23] = 0x00;
-
-        u32 rate = m_bPAL ? 50 : 60;
-        header[0x24] = (rate >> 0) & 0xFF;
-        header[0x25] = (rate >> 8) & 0xFF;
-        header[0x26] = (rate >> 16) & 0xFF;
-        header[0x27] = (rate >> 24) & 0xFF;
-
-        // SN76489 feedback (0x0009 for SMS/GG)
-        header[0x28] = 0x09;
-        header[0x29] = 0x00;
-
-        // SN76489 shift register width (16 for SMS/GG)
-        header[0x2A] = 0x10;
-
-        // SN76489 Flags (bit 2 = GameGear stereo)
-        header[0x2B] = 0x00;
-
-        // VGM data offset (0x0000000C for version 1.50+)
-        // Data starts at 0x40, so offset from 0x34 is 0x0C
-        header[0x34] = 0x0C;
-        header[0x35] = 0x00;
-        header[0x36] = 0x00;
-        header[0x37] = 0x00;
-
-        // Write header
-        file.write(reinterpret_cast<const char*>(header), 256);
-
-        // Write command buffer
-        file.write(reinterpret_cast<const char*>(&m_CommandBuffer[0]), m_CommandBuffer.size());
-
-        // Write GD3 tag
-        file.write(reinterpret_cast<const char*>(&gd3_tag[0]), gd3_tag.size());
-
-        file.close();
+        m_pPendingBuffer = &active;
     }
 
-    m_bRecording = false;
-    m_CommandBuffer.clear();
+    m_iActiveBuffer ^= 1;
+    m_WorkCondition.notify_one();
+#else
+    m_File.write(reinterpret_cast<const char*>(&active[0]), active.size());
+    active.clear();
+#endif
+}
+
+void VgmRecorder::WaitWriter()
+{
+#if !defined(GS_DISABLE_VGMRECORDER)
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    while (IsValidPointer(m_pPendingBuffer))
+        m_DoneCondition.wait(lock);
+#endif
+}
+
+#if !defined(GS_DISABLE_VGMRECORDER)
+void VgmRecorder::RunWriter()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    while (true)
+    {
+        while (!m_bQuit && !IsValidPointer(m_pPendingBuffer))
+            m_WorkCondition.wait(lock);
+
+        if (!IsValidPointer(m_pPendingBuffer))
+            break;
+
+        std::vector<u8>* buffer = m_pPendingBuffer;
+
+        lock.unlock();
+        m_File.write(reinterpret_cast<const char*>(&(*buffer)[0]), buffer->size());
+        buffer->clear();
+        lock.lock();
+
+        m_pPendingBuffer = NULL;
+        m_DoneCondition.notify_all();
+    }
 }
+#endif
 
 void VgmRecorder::WritePSG(u8 data)
 {
@@ -228,20 +298,29 @@ void VgmRecorder::WriteYM2413(u8 port, u8 data)
 
 void VgmRecorder::WriteCommand(u8 command)
 {
-    m_CommandBuffer.push_back(command);
+    std::vector<u8>& buffer = m_Buffers[m_iActiveBuffer];
+    buffer.push_back(command);
+    if (buffer.size() >= GS_VGM_FLUSH_SIZE)
+        SubmitBuffer();
 }
 
 void VgmRecorder::WriteCommand(u8 command, u8 data)
 {
-    m_CommandBuffer.push_back(command);
-    m_CommandBuffer.push_back(data);
+    std::vector<u8>& buffer = m_Buffers[m_iActiveBuffer];
+    buffer.push_back(command);
+    buffer.push_back(data);
+    if (buffer.size() >= GS_VGM_FLUSH_SIZE)
+        SubmitBuffer();
 }
 
 void VgmRecorder::WriteCommand(u8 command, u8 data1, u8 data2)
 {
-    m_CommandBuffer.push_back(command);
-    m_CommandBuffer.push_back(data1);
-    m_CommandBuffer.push_back(data2);
+    std::vector<u8>& buffer = m_Buffers[m_iActiveBuffer];
+    buffer.push_back(command);
+    buffer.push_back(data1);
+    buffer.push_back(data2);
+    if (buffer.size() >= GS_VGM_FLUSH_SIZE)
+        SubmitBuffer();
 }
 
 void VgmRecorder::WriteWait(int samples)
@@ -272,17 +351,13 @@ void VgmRecorder::WriteWait(int samples)
         else if (samples <= 65535)
         {
             // 0x61 nn nn - Wait n samples
-            WriteCommand(0x61);
-            m_CommandBuffer.push_back(samples & 0xFF);
-            m_CommandBuffer.push_back((samples >> 8) & 0xFF);
+            WriteCommand(0x61, samples & 0xFF, (samples >> 8) & 0xFF);
             samples = 0;
         }
         else
         {
             // Write maximum wait and continue
-            WriteCommand(0x61);
-            m_CommandBuffer.push_back(0xFF);
-            m_CommandBuffer.push_back(0xFF);
+            WriteCommand(0x61, 0xFF, 0xFF);
             samples -= 65535;
         }
     }
@@ -25,6 +25,17 @@
 #include <string>
 #include <fstream>
 
+#if !defined(GS_DISABLE_VGMRECORDER)
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+
+// Wait commands are always in 44100 Hz samples, whatever the output rate
+#define GS_VGM_SAMPLE_RATE 44100
+// Commands are handed to the writer thread in blocks of this size
+#define GS_VGM_FLUSH_SIZE (64 * 1024)
+
 struct VgmMetadata
 {
     std::string game_name;
@@ -48,6 +59,12 @@ public:
     void UpdateTiming(unsigned int elapsed_cycles);
     
 private:
+    void BuildHeader(u8* header, u32 data_size, u32 gd3_size);
+    void SubmitBuffer();
+    void WaitWriter();
+#if !defined(GS_DISABLE_VGMRECORDER)
+    void RunWriter();
+#endif
     void WriteCommand(u8 command);
     void WriteCommand(u8 command, u8 data);
     void WriteCommand(u8 command, u8 data1, u8 data2);
@@ -62,7 +79,9 @@ private:
     bool m_bRecording;
     std::string m_FilePath;
     VgmMetadata m_Metadata;
-    std::vector<u8> m_CommandBuffer;
+    std::ofstream m_File;
+    std::vector<u8> m_Buffers[2];
+    int m_iActiveBuffer;
     int m_PendingWait;
     int m_TotalSamples;
     int m_ClockRate;
@@ -70,6 +89,14 @@ private:
     bool m_bPAL;
     bool m_bHasYM2413;
     u8 m_YM2413Register;
+#if !defined(GS_DISABLE_VGMRECORDER)
+    std::thread m_WriterThread;
+    std::mutex m_Mutex;
+    std::condition_variable m_WorkCondition;
+    std::condition_variable m_DoneCondition;
+    std::vector<u8>* m_pPendingBuffer;
+    bool m_bQuit;
+#endif
 };
 
 INLINE void VgmRecorder::UpdateTiming(unsigned int elapsed_cycles)
@@ -77,7 +104,7 @@ INLINE void VgmRecorder::UpdateTiming(unsigned int elapsed_cycles)
     if (!m_bRecording || m_ClockRate <= 0)
         return;
 
-    m_TimingRemainder += (u64)elapsed_cycles * GS_AUDIO_SAMPLE_RATE;
+    m_TimingRemainder += (u64)elapsed_cycles * GS_VGM_SAMPLE_RATE;
     int elapsed_samples = (int)(m_TimingRemainder / (u64)m_ClockRate);
     m_TimingRemainder %= (u64)m_ClockRate;
     m_PendingWait += elapsed_samples;
@@ -22,6 +22,7 @@
 #include "Processor.h"
 #include "Cartridge.h"
 #include "TraceLogger.h"
+#include "VideoRenderThread.h"
 
 Video::Video(Memory* pMemory, Processor* pProcessor, Cartridge* pCartridge)
 {
@@ -33,7 +34,12 @@ Video::Video(Memory* pMemory, Processor* pProcessor, Cartridge* pCartridge)
     InitPointer(m_pVdpVRAM);
     InitPointer(m_pVdpCRAM);
     InitPointer(m_pTraceLogger);
+    InitPointer(m_pLastFrameBuffer);
+#if !defined(GS_DISABLE_RENDER_THREAD)
+    InitPointer(m_pRenderThread);
+#endif
     m_bGGPaletteExternalAccess = false;
+    m_TMS9918Cache.mode = -1;
     m_bFirstByteInSequence = false;
     for (int i = 0; i < 16; i++)
         m_VdpRegister[i] = 0;
@@ -81,12 +87,17 @@ Video::Video(Memory* pMemory, Processor* pProcessor, Cartridge* pCartridge)
     m_bLightPhaserCrosshair = false;
     m_LightPhaserCrosshairShape = LightPhaserCrosshairCross;
     m_LightPhaserCrosshairColor = LightPhaserCrosshairWhite;
+    m_bLastFrameValid = false;
 }
 
 Video::~Video()
 {
+#if !defined(GS_DISABLE_RENDER_THREAD)
+    SafeDelete(m_pRenderThread);
+#endif
     SafeDeleteArray(m_pInfoBuffer);
     SafeDeleteArray(m_pFrameBuffer);
+    SafeDeleteArray(m_pLastFrameBuffer);
     SafeDeleteArray(m_pVdpVRAM);
     SafeDeleteArray(m_pVdpCRAM);
 }
@@ -94,6 +105,7 @@ Video::~Video()
 void Video::Init()
 {
     m_pFrameBuffer = new u16[GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN];
+    m_pLastFrameBuffer = new u16[GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN];
     m_pInfoBuffer = new u8[GS_RESOLUTION_MAX_WIDTH * GS_LINES_PER_FRAME_PAL];
     m_pVdpVRAM = new u8[0x4000];
     m_pVdpCRAM = new u8[0x40];
@@ -168,8 +180,105 @@ void Video::SetNoSpriteLimit(bool noSpriteLimit)
     m_bNoSpriteLimit = noSpriteLimit;
 }
 
+bool Video::IsNoSpriteLimit()
+{
+    return m_bNoSpriteLimit;
+}
+
+void Video::SetThreadedRendering(bool enable)
+{
+#if !defined(GS_DISABLE_RENDER_THREAD)
+    if (enable == IsValidPointer(m_pRenderThread))
+        return;
+
+    if (enable)
+    {
+        m_pRenderThread = new VideoRenderThread(this);
+        Debug("Video: threaded rendering enabled");
+    }
+    else
+    {
+        SafeDelete(m_pRenderThread);
+        Debug("Video: threaded rendering disabled");
+    }
+#else
+    UNUSED(enable);
+#endif
+}
+
+bool Video::IsThreadedRendering()
+{
+#if !defined(GS_DISABLE_RENDER_THREAD)
+    return IsValidPointer(m_pRenderThread);
+#else
+    return false;
+#endif
+}
+
+void Video::WaitForRender()
+{
+#if !defined(GS_DISABLE_RENDER_THREAD)
+    if (IsValidPointer(m_pRenderThread))
+        m_pRenderThread->Wait();
+#endif
+}
+
+bool Video::CheckFrameChanged(const u8* dstFrameBuffer, GS_Color_Format pixelFormat)
+{
+    FrameSignature signature;
+    signature.dst = dstFrameBuffer;
+    signature.pixel_format = pixelFormat;
+    signature.overscan = m_Overscan;
+    signature.overscan_color = m_bTMS9918 ? m_VdpRegister[7] & 0x0F : CachedColorFromPalette((m_VdpRegister[7] & 0x0F) + 16);
+    signature.hide_left_bar_offset = m_iHideLeftBarOffset;
+    signature.extended_mode_224 = m_bExtendedMode224;
+    signature.tms9918 = m_bTMS9918;
+    signature.pal = m_bPAL;
+    signature.gg_palette = m_bGameGear && !m_bGameGearSMSMode;
+
+    bool changed = !m_bLastFrameValid ||
+            (signature.dst != m_LastFrameSignature.dst) ||
+            (signature.pixel_format != m_LastFrameSignature.pixel_format) ||
+            (signature.overscan != m_LastFrameSignature.overscan) ||
+            (signature.overscan_color != m_LastFrameSignature.overscan_color) ||
+            (signature.hide_left_bar_offset != m_LastFrameSignature.hide_left_bar_offset) ||
+            (signature.extended_mode_224 != m_LastFrameSignature.extended_mode_224) ||
+            (signature.tms9918 != m_LastFrameSignature.tms9918) ||
+            (signature.pal != m_LastFrameSignature.pal) ||
+            (signature.gg_palette != m_LastFrameSignature.gg_palette);
+
+    // Exact compare, one row at a time, copying only the rows that differ
+    const int width = GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN;
+    const size_t row_size = width * sizeof(u16);
+
+    for (int row = 0; row < GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN; row++)
+    {
+        const u16* src = m_pFrameBuffer + (row * width);
+        u16* last = m_pLastFrameBuffer + (row * width);
+
+        if (memcmp(src, last, row_size) != 0)
+        {
+            memcpy(last, src, row_size);
+            changed = true;
+        }
+    }
+
+    m_LastFrameSignature = signature;
+    m_bLastFrameValid = true;
+
+    return changed;
+}
+
+void Video::InvalidateFrameCache()
+{
+    m_bLastFrameValid = false;
+}
+
 void Video::Reset(bool bGameGear, bool bPAL, int iGGASIC, bool bGameGearSMSMode)
 {
+    WaitForRender();
+    InvalidateFrameCache();
+
     m_bGameGear = bGameGear;
     m_bGameGearSMSMode = bGameGearSMSMode;
     m_iGameGearASIC = iGGASIC;
@@ -195,6 +304,7 @@ void Video::Reset(bool bGameGear, bool bPAL, int iGGASIC, bool bGameGearSMSMode)
         m_pInfoBuffer[i] = 0;
     for (int i = 0; i < 0x4000; i++)
         m_pVdpVRAM[i] = 0;
+    InvalidateVRAMCaches();
     for (int i = 0; i < 0x40; i++)
         m_pVdpCRAM[i] = 0;
 
@@ -603,6 +713,10 @@ void Video::WriteData(u8 data)
         m_pVdpCRAM[cram_addr] = data;
         if (m_bGameGear && !m_bGameGearSMSMode)
             UpdateGGPalette(cram_addr >> 1);
+#if !defined(GS_DISABLE_RENDER_THREAD)
+        if (IsValidPointer(m_pRenderThread))
+            m_pRenderThread->LogWrite(VideoRenderThread::WriteCRAM, cram_addr, data);
+#endif
 #if !defined(GS_DISABLE_DISASSEMBLER)
         m_pProcessor->CheckMemoryBreakpoints(Processor::GS_BREAKPOINT_TYPE_CRAM, cram_addr, false);
 #endif
@@ -611,6 +725,11 @@ void Video::WriteData(u8 data)
     else
     {
         m_pVdpVRAM[m_VdpAddress] = data;
+        InvalidateTMS9918Cache(m_VdpAddress);
+#if !defined(GS_DISABLE_RENDER_THREAD)
+        if (IsValidPointer(m_pRenderThread))
+            m_pRenderThread->LogWrite(VideoRenderThread::WriteVRAM, m_VdpAddress, data);
+#endif
 #if !defined(GS_DISABLE_DISASSEMBLER)
         m_pProcessor->CheckMemoryBreakpoints(Processor::GS_BREAKPOINT_TYPE_VRAM, m_VdpAddress, false);
 #endif
@@ -669,24 +788,11 @@ void Video::WriteControl(u8 data)
 
                     if (old_bit7 != new_bit7)
                     {
-                        u8 temp[0x4000];
-                        memcpy(temp, m_pVdpVRAM, 0x4000);
-
-                        for (int i = 0; i < 0x4000; i += 2)
-                        {
-                            int new_addr;
-                            if (new_bit7)
-                            {
-                                // 4K -> 16K
-                                new_addr = (i & 0x3F) | ((i & 0x3F80) >> 1) | ((i & 0x40) << 7);
-                            }
-                            else
-                            {
-                                // 16K -> 4K
-                                new_addr = (i & 0x3F) | ((i & 0x1FC0) << 1) | ((i & 0x2000) >> 7);
-                            }
-                            *(u16 *)(m_pVdpVRAM + new_addr) = *(u16 *)(temp + i);
-                        }
+                        RemapSG1000VRAM(new_bit7 != 0);
+#if !defined(GS_DISABLE_RENDER_THREAD)
+                        if (IsValidPointer(m_pRenderThread))
+                            m_pRenderThread->LogWrite(new_bit7 ? VideoRenderThread::WriteRemapVRAM16K : VideoRenderThread::WriteRemapVRAM4K, 0, 0);
+#endif
                     }
                 }
 
@@ -731,11 +837,53 @@ void Video::WriteControl(u8 data)
     }
 }
 
+void Video::RemapSG1000VRAM(bool to16K)
+{
+    u8 temp[0x4000];
+    memcpy(temp, m_pVdpVRAM, 0x4000);
+
+    for (int i = 0; i < 0x4000; i += 2)
+    {
+        int new_addr;
+        if (to16K)
+        {
+            // 4K -> 16K
+            new_addr = (i & 0x3F) | ((i & 0x3F80) >> 1) | ((i & 0x40) << 7);
+        }
+        else
+        {
+            // 16K -> 4K
+            new_addr = (i & 0x3F) | ((i & 0x1FC0) << 1) | ((i & 0x2000) >> 7);
+        }
+        *(u16 *)(m_pVdpVRAM + new_addr) = *(u16 *)(temp + i);
+    }
+
+    ResetTMS9918Cache();
+}
+
 void Video::ScanLine(int line)
 {
     if (m_bGameGear && !m_bGameGearSMSMode && m_bGGPaletteExternalAccess)
         RebuildGGPalette();
 
+    EvaluateLine(line);
+
+#if !defined(GS_DISABLE_RENDER_THREAD)
+    if (IsValidPointer(m_pRenderThread))
+    {
+        m_pRenderThread->SubmitLine(line);
+        return;
+    }
+#endif
+
+    RenderLine(line);
+}
+
+// Sprite overflow and collision are only evaluated here, so the status flags
+// games poll mid-frame are the same whether the pixels are drawn on this
+// thread or on the render thread
+void Video::EvaluateLine(int line)
+{
     int max_height = m_bExtendedMode224 ? 224 : 192;
     int next_line = line + 1;
     next_line %= m_iLinesPerFrame;
@@ -743,7 +891,21 @@ void Video::ScanLine(int line)
     if (!m_bTMS9918)
     {
         ParseSpritesSMSGG(next_line);
+
+        if (m_bDisplayEnabled)
+            EvaluateSpriteCollisionSMSGG(next_line);
+    }
+    else if (m_bDisplayEnabled && (line < max_height))
+    {
+        EvaluateSpritesTMS9918(line);
     }
+}
+
+void Video::RenderLine(int line)
+{
+    int max_height = m_bExtendedMode224 ? 224 : 192;
+    int next_line = line + 1;
+    next_line %= m_iLinesPerFrame;
 
     if (m_bDisplayEnabled)
     {
@@ -785,6 +947,204 @@ void Video::ScanLine(int line)
     }
 }
 
+void Video::EvaluateSpriteCollisionSMSGG(int line)
+{
+    int max_height = m_bExtendedMode224 ? 224 : 192;
+
+    if ((line >= max_height) && (line < 240))
+        return;
+
+    int render_sprite_count = m_bNoSpriteLimit ? 64 : 8;
+    int line_sprites = 0;
+
+    for (int i = 0; i < render_sprite_count; i++)
+    {
+        if (m_NextLineSprites[i] >= 0)
+            line_sprites++;
+    }
+
+    if (line_sprites < 2)
+        return;
+
+    u16 sprite_table_address = (m_VdpRegister[5] << 7) & 0x3F00;
+    u16 sprite_table_address_2 = sprite_table_address + 0x80;
+    int sprite_width = 8;
+    bool sprite_height_16 = IsSetBit(m_VdpRegister[1], 1);
+    bool sprite_zoom = IsSetBit(m_VdpRegister[1], 0);
+    if (sprite_zoom)
+    {
+        sprite_width <<= 1;
+    }
+    int sprite_shift = IsSetBit(m_VdpRegister[0], 3) ? 8 : 0;
+    u16 sprite_tiles_address = (m_VdpRegister[6] << 11) & 0x2000;
+    bool mask_left = IsSetBit(m_VdpRegister[0], 5);
+
+    int scx_begin = (m_bGameGear && !m_bGameGearSMSMode) ? GS_RESOLUTION_GG_X_OFFSET : m_iHideLeftBarOffset;
+    int scx_end = scx_begin + (m_iScreenWidth - m_iHideLeftBarOffset);
+
+    u8 line_mask[GS_RESOLUTION_MAX_WIDTH];
+    memset(line_mask, 0, sizeof(line_mask));
+
+    for (int i = render_sprite_count - 1; i >= 0; i--)
+    {
+        int sprite = m_NextLineSprites[i];
+
+        if (sprite < 0)
+            continue;
+
+        u16 sprite_info_address = sprite_table_address_2 + (sprite << 1);
+        int sprite_index = sprite_table_address + sprite;
+
+        int sprite_y = m_pVdpVRAM[sprite_index] + 1;
+
+        if ((sprite_y > 240) && (sprite_y <= 256) && (line < max_height))
+        {
+            sprite_y -= 256;
+        }
+
+        int sprite_x = m_pVdpVRAM[sprite_info_address] - sprite_shift;
+        if (sprite_x >= GS_RESOLUTION_MAX_WIDTH)
+            continue;
+
+        int sprite_tile = m_pVdpVRAM[sprite_info_address + 1];
+        sprite_tile &= sprite_height_16 ? 0xFE : 0xFF;
+        int sprite_tile_addr = sprite_tiles_address + (sprite_tile << 5) +  (((line - sprite_y) >> (sprite_zoom ? 1 : 0)) << 2);
+        u8 opaque = m_pVdpVRAM[sprite_tile_addr] | m_pVdpVRAM[sprite_tile_addr + 1] |
+                m_pVdpVRAM[sprite_tile_addr + 2] | m_pVdpVRAM[sprite_tile_addr + 3];
+
+        for (int tile_x = 0; tile_x < sprite_width; tile_x++)
+        {
+            int sprite_pixel_x = sprite_x + tile_x;
+            if (sprite_pixel_x >= scx_end)
+                break;
+            if (sprite_pixel_x < scx_begin)
+                continue;
+            if (mask_left && (sprite_pixel_x < 8))
+                continue;
+
+            int tile_x_adjusted = tile_x >> (sprite_zoom ? 1 : 0);
+
+            if (!IsSetBit(opaque, 7 - (tile_x_adjusted & 7)))
+                continue;
+
+            if (line_mask[sprite_pixel_x] != 0)
+            {
+                m_bSpriteCollisionRequest = true;
+                m_iSpriteCollisionX = sprite_pixel_x;
+                return;
+            }
+
+            line_mask[sprite_pixel_x] = 1;
+        }
+    }
+}
+
+void Video::EvaluateSpritesTMS9918(int line)
+{
+    int sprite_count = 0;
+    int sprite_size = IsSetBit(m_VdpRegister[1], 1) ? 16 : 8;
+    bool sprite_zoom = IsSetBit(m_VdpRegister[1], 0);
+    if (sprite_zoom)
+        sprite_size *= 2;
+    u16 sprite_attribute_addr = (m_VdpRegister[5] & 0x7F) << 7;
+    u16 sprite_pattern_addr = (m_VdpRegister[6] & 0x07) << 11;
+    bool check_collision = !IsSetBit(m_VdpStatus, 5);
+
+    u8 line_mask[GS_RESOLUTION_MAX_WIDTH];
+    memset(line_mask, 0, sizeof(line_mask));
+
+    int max_sprite = 31;
+
+    for (int sprite = 0; sprite <= max_sprite; sprite++)
+    {
+        if (m_pVdpVRAM[sprite_attribute_addr + (sprite << 2)] == 0xD0)
+        {
+            max_sprite = sprite - 1;
+            break;
+        }
+    }
+
+    for (int sprite = 0; sprite <= max_sprite; sprite++)
+    {
+        int sprite_attribute_offset = sprite_attribute_addr + (sprite << 2);
+        int sprite_y = (m_pVdpVRAM[sprite_attribute_offset] + 1) & 0xFF;
+
+        if (sprite_y >= 0xE0)
+            sprite_y = -(0x100 - sprite_y);
+
+        if ((sprite_y > line) || ((sprite_y + sprite_size) <= line))
+            continue;
+
+        sprite_count++;
+        if (!IsSetBit(m_VdpStatus, 6) && (sprite_count > 4))
+        {
+#if !defined(GS_DISABLE_DISASSEMBLER)
+            u8 status_before = m_VdpStatus;
+#endif
+            m_VdpStatus = SetBit(m_VdpStatus, 6);
+            m_VdpStatus = (m_VdpStatus & 0xE0) | sprite;
+#if !defined(GS_DISABLE_DISASSEMBLER)
+            TraceVDPEvent(TRACE_VDP_SPRITE_OVERFLOW, (u8)sprite, 1, (u16)sprite, 0, status_before, m_VdpStatus);
+#endif
+        }
+
+        if (!check_collision || ((sprite_count >= 5) && !m_bNoSpriteLimit))
+            continue;
+
+        int sprite_color = m_pVdpVRAM[sprite_attribute_offset + 3] & 0x0F;
+
+        if (sprite_color == 0)
+            continue;
+
+        int sprite_shift = (m_pVdpVRAM[sprite_attribute_offset + 3] & 0x80) ? 32 : 0;
+        int sprite_x = m_pVdpVRAM[sprite_attribute_offset + 1] - sprite_shift;
+
+        if (sprite_x >= GS_RESOLUTION_MAX_WIDTH)
+            continue;
+
+        int sprite_tile = m_pVdpVRAM[sprite_attribute_offset + 2];
+        sprite_tile &= IsSetBit(m_VdpRegister[1], 1) ? 0xFC : 0xFF;
+
+        int sprite_line_addr = sprite_pattern_addr + (sprite_tile << 3) + ((line - sprite_y ) >> (sprite_zoom ? 1 : 0));
+
+        for (int tile_x = 0; tile_x < sprite_size; tile_x++)
+        {
+            int sprite_pixel_x = sprite_x + tile_x;
+            if (sprite_pixel_x >= m_iScreenWidth)
+                break;
+            if (sprite_pixel_x < 0)
+                continue;
+
+            bool sprite_pixel = false;
+
+            int tile_x_adjusted = tile_x >> (sprite_zoom ? 1 : 0);
+
+            if (tile_x_adjusted < 8)
+                sprite_pixel = IsSetBit(m_pVdpVRAM[sprite_line_addr & 0x3FFF], 7 - tile_x_adjusted);
+            else
+                sprite_pixel = IsSetBit(m_pVdpVRAM[(sprite_line_addr + 16) & 0x3FFF], 15 - tile_x_adjusted);
+
+            if (!sprite_pixel)
+                continue;
+
+            if (line_mask[sprite_pixel_x] != 0)
+            {
+#if !defined(GS_DISABLE_DISASSEMBLER)
+                u8 status_before = m_VdpStatus;
+#endif
+                m_VdpStatus = SetBit(m_VdpStatus, 5);
+#if !defined(GS_DISABLE_DISASSEMBLER)
+                TraceVDPEvent(TRACE_VDP_SPRITE_COLLISION, (u8)sprite_pixel_x, 1, (u16)sprite_pixel_x, 0, status_before, m_VdpStatus);
+#endif
+                check_collision = false;
+                break;
+            }
+
+            line_mask[sprite_pixel_x] = 1;
+        }
+    }
+}
+
 void Video::RenderBackgroundSMSGG(int line)
 {
     int y_offset = m_bExtendedMode224 ? GS_RESOLUTION_GG_Y_OFFSET_EXTENDED : GS_RESOLUTION_GG_Y_OFFSET;
@@ -974,8 +1334,6 @@ void Video::RenderSpritesSMSGG(int line)
     int y_offset = m_bExtendedMode224 ? GS_RESOLUTION_GG_Y_OFFSET_EXTENDED : GS_RESOLUTION_GG_Y_OFFSET;
     u16 sprite_table_address = (m_VdpRegister[5] << 7) & 0x3F00;
     u16 sprite_table_address_2 = sprite_table_address + 0x80;
-    int sprite_collision = false;
-    int sprite_collision_x = 0;
     int scy_adjust = (m_bGameGear && !m_bGameGearSMSMode) ? y_offset : 0;
     int line_width_info = line * (m_iScreenWidth - m_iHideLeftBarOffset);
     int line_width_screen = (line - scy_adjust) * (m_iScreenWidth - m_iHideLeftBarOffset);
@@ -1061,24 +1419,9 @@ void Video::RenderSpritesSMSGG(int line)
                     m_pFrameBuffer[pixel_screen] = CachedColorFromPalette(palette_color);
             }
 
-            if ((m_pInfoBuffer[pixel_info] & 0x01) != 0)
-            {
-                if (!sprite_collision)
-                {
-                    sprite_collision = true;
-                    sprite_collision_x = sprite_pixel_x;
-                }
-            }
-
             m_pInfoBuffer[pixel_info] |= 0x01;
         }
     }
-
-    if (sprite_collision)
-    {
-        m_bSpriteCollisionRequest = true;
-        m_iSpriteCollisionX = sprite_collision_x;
-    }
 }
 
 void Video::RenderBackgroundTMS9918(int line)
@@ -1146,18 +1489,16 @@ void Video::RenderBackgroundTMS9918(int line)
         }
     }
 
-    for (int tile_x = 0; tile_x < 32; tile_x++)
+    if (m_iTMS9918Mode == 3)
     {
-        int tile_number = (tile_y << 5) + tile_x;
-        int name_tile_addr = name_table_addr + tile_number;
-        int name_tile = m_pVdpVRAM[name_tile_addr];
-        u8 pattern_line = 0;
-        u8 color_line = 0;
-
-        if (m_iTMS9918Mode == 3)
+        for (int tile_x = 0; tile_x < 32; tile_x++)
         {
+            int tile_number = (tile_y << 5) + tile_x;
+            int name_tile_addr = name_table_addr + tile_number;
+            int name_tile = m_pVdpVRAM[name_tile_addr];
+
             int offset_color = pattern_table_addr + (name_tile << 3) + ((tile_y & 0x03) << 1) + (line & 0x04 ? 1 : 0);
-            color_line = m_pVdpVRAM[offset_color];
+            u8 color_line = m_pVdpVRAM[offset_color];
 
             int left_color = color_line >> 4;
             int right_color = color_line & 0x0F;
@@ -1179,37 +1520,95 @@ void Video::RenderBackgroundTMS9918(int line)
                 m_pFrameBuffer[pixel] = right_color;
                 m_pInfoBuffer[pixel] = 0x00;
             }
-
-            continue;
-        }
-        else if (m_iTMS9918Mode == 0)
-        {
-            pattern_line = m_pVdpVRAM[pattern_table_addr + (name_tile << 3) + tile_y_offset];
-            color_line = m_pVdpVRAM[color_table_addr + (name_tile >> 3)];
-        }
-        else if (m_iTMS9918Mode == 2)
-        {
-            name_tile += region;
-            pattern_line = m_pVdpVRAM[pattern_table_addr + ((name_tile & region_mask) << 3) + tile_y_offset];
-            color_line = m_pVdpVRAM[color_table_addr + ((name_tile & color_mask) << 3) + tile_y_offset];
         }
+        return;
+    }
+
+    // Graphics I and II: copy rows from the decode cache, which only
+    // changes when the pattern or color tables are written
+    PrepareTMS9918Cache(pattern_table_addr, color_table_addr, region_mask, color_mask, backdrop_color);
 
-        int fg_color = color_line >> 4;
-        int bg_color = color_line & 0x0F;
-        fg_color = (fg_color > 0) ? fg_color : backdrop_color;
-        bg_color = (bg_color > 0) ? bg_color : backdrop_color;
+    memset(&m_pInfoBuffer[line_offset], 0, 256);
 
-        int screen_offset = line_offset + (tile_x << 3);
+    const u8* name_row = &m_pVdpVRAM[name_table_addr + (tile_y << 5)];
+    u16* frame_row = &m_pFrameBuffer[line_offset];
 
-        for (int tile_pixel = 0; tile_pixel < 8; tile_pixel++)
+    for (int tile_x = 0; tile_x < 32; tile_x++)
+    {
+        int name_tile = name_row[tile_x] + region;
+        int key = (name_tile << 3) + tile_y_offset;
+
+        if (!m_TMS9918RowValid[key])
         {
-            int pixel = screen_offset + tile_pixel;
-            m_pFrameBuffer[pixel] = IsSetBit(pattern_line, 7 - tile_pixel) ? fg_color : bg_color;
-            m_pInfoBuffer[pixel] = 0x00;
+            if (m_iTMS9918Mode == 2)
+                DecodeTMS9918Row(key, ((name_tile & region_mask) << 3) + tile_y_offset, ((name_tile & color_mask) << 3) + tile_y_offset);
+            else
+                DecodeTMS9918Row(key, key, name_tile >> 3);
         }
+
+        memcpy(&frame_row[tile_x << 3], m_TMS9918RowCache[key], sizeof(m_TMS9918RowCache[key]));
     }
 }
 
+void Video::ResetTMS9918Cache()
+{
+    m_TMS9918Cache.mode = -1;
+}
+
+// Must be called after writing VRAM or CRAM through the pointers returned by
+// GetVRAM() and GetCRAM(), which bypass the VDP ports
+void Video::InvalidateVRAMCaches()
+{
+    ResetTMS9918Cache();
+
+#if !defined(GS_DISABLE_RENDER_THREAD)
+    if (IsValidPointer(m_pRenderThread))
+        m_pRenderThread->Invalidate();
+#endif
+}
+
+void Video::PrepareTMS9918Cache(int pattern_addr, int color_addr, int region_mask, int color_mask, int backdrop_color)
+{
+    TMS9918Cache& cache = m_TMS9918Cache;
+
+    if ((cache.mode == m_iTMS9918Mode) && (cache.pattern_addr == pattern_addr) &&
+        (cache.color_addr == color_addr) && (cache.region_mask == region_mask) &&
+        (cache.color_mask == color_mask) && (cache.backdrop == backdrop_color))
+        return;
+
+    bool graphics_2 = (m_iTMS9918Mode == 2);
+
+    cache.mode = m_iTMS9918Mode;
+    cache.pattern_addr = pattern_addr;
+    cache.pattern_size = graphics_2 ? 0x1800 : 0x800;
+    cache.color_addr = color_addr;
+    cache.color_size = graphics_2 ? 0x1800 : 0x20;
+    cache.region_mask = region_mask;
+    cache.color_mask = color_mask;
+    cache.backdrop = backdrop_color;
+    cache.exact = !graphics_2 || ((region_mask == 0x3FF) && (color_mask == 0x3FF));
+
+    memset(m_TMS9918RowValid, 0, sizeof(m_TMS9918RowValid));
+}
+
+void Video::DecodeTMS9918Row(int key, int pattern_offset, int color_offset)
+{
+    u8 pattern_line = m_pVdpVRAM[m_TMS9918Cache.pattern_addr + pattern_offset];
+    u8 color_line = m_pVdpVRAM[m_TMS9918Cache.color_addr + color_offset];
+
+    int fg_color = color_line >> 4;
+    int bg_color = color_line & 0x0F;
+    fg_color = (fg_color > 0) ? fg_color : m_TMS9918Cache.backdrop;
+    bg_color = (bg_color > 0) ? bg_color : m_TMS9918Cache.backdrop;
+
+    u16* row = m_TMS9918RowCache[key];
+
+    for (int tile_pixel = 0; tile_pixel < 8; tile_pixel++)
+        row[tile_pixel] = IsSetBit(pattern_line, 7 - tile_pixel) ? fg_color : bg_color;
+
+    m_TMS9918RowValid[key] = 1;
+}
+
 void Video::RenderSpritesTMS9918(int line)
 {
     int sprite_count = 0;
@@ -1244,17 +1643,8 @@ void Video::RenderSpritesTMS9918(int line)
             continue;
 
         sprite_count++;
-        if (!IsSetBit(m_VdpStatus, 6) && (sprite_count > 4))
-        {
-#if !defined(GS_DISABLE_DISASSEMBLER)
-            u8 status_before = m_VdpStatus;
-#endif
-            m_VdpStatus = SetBit(m_VdpStatus, 6);
-            m_VdpStatus = (m_VdpStatus & 0xE0) | sprite;
-#if !defined(GS_DISABLE_DISASSEMBLER)
-            TraceVDPEvent(TRACE_VDP_SPRITE_OVERFLOW, (u8)sprite, 1, (u16)sprite, 0, status_before, m_VdpStatus);
-#endif
-        }
+        if ((sprite_count > 4) && !m_bNoSpriteLimit)
+            break;
 
         int sprite_color = m_pVdpVRAM[sprite_attribute_offset + 3] & 0x0F;
 
@@ -1291,30 +1681,10 @@ void Video::RenderSpritesTMS9918(int line)
             else
                 sprite_pixel = IsSetBit(m_pVdpVRAM[(sprite_line_addr + 16) & 0x3FFF], 15 - tile_x_adjusted);
 
-            if (sprite_pixel && ((sprite_count < 5) || m_bNoSpriteLimit))
+            if (sprite_pixel && !IsSetBit(m_pInfoBuffer[pixel], 0))
             {
-                if (!IsSetBit(m_pInfoBuffer[pixel], 0) && (sprite_color > 0))
-                {
-                    m_pFrameBuffer[pixel] = sprite_color;
-                    m_pInfoBuffer[pixel] = SetBit(m_pInfoBuffer[pixel], 0);
-                }
-
-                if (IsSetBit(m_pInfoBuffer[pixel], 1))
-                {
-#if !defined(GS_DISABLE_DISASSEMBLER)
-                    bool collision_set = IsSetBit(m_VdpStatus, 5);
-                    u8 status_before = m_VdpStatus;
-#endif
-                    m_VdpStatus = SetBit(m_VdpStatus, 5);
-#if !defined(GS_DISABLE_DISASSEMBLER)
-                    if (!collision_set)
-                        TraceVDPEvent(TRACE_VDP_SPRITE_COLLISION, (u8)sprite_pixel_x, 1, (u16)sprite_pixel_x, 0, status_before, m_VdpStatus);
-#endif
-                }
-                else
-                {
-                    m_pInfoBuffer[pixel] = SetBit(m_pInfoBuffer[pixel], 1);
-                }
+                m_pFrameBuffer[pixel] = sprite_color;
+                m_pInfoBuffer[pixel] = SetBit(m_pInfoBuffer[pixel], 0);
             }
         }
     }
@@ -1656,6 +2026,21 @@ void Video::SetLightPhaserCrosshair(bool enable, LightPhaserCrosshairShape shape
     m_LightPhaserCrosshairColor = color;
 }
 
+bool Video::IsLightPhaserCrosshair()
+{
+    return m_bLightPhaserCrosshair;
+}
+
+Video::LightPhaserCrosshairShape Video::GetLightPhaserCrosshairShape()
+{
+    return m_LightPhaserCrosshairShape;
+}
+
+Video::LightPhaserCrosshairColor Video::GetLightPhaserCrosshairColor()
+{
+    return m_LightPhaserCrosshairColor;
+}
+
 void Video::InitPalettes(const u8* src, u16* dest_565_rgb, u16* dest_555_rgb, u16* dest_565_bgr, u16* dest_555_bgr)
 {
     for (int i=0,j=0; i<16; i++,j+=3)
@@ -1762,15 +2147,25 @@ void Video::CheckPhaser()
     }
 }
 
-void Video::SaveState(std::ostream& stream)
+void Video::SaveState(state_writer& stream)
 {
     using namespace std;
 
-    stream.write(reinterpret_cast<const char*> (m_pInfoBuffer), GS_RESOLUTION_MAX_WIDTH * GS_LINES_PER_FRAME_PAL);
+    WaitForRender();
+
+    // The info buffer is scratch space rebuilt for every rendered line
+    stream.section(GS_State_Section_VDP);
+    if (!stream.compact())
+        stream.write(reinterpret_cast<const char*> (m_pInfoBuffer), GS_RESOLUTION_MAX_WIDTH * GS_LINES_PER_FRAME_PAL);
+    stream.section(GS_State_Section_VRAM);
     stream.write(reinterpret_cast<const char*> (m_pVdpVRAM), 0x4000);
+    stream.section(GS_State_Section_CRAM);
     stream.write(reinterpret_cast<const char*> (m_pVdpCRAM), 0x40);
+    stream.section(GS_State_Section_VDP);
     stream.write(reinterpret_cast<const char*> (&m_bFirstByteInSequence), sizeof(m_bFirstByteInSequence));
+    stream.section(GS_State_Section_VDP_Registers);
     stream.write(reinterpret_cast<const char*> (m_VdpRegister), sizeof(m_VdpRegister));
+    stream.section(GS_State_Section_VDP);
     stream.write(reinterpret_cast<const char*> (&m_VdpCode), sizeof(m_VdpCode));
     stream.write(reinterpret_cast<const char*> (&m_VdpBuffer), sizeof(m_VdpBuffer));
     stream.write(reinterpret_cast<const char*> (&m_VdpAddress), sizeof(m_VdpAddress));
@@ -1803,12 +2198,18 @@ void Video::SaveState(std::ostream& stream)
     stream.write(reinterpret_cast<const char*> (&m_iSpriteCollisionX), sizeof(m_iSpriteCollisionX));
 }
 
-void Video::LoadState(std::istream& stream, int version)
+void Video::LoadState(state_reader& stream, int version)
 {
     using namespace std;
 
-    stream.read(reinterpret_cast<char*> (m_pInfoBuffer), GS_RESOLUTION_MAX_WIDTH * GS_LINES_PER_FRAME_PAL);
+    WaitForRender();
+
+    if (stream.compact())
+        memset(m_pInfoBuffer, 0, GS_RESOLUTION_MAX_WIDTH * GS_LINES_PER_FRAME_PAL);
+    else
+        stream.read(reinterpret_cast<char*> (m_pInfoBuffer), GS_RESOLUTION_MAX_WIDTH * GS_LINES_PER_FRAME_PAL);
     stream.read(reinterpret_cast<char*> (m_pVdpVRAM), 0x4000);
+    InvalidateVRAMCaches();
     stream.read(reinterpret_cast<char*> (m_pVdpCRAM), 0x40);
     stream.read(reinterpret_cast<char*> (&m_bFirstByteInSequence), sizeof(m_bFirstByteInSequence));
     stream.read(reinterpret_cast<char*> (m_VdpRegister), sizeof(m_VdpRegister));
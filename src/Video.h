@@ -21,12 +21,14 @@
 #define	VIDEO_H
 
 #include "definitions.h"
+#include "state_serializer.h"
 #include "TraceLogger.h"
 
 class Memory;
 class Processor;
 class Cartridge;
 class TraceLogger;
+class VideoRenderThread;
 
 class Video
 {
@@ -80,10 +82,11 @@ public:
     void WriteData(u8 data);
     void WriteControl(u8 data);
     void LatchHCounter();
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream, int version = GS_SAVESTATE_VERSION);
+    void SaveState(state_writer& stream);
+    void LoadState(state_reader& stream, int version = GS_SAVESTATE_VERSION);
     u8* GetVRAM();
     u8* GetCRAM();
+    void InvalidateVRAMCaches();
     u8* GetRegisters();
     int GetTMS9918Mode();
     u16 ColorFromPalette(int palette_color);
@@ -95,15 +98,30 @@ public:
     void SetHideLeftBar(HideLeftBar hideLeftBar);
     HideLeftBar GetHideLeftBar();
     void SetNoSpriteLimit(bool noSpriteLimit);
+    bool IsNoSpriteLimit();
     int GetHideLeftBarOffset();
     void SetPhaserCoordinates(int x, int y);
     bool IsPhaserDetected();
     void DrawPhaserCrosshair(int x, int y);
     void SetLightPhaserCrosshair(bool enable, LightPhaserCrosshairShape shape, LightPhaserCrosshairColor color);
+    bool IsLightPhaserCrosshair();
+    LightPhaserCrosshairShape GetLightPhaserCrosshairShape();
+    LightPhaserCrosshairColor GetLightPhaserCrosshairColor();
     void SetTraceLogger(TraceLogger* pTraceLogger);
+    void SetThreadedRendering(bool enable);
+    bool IsThreadedRendering();
+    void WaitForRender();
+    bool CheckFrameChanged(const u8* dstFrameBuffer, GS_Color_Format pixelFormat);
+    void InvalidateFrameCache();
 
 private:
+    friend class VideoRenderThread;
     void ScanLine(int line);
+    void EvaluateLine(int line);
+    void RenderLine(int line);
+    void EvaluateSpriteCollisionSMSGG(int line);
+    void EvaluateSpritesTMS9918(int line);
+    void RemapSG1000VRAM(bool to16K);
     void RenderBackgroundSMSGG(int line);
     void RenderBackgroundTMS9918(int line);
     void ParseSpritesSMSGG(int line);
@@ -115,6 +133,10 @@ private:
     int CalculateVideoMode();
     void CheckPhaser();
     INLINE void UpdateGGPalette(int palette_color);
+    INLINE void InvalidateTMS9918Cache(u16 address);
+    void ResetTMS9918Cache();
+    void PrepareTMS9918Cache(int pattern_addr, int color_addr, int region_mask, int color_mask, int backdrop_color);
+    void DecodeTMS9918Row(int key, int pattern_offset, int color_offset);
     INLINE u16 CachedColorFromPalette(int palette_color);
     INLINE void TraceVDPEvent(u8 event, u8 raw = 0, u8 effective = 0, u16 auxiliary = 0, u8 reg = 0, u8 status_before = 0, u8 status_after = 0, u16 address = 0xFFFF);
     void LogVDPEvent(u8 event, u8 raw, u8 effective, u16 auxiliary, u8 reg, u8 status_before, u8 status_after, u16 address);
@@ -217,11 +239,49 @@ private:
     u16 m_SG1000_palette_555_bgr_sg1000ii[16];
     u16 m_GGPalette[32];
     bool m_bGGPaletteExternalAccess;
+
+    // Decoded Graphics I/II pattern rows, indexed by tile (including the
+    // Graphics II bank offset) and row, with the color table and backdrop
+    // already applied
+    struct TMS9918Cache
+    {
+        int mode;
+        int pattern_addr;
+        int pattern_size;
+        int color_addr;
+        int color_size;
+        int region_mask;
+        int color_mask;
+        int backdrop;
+        bool exact;
+    };
+    TMS9918Cache m_TMS9918Cache;
+    u16 m_TMS9918RowCache[0x1800][8];
+    u8 m_TMS9918RowValid[0x1800];
     TraceLogger* m_pTraceLogger;
     u32 m_SMSOutputPalette32[2][64];
     u32 m_GGOutputPalette32[2][4096];
     u16 m_SMSOutputPalette16[4][64];
     u16 m_GGOutputPalette16[4][4096];
+
+    struct FrameSignature
+    {
+        const u8* dst;
+        GS_Color_Format pixel_format;
+        Overscan overscan;
+        u16 overscan_color;
+        int hide_left_bar_offset;
+        bool extended_mode_224;
+        bool tms9918;
+        bool pal;
+        bool gg_palette;
+    };
+    u16* m_pLastFrameBuffer;
+    FrameSignature m_LastFrameSignature;
+    bool m_bLastFrameValid;
+#if !defined(GS_DISABLE_RENDER_THREAD)
+    VideoRenderThread* m_pRenderThread;
+#endif
 };
 
 INLINE void Video::TraceVDPEvent(u8 event, u8 raw, u8 effective, u16 auxiliary, u8 reg, u8 status_before, u8 status_after, u16 address)
@@ -264,6 +324,38 @@ inline u16 Video::ColorFromPalette(int palette_color)
     }
 }
 
+INLINE void Video::InvalidateTMS9918Cache(u16 address)
+{
+    if (m_TMS9918Cache.mode < 0)
+        return;
+
+    int pattern_offset = address - m_TMS9918Cache.pattern_addr;
+    int color_offset = address - m_TMS9918Cache.color_addr;
+    bool pattern_hit = (pattern_offset >= 0) && (pattern_offset < m_TMS9918Cache.pattern_size);
+    bool color_hit = (color_offset >= 0) && (color_offset < m_TMS9918Cache.color_size);
+
+    if (likely(!pattern_hit && !color_hit))
+        return;
+
+    if (!m_TMS9918Cache.exact)
+    {
+        // Mirrored tables map one address to several rows
+        m_TMS9918Cache.mode = -1;
+        return;
+    }
+
+    if (pattern_hit)
+        m_TMS9918RowValid[pattern_offset] = 0;
+
+    if (color_hit)
+    {
+        if (m_TMS9918Cache.mode == 2)
+            m_TMS9918RowValid[color_offset] = 0;
+        else
+            memset(&m_TMS9918RowValid[color_offset << 6], 0, 64);
+    }
+}
+
 INLINE void Video::UpdateGGPalette(int palette_color)
 {
     int address = palette_color << 1;
@@ -0,0 +1,231 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include "VideoRenderThread.h"
+
+#if !defined(GS_DISABLE_RENDER_THREAD)
+
+#include "log.h"
+#include "Video.h"
+#include "TraceLogger.h"
+
+VideoRenderThread::VideoRenderThread(Video* pVideo)
+{
+    m_pVideo = pVideo;
+
+    // The renderer draws straight into the frame and info buffers owned by
+    // pVideo but keeps its own copy of VRAM and CRAM
+    m_pRenderer = new Video(pVideo->m_pMemory, pVideo->m_pProcessor, pVideo->m_pCartridge);
+    m_pRenderer->m_pFrameBuffer = pVideo->m_pFrameBuffer;
+    m_pRenderer->m_pInfoBuffer = pVideo->m_pInfoBuffer;
+    m_pRenderer->m_pVdpVRAM = new u8[0x4000];
+    m_pRenderer->m_pVdpCRAM = new u8[0x40];
+
+    // Events traced from the worker would race with the emulation thread
+    m_pTraceLogger = new TraceLogger(NULL);
+    m_pTraceLogger->SetCapacity(1);
+    m_pRenderer->SetTraceLogger(m_pTraceLogger);
+
+    m_iLineHead = 0;
+    m_iLineTail = 0;
+    m_iWriteHead = 0;
+    m_iWriteTail = 0;
+    m_iWriteLimit = GS_RENDER_THREAD_MAX_WRITES;
+    m_iWriteSubmitted = 0;
+    m_bResync = true;
+    m_bQuit = false;
+
+    m_Thread = std::thread(&VideoRenderThread::Run, this);
+}
+
+VideoRenderThread::~VideoRenderThread()
+{
+    Wait();
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bQuit = true;
+    }
+
+    m_WorkCondition.notify_one();
+    m_Thread.join();
+
+    InitPointer(m_pRenderer->m_pFrameBuffer);
+    InitPointer(m_pRenderer->m_pInfoBuffer);
+    SafeDelete(m_pRenderer);
+    SafeDelete(m_pTraceLogger);
+}
+
+void VideoRenderThread::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    while (m_iLineTail != m_iLineHead)
+        m_DoneCondition.wait(lock);
+}
+
+// VRAM may be modified from outside the VDP ports (debugger, savestates,
+// reset), so take a fresh copy before the next line. Writes through the
+// ports are already in the log and need no resync.
+void VideoRenderThread::Invalidate()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    while (m_iLineTail != m_iLineHead)
+        m_DoneCondition.wait(lock);
+
+    m_bResync = true;
+}
+
+void VideoRenderThread::SubmitLine(int line)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    while ((m_iLineHead - m_iLineTail) >= GS_RENDER_THREAD_MAX_LINES)
+        m_DoneCondition.wait(lock);
+
+    if (m_bResync)
+        Resync();
+
+    Line& entry = m_Lines[m_iLineHead & (GS_RENDER_THREAD_MAX_LINES - 1)];
+    entry.line = line;
+    entry.write_begin = m_iWriteSubmitted;
+    entry.write_end = m_iWriteHead;
+    memcpy(entry.registers, m_pVideo->m_VdpRegister, sizeof(entry.registers));
+    entry.scroll_x = m_pVideo->m_ScrollX;
+    entry.scroll_y = m_pVideo->m_ScrollY;
+    entry.display_enabled = m_pVideo->m_bDisplayEnabled;
+    entry.extended_mode_224 = m_pVideo->m_bExtendedMode224;
+    entry.tms9918 = m_pVideo->m_bTMS9918;
+    entry.no_sprite_limit = m_pVideo->m_bNoSpriteLimit;
+    entry.tms9918_mode = m_pVideo->m_iTMS9918Mode;
+    entry.hide_left_bar_offset = m_pVideo->m_iHideLeftBarOffset;
+
+    m_iWriteSubmitted = m_iWriteHead;
+    m_iLineHead++;
+
+    lock.unlock();
+    m_WorkCondition.notify_one();
+}
+
+void VideoRenderThread::Run()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    while (true)
+    {
+        while (!m_bQuit && (m_iLineTail == m_iLineHead))
+            m_WorkCondition.wait(lock);
+
+        if (m_bQuit)
+            break;
+
+        Line line = m_Lines[m_iLineTail & (GS_RENDER_THREAD_MAX_LINES - 1)];
+
+        lock.unlock();
+        ApplyWrites(line.write_begin, line.write_end);
+        RenderLine(line);
+        lock.lock();
+
+        m_iLineTail++;
+        m_iWriteTail = line.write_end;
+        m_DoneCondition.notify_all();
+    }
+}
+
+void VideoRenderThread::Resync()
+{
+    // Only called with the worker idle
+    memcpy(m_pRenderer->m_pVdpVRAM, m_pVideo->m_pVdpVRAM, 0x4000);
+    memcpy(m_pRenderer->m_pVdpCRAM, m_pVideo->m_pVdpCRAM, 0x40);
+    m_pRenderer->m_bGameGear = m_pVideo->m_bGameGear;
+    m_pRenderer->m_bGameGearSMSMode = m_pVideo->m_bGameGearSMSMode;
+    m_pRenderer->m_iLinesPerFrame = m_pVideo->m_iLinesPerFrame;
+    m_pRenderer->m_iScreenWidth = m_pVideo->m_iScreenWidth;
+    m_pRenderer->RebuildGGPalette();
+    m_pRenderer->ResetTMS9918Cache();
+
+    m_iWriteTail = m_iWriteHead;
+    m_iWriteSubmitted = m_iWriteHead;
+    m_iWriteLimit = m_iWriteHead + GS_RENDER_THREAD_MAX_WRITES;
+    m_bResync = false;
+}
+
+void VideoRenderThread::ReserveWrites()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    while (((m_iWriteHead - m_iWriteTail) >= GS_RENDER_THREAD_MAX_WRITES) && (m_iLineTail != m_iLineHead))
+        m_DoneCondition.wait(lock);
+
+    if ((m_iWriteHead - m_iWriteTail) >= GS_RENDER_THREAD_MAX_WRITES)
+    {
+        // The log is full of writes that belong to lines not submitted yet.
+        // The worker is idle, so drop them and resync on the next line.
+        Debug("Video render thread: write log full, resyncing");
+        m_bResync = true;
+    }
+
+    m_iWriteLimit = m_iWriteTail + GS_RENDER_THREAD_MAX_WRITES;
+}
+
+void VideoRenderThread::ApplyWrites(u32 begin, u32 end)
+{
+    bool gg_palette = m_pRenderer->m_bGameGear && !m_pRenderer->m_bGameGearSMSMode;
+
+    for (u32 i = begin; i != end; i++)
+    {
+        const Write& write = m_Writes[i & (GS_RENDER_THREAD_MAX_WRITES - 1)];
+
+        switch (write.type)
+        {
+            case WriteVRAM:
+                m_pRenderer->m_pVdpVRAM[write.address] = write.value;
+                m_pRenderer->InvalidateTMS9918Cache(write.address);
+                break;
+            case WriteCRAM:
+                m_pRenderer->m_pVdpCRAM[write.address] = write.value;
+                if (gg_palette)
+                    m_pRenderer->UpdateGGPalette(write.address >> 1);
+                break;
+            case WriteRemapVRAM4K:
+                m_pRenderer->RemapSG1000VRAM(false);
+                break;
+            case WriteRemapVRAM16K:
+                m_pRenderer->RemapSG1000VRAM(true);
+                break;
+        }
+    }
+}
+
+void VideoRenderThread::RenderLine(const Line& line)
+{
+    memcpy(m_pRenderer->m_VdpRegister, line.registers, sizeof(line.registers));
+    m_pRenderer->m_ScrollX = line.scroll_x;
+    m_pRenderer->m_ScrollY = line.scroll_y;
+    m_pRenderer->m_bDisplayEnabled = line.display_enabled;
+    m_pRenderer->m_bExtendedMode224 = line.extended_mode_224;
+    m_pRenderer->m_bTMS9918 = line.tms9918;
+    m_pRenderer->m_bNoSpriteLimit = line.no_sprite_limit;
+    m_pRenderer->m_iTMS9918Mode = line.tms9918_mode;
+    m_pRenderer->m_iHideLeftBarOffset = line.hide_left_bar_offset;
+    m_pRenderer->ScanLine(line.line);
+}
+
+#endif /* !defined(GS_DISABLE_RENDER_THREAD) */
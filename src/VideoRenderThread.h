@@ -0,0 +1,133 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef VIDEO_RENDER_THREAD_H
+#define VIDEO_RENDER_THREAD_H
+
+#include "definitions.h"
+
+#if !defined(GS_DISABLE_RENDER_THREAD)
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class Video;
+class TraceLogger;
+
+#define GS_RENDER_THREAD_MAX_LINES 512
+#define GS_RENDER_THREAD_MAX_WRITES 0x8000
+
+// Renders scanlines on a worker thread. The emulation thread logs every
+// VRAM/CRAM write and submits one entry per line with the registers and
+// scroll values latched at render time. The worker replays the writes into
+// its own copy of the VDP memory and draws the line into the shared frame
+// buffer, so pixels come out exactly as the synchronous path.
+class VideoRenderThread
+{
+public:
+    enum WriteType
+    {
+        WriteVRAM,
+        WriteCRAM,
+        WriteRemapVRAM4K,
+        WriteRemapVRAM16K
+    };
+
+public:
+    VideoRenderThread(Video* pVideo);
+    ~VideoRenderThread();
+    void Wait();
+    void Invalidate();
+    void SubmitLine(int line);
+    INLINE void LogWrite(WriteType type, u16 address, u8 value);
+
+private:
+    struct Write
+    {
+        u16 address;
+        u8 value;
+        u8 type;
+    };
+
+    struct Line
+    {
+        int line;
+        u32 write_begin;
+        u32 write_end;
+        u8 registers[16];
+        u8 scroll_x;
+        u8 scroll_y;
+        bool display_enabled;
+        bool extended_mode_224;
+        bool tms9918;
+        bool no_sprite_limit;
+        int tms9918_mode;
+        int hide_left_bar_offset;
+    };
+
+    void Run();
+    void Resync();
+    void ReserveWrites();
+    void ApplyWrites(u32 begin, u32 end);
+    void RenderLine(const Line& line);
+
+private:
+    Video* m_pVideo;
+    Video* m_pRenderer;
+    TraceLogger* m_pTraceLogger;
+    std::thread m_Thread;
+    std::mutex m_Mutex;
+    std::condition_variable m_WorkCondition;
+    std::condition_variable m_DoneCondition;
+    Line m_Lines[GS_RENDER_THREAD_MAX_LINES];
+    Write m_Writes[GS_RENDER_THREAD_MAX_WRITES];
+    u32 m_iLineHead;
+    u32 m_iLineTail;
+    u32 m_iWriteHead;
+    u32 m_iWriteTail;
+    u32 m_iWriteLimit;
+    u32 m_iWriteSubmitted;
+    bool m_bResync;
+    bool m_bQuit;
+};
+
+INLINE void VideoRenderThread::LogWrite(WriteType type, u16 address, u8 value)
+{
+    // Pending writes are already part of the snapshot taken on resync
+    if (m_bResync)
+        return;
+
+    if (unlikely(m_iWriteHead == m_iWriteLimit))
+    {
+        ReserveWrites();
+        if (m_bResync)
+            return;
+    }
+
+    Write& write = m_Writes[m_iWriteHead & (GS_RENDER_THREAD_MAX_WRITES - 1)];
+    write.address = address;
+    write.value = value;
+    write.type = (u8)type;
+    m_iWriteHead++;
+}
+
+#endif /* !defined(GS_DISABLE_RENDER_THREAD) */
+
+#endif /* VIDEO_RENDER_THREAD_H */
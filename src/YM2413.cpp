@@ -19,18 +19,28 @@
 
 #include "YM2413.h"
 
+static void InitTables()
+{
+    // The sine and attenuation tables are shared by every chip. Function
+    // statics are initialized exactly once, even with several cores being
+    // created from different threads.
+    static const bool initialized = (YM2413InitTables(), true);
+    UNUSED(initialized);
+}
+
 YM2413::YM2413()
 {
     InitPointer(m_pBuffer);
     m_iCycleCounter = 0;
-    m_iSampleCounter = 0;
-    m_iBufferIndex = 0;
+    m_iFrameCycles = 0;
     m_ElapsedCycles = 0;
     m_iClockRate = 0;
     m_RegisterF2 = 0;
     m_CurrentSample = 0;
     m_bEnabled = false;
-    m_iSampleRateFactor = 0;
+    m_bOutputEnabled = true;
+    m_bOutputStale = false;
+    memset(&m_Chip, 0, sizeof(m_Chip));
 }
 
 YM2413::~YM2413()
@@ -38,27 +48,33 @@ YM2413::~YM2413()
     SafeDeleteArray(m_pBuffer);
 }
 
-void YM2413::Init(int clockRate)
+void YM2413::Init(int clockRate, int sampleRate)
 {
     m_pBuffer = new s16[GS_AUDIO_BUFFER_SIZE];
-    YM2413Init();
+    InitTables();
+    YM2413Init(&m_Chip);
+    m_Blip.set_sample_rate(sampleRate);
+    m_Synth.output(&m_Blip);
+    m_Synth.volume(1.0);
     Reset(clockRate);
 }
 
 void YM2413::Reset(int clockRate)
 {
     m_iClockRate = clockRate;
-    m_iSampleRateFactor = (int)(((s64)GS_AUDIO_SAMPLE_RATE * (1 << kYM2413SampleAccuracy) + (m_iClockRate / 2)) / m_iClockRate);
     m_ElapsedCycles = 0;
-    m_CurrentSample = 0;
     m_iCycleCounter = 0;
-    m_iSampleCounter = 0;
-    m_iBufferIndex = 0;
+    m_iFrameCycles = 0;
     m_RegisterF2 = 0;
     m_CurrentSample = 0;
     m_bEnabled = false;
 
-    YM2413ResetChip();
+    YM2413ResetChip(&m_Chip);
+
+    m_Blip.clock_rate(m_iClockRate);
+    m_Blip.clear();
+    m_Synth.output(&m_Blip);
+    m_bOutputStale = false;
 
     for (int i = 0; i < GS_AUDIO_BUFFER_SIZE; i++)
     {
@@ -66,6 +82,14 @@ void YM2413::Reset(int clockRate)
     }
 }
 
+void YM2413::SetSampleRate(int sampleRate)
+{
+    // Samples still pending in the resampler are dropped, the chip keeps
+    // running and the output restarts from its current level
+    m_Blip.set_sample_rate(sampleRate);
+    ResetOutput();
+}
+
 void YM2413::Write(u8 port, u8 value)
 {
     if (port & 0x01)
@@ -73,18 +97,22 @@ void YM2413::Write(u8 port, u8 value)
         Sync();
     }
 
-    YM2413Write(port, value);
+    YM2413Write(&m_Chip, port, value);
 }
 
 u8 YM2413::Read()
 {
-    return YM2413Read();
+    return YM2413Read(&m_Chip);
+}
+
+YM2413_OPLL* YM2413::GetChip()
+{
+    return &m_Chip;
 }
 
 u8 YM2413::GetSelectedRegister() const
 {
-    const YM2413_OPLL* context = reinterpret_cast<const YM2413_OPLL*>(YM2413GetContextPtr());
-    return context->address;
+    return m_Chip.address;
 }
 
 void YM2413::Tick(unsigned int clockCycles)
@@ -96,20 +124,29 @@ int YM2413::EndFrame(s16* pSampleBuffer)
 {
     Sync();
 
+    if (!m_bOutputEnabled)
+    {
+        m_iFrameCycles = 0;
+        return 0;
+    }
+
+    m_Blip.end_frame(m_iFrameCycles);
+    m_iFrameCycles = 0;
+
+    int count = (int)m_Blip.read_samples(m_pBuffer, GS_AUDIO_BUFFER_SIZE / 2);
     int ret = 0;
 
     if (IsValidPointer(pSampleBuffer))
     {
-        ret = m_iBufferIndex;
+        ret = count * 2;
 
-        for (int i = 0; i < m_iBufferIndex; i++)
+        for (int i = 0; i < count; i++)
         {
-            pSampleBuffer[i] = m_pBuffer[i];
+            pSampleBuffer[(i * 2) + 0] = m_pBuffer[i];
+            pSampleBuffer[(i * 2) + 1] = m_pBuffer[i];
         }
     }
 
-    m_iBufferIndex = 0;
-
     return ret;
 }
 
@@ -120,18 +157,25 @@ void YM2413::Enable(bool bEnabled)
 
     Sync();
     m_bEnabled = bEnabled;
+
+    if (!m_bEnabled)
+        m_Synth.update(m_iFrameCycles, 0);
 }
 
-INLINE void YM2413::WriteSample(s16 sample)
+void YM2413::SetOutputEnabled(bool bEnabled)
 {
-    m_pBuffer[m_iBufferIndex] = sample;
-    m_pBuffer[m_iBufferIndex + 1] = sample;
-    m_iBufferIndex += 2;
+    if (m_bOutputEnabled == bEnabled)
+        return;
 
-    if (m_iBufferIndex >= GS_AUDIO_BUFFER_SIZE)
+    Sync();
+    m_bOutputEnabled = bEnabled;
+
+    if (!m_bOutputEnabled)
+        m_bOutputStale = true;
+    else if (m_bOutputStale)
     {
-        Debug("YM2413 Audio buffer overflow");
-        m_iBufferIndex = 0;
+        // Nothing was fed to the resampler while the output was off
+        ResetOutput();
     }
 }
 
@@ -139,100 +183,154 @@ void YM2413::Sync()
 {
     if (!m_bEnabled)
     {
-        s64 total = (s64)m_iSampleCounter + ((s64)m_ElapsedCycles * m_iSampleRateFactor);
-        int sample_count = (int)(total >> kYM2413SampleAccuracy);
-        m_iSampleCounter = (int)(total & ((1 << kYM2413SampleAccuracy) - 1));
-
-        for (int i = 0; i < sample_count; i++)
-            WriteSample(0);
+        m_iFrameCycles += m_ElapsedCycles;
+        m_ElapsedCycles = 0;
+        return;
     }
-    else
+
+    // Samples are rendered in blocks at the native rate and fed to a
+    // band-limited synth, which resamples them to the output rate
+    while (m_ElapsedCycles > 0)
     {
-        while (m_ElapsedCycles > 0)
+        int pending = (m_iCycleCounter + m_ElapsedCycles) / kYM2413CyclesPerSample;
+
+        if (pending == 0)
         {
-            int cycles_to_update = 72 - m_iCycleCounter;
-            int cycles_to_sample = ((1 << kYM2413SampleAccuracy) - m_iSampleCounter + m_iSampleRateFactor - 1) / m_iSampleRateFactor;
-            int cycles = cycles_to_update < cycles_to_sample ? cycles_to_update : cycles_to_sample;
+            m_iCycleCounter += m_ElapsedCycles;
+            m_iFrameCycles += m_ElapsedCycles;
+            m_ElapsedCycles = 0;
+            break;
+        }
 
-            if (cycles > m_ElapsedCycles)
-                cycles = m_ElapsedCycles;
+        int count = MIN(pending, kYM2413BlockSize);
+        int time = m_iFrameCycles + kYM2413CyclesPerSample - m_iCycleCounter;
 
-            m_iCycleCounter += cycles;
-            m_iSampleCounter += cycles * m_iSampleRateFactor;
-            m_ElapsedCycles -= cycles;
+        if (!m_bOutputEnabled)
+        {
+            // Advance the chip without synthesizing the carriers
+            m_NativeBuffer[count - 1] = YM2413SkipBlock(&m_Chip, count);
+        }
+        else if (YM2413UpdateBlock(&m_Chip, m_NativeBuffer, count))
+        {
+            // Every operator is off, the level only needs to drop to zero once
+            m_Synth.update(time, 0);
+        }
+        else
+        {
+            m_Synth.update(time, (s16)m_NativeBuffer[0]);
 
-            if (m_iCycleCounter >= 72)
+            // A repeated sample is a zero step, only level changes are fed
+            for (int i = 1; i < count; i++)
             {
-                m_iCycleCounter -= 72;
-                m_CurrentSample = YM2413Update();
-            }
+                time += kYM2413CyclesPerSample;
 
-            if (m_iSampleCounter >= (1 << kYM2413SampleAccuracy))
-            {
-                m_iSampleCounter -= (1 << kYM2413SampleAccuracy);
-                WriteSample(m_CurrentSample);
+                if (m_NativeBuffer[i] != m_NativeBuffer[i - 1])
+                    m_Synth.update(time, (s16)m_NativeBuffer[i]);
             }
         }
-    }
 
-    m_ElapsedCycles = 0;
+        int cycles = (count * kYM2413CyclesPerSample) - m_iCycleCounter;
+        m_iFrameCycles += cycles;
+        m_ElapsedCycles -= cycles;
+        m_iCycleCounter = 0;
+        m_CurrentSample = (s16)m_NativeBuffer[count - 1];
+    }
 }
 
-void YM2413::SaveState(std::ostream& stream)
+void YM2413::SaveState(state_writer& stream)
 {
+    // Fields from the old point-sampling resampler are kept so the
+    // savestate layout does not change
+    int sample_counter = 0;
+    int buffer_index = 0;
+    int sample_rate_factor = 0;
+
     stream.write(reinterpret_cast<const char*>(&m_iCycleCounter), sizeof(int));
-    stream.write(reinterpret_cast<const char*>(&m_iSampleCounter), sizeof(int));
-    stream.write(reinterpret_cast<const char*>(&m_iBufferIndex), sizeof(int));
+    stream.write(reinterpret_cast<const char*>(&sample_counter), sizeof(int));
+    stream.write(reinterpret_cast<const char*>(&buffer_index), sizeof(int));
     stream.write(reinterpret_cast<const char*>(&m_ElapsedCycles), sizeof(int));
     stream.write(reinterpret_cast<const char*>(&m_iClockRate), sizeof(int));
     stream.write(reinterpret_cast<const char*>(&m_RegisterF2), sizeof(u8));
     stream.write(reinterpret_cast<const char*>(&m_CurrentSample), sizeof(s16));
     stream.write(reinterpret_cast<const char*>(&m_bEnabled), sizeof(bool));
-    stream.write(reinterpret_cast<const char*>(&m_iSampleRateFactor), sizeof(int));
-    stream.write(reinterpret_cast<const char*>(m_pBuffer), sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
+    stream.write(reinterpret_cast<const char*>(&sample_rate_factor), sizeof(int));
 
-    unsigned char* context = YM2413GetContextPtr();
-    unsigned int contex_size = YM2413GetContextSize();
-    stream.write(reinterpret_cast<const char*>(context), contex_size);
+    if (stream.compact())
+    {
+        // The output buffer is refilled every frame and the frequency table
+        // only depends on the chip clock
+        const size_t table_begin = offsetof(YM2413_OPLL, fn_tab);
+        const size_t table_end = table_begin + sizeof(m_Chip.fn_tab);
+        stream.write(reinterpret_cast<const char*>(&m_Chip), table_begin);
+        stream.write(reinterpret_cast<const char*>(&m_Chip) + table_end, sizeof(YM2413_OPLL) - table_end);
+    }
+    else
+    {
+        stream.write(reinterpret_cast<const char*>(m_pBuffer), sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
+        stream.write(reinterpret_cast<const char*>(&m_Chip), sizeof(YM2413_OPLL));
+    }
 }
 
-void YM2413::LoadState(std::istream& stream)
+void YM2413::LoadState(state_reader& stream)
 {
+    int unused = 0;
+
     stream.read(reinterpret_cast<char*>(&m_iCycleCounter), sizeof(int));
-    stream.read(reinterpret_cast<char*>(&m_iSampleCounter), sizeof(int));
-    stream.read(reinterpret_cast<char*>(&m_iBufferIndex), sizeof(int));
+    stream.read(reinterpret_cast<char*>(&unused), sizeof(int));
+    stream.read(reinterpret_cast<char*>(&unused), sizeof(int));
     stream.read(reinterpret_cast<char*>(&m_ElapsedCycles), sizeof(int));
     stream.read(reinterpret_cast<char*>(&m_iClockRate), sizeof(int));
     stream.read(reinterpret_cast<char*>(&m_RegisterF2), sizeof(u8));
     stream.read(reinterpret_cast<char*>(&m_CurrentSample), sizeof(s16));
     stream.read(reinterpret_cast<char*>(&m_bEnabled), sizeof(bool));
-    stream.read(reinterpret_cast<char*>(&m_iSampleRateFactor), sizeof(int));
-    stream.read(reinterpret_cast<char*>(m_pBuffer), sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
+    stream.read(reinterpret_cast<char*>(&unused), sizeof(int));
 
-    unsigned char* context = YM2413GetContextPtr();
-    unsigned int context_size = YM2413GetContextSize();
-    stream.read(reinterpret_cast<char*>(context), context_size);
+    if (stream.compact())
+    {
+        const size_t table_begin = offsetof(YM2413_OPLL, fn_tab);
+        const size_t table_end = table_begin + sizeof(m_Chip.fn_tab);
+        stream.read(reinterpret_cast<char*>(&m_Chip), table_begin);
+        stream.read(reinterpret_cast<char*>(&m_Chip) + table_end, sizeof(YM2413_OPLL) - table_end);
+    }
+    else
+    {
+        stream.read(reinterpret_cast<char*>(m_pBuffer), sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
+        stream.read(reinterpret_cast<char*>(&m_Chip), sizeof(YM2413_OPLL));
+    }
 
-    m_iSampleRateFactor = (int)(((s64)GS_AUDIO_SAMPLE_RATE * (1 << kYM2413SampleAccuracy) + (m_iClockRate / 2)) / m_iClockRate);
+    ResetOutput();
 }
 
-void YM2413::LoadStateV1(std::istream& stream)
+void YM2413::LoadStateV1(state_reader& stream)
 {
+    int unused = 0;
+
     stream.read(reinterpret_cast<char*>(&m_iCycleCounter), sizeof(int));
-    stream.read(reinterpret_cast<char*>(&m_iSampleCounter), sizeof(int));
-    stream.read(reinterpret_cast<char*>(&m_iBufferIndex), sizeof(int));
+    stream.read(reinterpret_cast<char*>(&unused), sizeof(int));
+    stream.read(reinterpret_cast<char*>(&unused), sizeof(int));
     stream.read(reinterpret_cast<char*>(&m_ElapsedCycles), sizeof(int));
     stream.read(reinterpret_cast<char*>(&m_iClockRate), sizeof(int));
     stream.read(reinterpret_cast<char*>(&m_RegisterF2), sizeof(u8));
     stream.read(reinterpret_cast<char*>(&m_CurrentSample), sizeof(s16));
     stream.read(reinterpret_cast<char*>(&m_bEnabled), sizeof(bool));
-    stream.read(reinterpret_cast<char*>(&m_iSampleRateFactor), sizeof(int));
-    stream.seekg(sizeof(s16) * GS_AUDIO_BUFFER_SIZE_V1, std::ios::cur);
+    stream.read(reinterpret_cast<char*>(&unused), sizeof(int));
+    stream.skip(sizeof(s16) * GS_AUDIO_BUFFER_SIZE_V1);
     memset(m_pBuffer, 0, sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
+    stream.read(reinterpret_cast<char*>(&m_Chip), sizeof(YM2413_OPLL));
 
-    unsigned char* context = YM2413GetContextPtr();
-    unsigned int context_size = YM2413GetContextSize();
-    stream.read(reinterpret_cast<char*>(context), context_size);
+    ResetOutput();
+}
 
-    m_iSampleRateFactor = (int)(((s64)GS_AUDIO_SAMPLE_RATE * (1 << kYM2413SampleAccuracy) + (m_iClockRate / 2)) / m_iClockRate);
+void YM2413::ResetOutput()
+{
+    // Resampler history is not part of the savestate, restart from the
+    // level the chip was producing
+    m_iFrameCycles = 0;
+    m_Blip.clock_rate(m_iClockRate);
+    m_Blip.clear();
+    m_Synth.output(&m_Blip);
+    m_bOutputStale = false;
+
+    if (m_bEnabled)
+        m_Synth.update(0, m_CurrentSample);
 }
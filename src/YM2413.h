@@ -2,8 +2,14 @@
 #define YM2413_H
 
 #include "definitions.h"
+#include "state_serializer.h"
 #include "log.h"
 #include "audio/emu2413/emu2413.h"
+#include "audio/Blip_Buffer.h"
+
+// The chip produces one sample every 72 master clock cycles
+const int kYM2413CyclesPerSample = 72;
+const int kYM2413BlockSize = 256;
 
 class YM2413
 {
@@ -12,35 +18,40 @@ public:
     YM2413();
     ~YM2413();
 
-    void Init(int clockRate);
+    void Init(int clockRate, int sampleRate);
     void Reset(int clockRate);
+    void SetSampleRate(int sampleRate);
     void Write(u8 port, u8 value);
     u8 Read();
+    YM2413_OPLL* GetChip();
     u8 GetSelectedRegister() const;
     void Tick(unsigned int clockCycles);
     int EndFrame(s16* pSampleBuffer);
     void Enable(bool bEnabled);
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream);
-    void LoadStateV1(std::istream& stream);
+    void SetOutputEnabled(bool bEnabled);
+    void SaveState(state_writer& stream);
+    void LoadState(state_reader& stream);
+    void LoadStateV1(state_reader& stream);
 
 private:
-    INLINE void WriteSample(s16 sample);
     void Sync();
+    void ResetOutput();
 
 private:
     int m_iCycleCounter;
-    int m_iSampleCounter;
-    int m_iSampleRateFactor;
+    int m_iFrameCycles;
     s16* m_pBuffer;
-    int m_iBufferIndex;
     int m_ElapsedCycles;
     int m_iClockRate;
     u8 m_RegisterF2;
     s16 m_CurrentSample;
     bool m_bEnabled;
+    bool m_bOutputEnabled;
+    bool m_bOutputStale;
+    YM2413_OPLL m_Chip;
+    int m_NativeBuffer[kYM2413BlockSize];
+    Blip_Buffer m_Blip;
+    Blip_Synth<blip_good_quality, 0x10000> m_Synth;
 };
 
-const int kYM2413SampleAccuracy = 16;
-
 #endif	/* YM2413_H */
@@ -1,8 +1,7 @@
 // Sms_Snd_Emu 0.1.4. http://www.slack.net/~ant/
 
 #include "Sms_Apu.h"
-#include <istream>
-#include <ostream>
+#include "../state_serializer.h"
 
 /* Copyright (C) 2003-2006 Shay Green. This module is free software; you
 can redistribute it and/or modify it under the terms of the GNU Lesser
@@ -29,8 +28,6 @@ Sms_Osc::Sms_Osc()
 	outputs [3] = 0;
 	volume_reg = 0;
 	mute = false;
-	debug_buf = 0;
-	debug_last_amp = 0;
 }
 
 void Sms_Osc::reset()
@@ -41,7 +38,6 @@ void Sms_Osc::reset()
 	volume_reg = 15;
 	output_select = 3;
 	output = outputs [3];
-	debug_last_amp = 0;
 }
 
 // Sms_Square
@@ -68,15 +64,6 @@ void Sms_Square::run( blip_time_t time, blip_time_t end_time )
             last_amp = amp;
             synth->offset( time, delta, output );
         }
-        if ( debug_buf )
-        {
-            int dbg_delta = amp - debug_last_amp;
-            if ( dbg_delta )
-            {
-                debug_last_amp = amp;
-                synth->offset( time, dbg_delta, debug_buf );
-            }
-        }
     }
 
     time += delay;
@@ -95,20 +82,16 @@ void Sms_Square::run( blip_time_t time, blip_time_t end_time )
             else
             {
                 Blip_Buffer* const output_ = this->output;
-                Blip_Buffer* const dbg_buf = this->debug_buf;
                 int delta = amp * 2 - volume * 2;
                 do
                 {
                     delta = -delta;
                     synth->offset_inline( time, delta, output_ );
-                    if ( dbg_buf )
-                        synth->offset_inline( time, delta, dbg_buf );
                     time += effective_period;
                 }
                 while ( time < end_time );
 
                 last_amp = (delta >> 1) + volume;
-                debug_last_amp = last_amp;
                 phase = (delta >= 0);
             }
         }
@@ -116,6 +99,24 @@ void Sms_Square::run( blip_time_t time, blip_time_t end_time )
     }
 }
 
+void Sms_Square::skip( blip_time_t time, blip_time_t end_time )
+{
+	// Same timing as run(), each period only toggles the phase
+	int effective_period = period ? period : (ti ? 0x400 : 0);
+	time += delay;
+	delay = 0;
+	if ( effective_period )
+	{
+		if ( time < end_time )
+		{
+			int count = (end_time - time + effective_period - 1) / effective_period;
+			phase = (phase + count) & 1;
+			time += count * effective_period;
+		}
+		delay = time - end_time;
+	}
+}
+
 // Sms_Noise
 
 static int const noise_periods [3] = { 0x100, 0x200, 0x400 };
@@ -145,15 +146,6 @@ void Sms_Noise::run( blip_time_t time, blip_time_t end_time )
 			last_amp = amp;
 			synth.offset( time, delta, output );
 		}
-		if ( debug_buf )
-		{
-			int dbg_delta = amp - debug_last_amp;
-			if ( dbg_delta )
-			{
-				debug_last_amp = amp;
-				synth.offset( time, dbg_delta, debug_buf );
-			}
-		}
 	}
 	
 	time += delay;
@@ -163,7 +155,6 @@ void Sms_Noise::run( blip_time_t time, blip_time_t end_time )
 	if ( time < end_time )
 	{
 		Blip_Buffer* const output_ = this->output;
-		Blip_Buffer* const dbg_buf = this->debug_buf;
 		unsigned shifter_ = this->shifter;
 		int delta = (shifter_ & 1) ? (-volume * 2) : (volume * 2);
 		int period_ = *this->period * 2;
@@ -179,10 +170,7 @@ void Sms_Noise::run( blip_time_t time, blip_time_t end_time )
 				amp = (shifter_ & 1) ? 0 : volume * 2;
 				delta = -delta;
 				synth.offset_inline( time, delta, output_ );
-				if ( dbg_buf )
-					synth.offset_inline( time, delta, dbg_buf );
 				last_amp = amp;
-				debug_last_amp = amp;
 			}
 			time += period_;
 		}
@@ -190,7 +178,32 @@ void Sms_Noise::run( blip_time_t time, blip_time_t end_time )
 		
 		this->shifter = shifter_;
 		this->last_amp = (shifter_ & 1) ? 0 : volume * 2;
-		this->debug_last_amp = this->last_amp;
+	}
+	delay = time - end_time;
+}
+
+void Sms_Noise::skip( blip_time_t time, blip_time_t end_time )
+{
+	// Same timing as run(), only the shifter is clocked
+	time += delay;
+	if ( !volume )
+		time = end_time;
+
+	if ( time < end_time )
+	{
+		unsigned shifter_ = this->shifter;
+		int period_ = *this->period * 2;
+		if ( !period_ )
+			period_ = 16;
+
+		do
+		{
+			shifter_ = (feedback & (unsigned)(-(int)(shifter_ & 1))) ^ (shifter_ >> 1);
+			time += period_;
+		}
+		while ( time < end_time );
+
+		this->shifter = shifter_;
 	}
 	delay = time - end_time;
 }
@@ -205,8 +218,13 @@ Sms_Apu::Sms_Apu()
 		oscs [i] = &squares [i];
 	}
 	oscs [3] = &noise;
+	for ( int i = 0; i < 3; i++ )
+		debug_squares [i].synth = &square_synth;
+	debug_current = 0;
+	debug_frame_count = 0;
 	debug_enabled = false;
 	ti_chip_mode = false;
+	synthesis_enabled = true;
 	
 	volume( 1.0 );
 	reset(false);
@@ -221,12 +239,14 @@ void Sms_Apu::volume( double vol )
 	vol *= 0.85 / (osc_count * 64 * 2);
 	square_synth.volume( vol );
 	noise.synth.volume( vol );
+	debug_noise.synth.volume( vol );
 }
 
 void Sms_Apu::treble_eq( const blip_eq_t& eq )
 {
 	square_synth.treble_eq( eq );
 	noise.synth.treble_eq( eq );
+	debug_noise.synth.treble_eq( eq );
 }
 
 void Sms_Apu::osc_output( int index, Blip_Buffer* center, Blip_Buffer* left, Blip_Buffer* right )
@@ -269,6 +289,9 @@ void Sms_Apu::reset(bool ti_chip )
 	squares [1].reset(ti_chip);
 	squares [2].reset(ti_chip);
 	noise.reset(ti_chip);
+
+	if ( debug_enabled )
+		begin_debug_frame();
 }
 
 void Sms_Apu::run_until( blip_time_t end_time )
@@ -283,7 +306,14 @@ void Sms_Apu::run_until( blip_time_t end_time )
 			Sms_Osc& osc = *oscs [i];
 			if ( osc.output && !osc.mute )
 			{
-				if ( i < 3 )
+				if ( !synthesis_enabled )
+				{
+					if ( i < 3 )
+						squares [i].skip( last_time, end_time );
+					else
+						noise.skip( last_time, end_time );
+				}
+				else if ( i < 3 )
 					squares [i].run( last_time, end_time );
 				else
 					noise.run( last_time, end_time );
@@ -304,11 +334,24 @@ void Sms_Apu::end_frame( blip_time_t end_time )
 
 	if ( debug_enabled )
 	{
-		for ( int i = 0; i < osc_count; i++ )
-			debug_bufs [i].end_frame( end_time );
+		debug_frames [debug_current].end_time = end_time;
+		debug_current ^= 1;
+		debug_frame_count++;
+		begin_debug_frame();
 	}
 }
 
+void Sms_Apu::enable_synthesis( bool enabled )
+{
+	synthesis_enabled = enabled;
+}
+
+void Sms_Apu::restart_output()
+{
+	for ( int i = 0; i < osc_count; i++ )
+		oscs [i]->last_amp = 0;
+}
+
 void Sms_Apu::write_ggstereo( blip_time_t time, int data )
 {
 	require( (unsigned) data <= 0xFF );
@@ -316,6 +359,12 @@ void Sms_Apu::write_ggstereo( blip_time_t time, int data )
 	ggstereo_save = data;
 
 	run_until( time );
+
+	if ( debug_enabled )
+	{
+		Debug_Write write = { time, data, true };
+		debug_frames [debug_current].writes.push_back( write );
+	}
 	
 	for ( int i = 0; i < osc_count; i++ )
 	{
@@ -326,7 +375,7 @@ void Sms_Apu::write_ggstereo( blip_time_t time, int data )
 		osc.output = osc.outputs [osc.output_select];
 		if ( osc.output != old_output && osc.last_amp )
 		{
-			if ( old_output )
+			if ( old_output && synthesis_enabled )
 			{
 				square_synth.offset( time, -osc.last_amp, old_output );
 			}
@@ -354,24 +403,27 @@ static int noise_period_index( const Sms_Noise& noise, const Sms_Square* squares
 	return 0;
 }
 
-static void save_osc_state( std::ostream& stream, const Sms_Osc& osc )
+static void save_osc_state( state_writer& stream, const Sms_Osc& osc )
 {
 	stream.write( reinterpret_cast<const char*>( &osc.output_select ), sizeof( osc.output_select ) );
 	stream.write( reinterpret_cast<const char*>( &osc.delay ), sizeof( osc.delay ) );
 	stream.write( reinterpret_cast<const char*>( &osc.last_amp ), sizeof( osc.last_amp ) );
 	stream.write( reinterpret_cast<const char*>( &osc.volume ), sizeof( osc.volume ) );
 	stream.write( reinterpret_cast<const char*>( &osc.volume_reg ), sizeof( osc.volume_reg ) );
-	stream.write( reinterpret_cast<const char*>( &osc.debug_last_amp ), sizeof( osc.debug_last_amp ) );
+	// Was the amplitude of the old per-oscillator debug buffer
+	int unused = 0;
+	stream.write( reinterpret_cast<const char*>( &unused ), sizeof( unused ) );
 }
 
-static void load_osc_state( std::istream& stream, Sms_Osc& osc )
+static void load_osc_state( state_reader& stream, Sms_Osc& osc )
 {
 	stream.read( reinterpret_cast<char*>( &osc.output_select ), sizeof( osc.output_select ) );
 	stream.read( reinterpret_cast<char*>( &osc.delay ), sizeof( osc.delay ) );
 	stream.read( reinterpret_cast<char*>( &osc.last_amp ), sizeof( osc.last_amp ) );
 	stream.read( reinterpret_cast<char*>( &osc.volume ), sizeof( osc.volume ) );
 	stream.read( reinterpret_cast<char*>( &osc.volume_reg ), sizeof( osc.volume_reg ) );
-	stream.read( reinterpret_cast<char*>( &osc.debug_last_amp ), sizeof( osc.debug_last_amp ) );
+	int unused = 0;
+	stream.read( reinterpret_cast<char*>( &unused ), sizeof( unused ) );
 
 	if ( osc.output_select < 0 || osc.output_select > 3 )
 		osc.output_select = 3;
@@ -384,19 +436,31 @@ void Sms_Apu::write_data( blip_time_t time, int data )
 	require( (unsigned) data <= 0xFF );
 	
 	run_until( time );
+
+	if ( debug_enabled )
+	{
+		Debug_Write write = { time, data, false };
+		debug_frames [debug_current].writes.push_back( write );
+	}
 	
+	apply_data( squares, noise, latch, data );
+}
+
+void Sms_Apu::apply_data( Sms_Square* sqs, Sms_Noise& nz, int& latch_, int data ) const
+{
 	if ( data & 0x80 )
-		latch = data;
+		latch_ = data;
 	
-	int index = (latch >> 5) & 3;
-	if ( latch & 0x10 )
+	int index = (latch_ >> 5) & 3;
+	Sms_Osc& osc = (index < 3) ? static_cast<Sms_Osc&>( sqs [index] ) : static_cast<Sms_Osc&>( nz );
+	if ( latch_ & 0x10 )
 	{
-		oscs [index]->volume = volumes [data & 15];
-		oscs [index]->volume_reg = data & 15;
+		osc.volume = volumes [data & 15];
+		osc.volume_reg = data & 15;
 	}
 	else if ( index < 3 )
 	{
-		Sms_Square& sq = squares [index];
+		Sms_Square& sq = sqs [index];
 		if ( data & 0x80 )
 			sq.period = (sq.period & 0xFF00) | (data << 4 & 0x00FF);
 		else
@@ -406,16 +470,16 @@ void Sms_Apu::write_data( blip_time_t time, int data )
 	{
 		int select = data & 3;
 		if ( select < 3 )
-			noise.period = &noise_periods [select];
+			nz.period = &noise_periods [select];
 		else
-			noise.period = &squares [2].period;
+			nz.period = &sqs [2].period;
 		
-		noise.feedback = (data & 0x04) ? noise_feedback : looped_feedback;
-		noise.shifter = 0x8000;
+		nz.feedback = (data & 0x04) ? noise_feedback : looped_feedback;
+		nz.shifter = 0x8000;
 	}
 }
 
-void Sms_Apu::SaveState( std::ostream& stream )
+void Sms_Apu::SaveState( state_writer& stream )
 {
 	stream.write( reinterpret_cast<const char*>( &last_time ), sizeof( last_time ) );
 	stream.write( reinterpret_cast<const char*>( &latch ), sizeof( latch ) );
@@ -438,7 +502,7 @@ void Sms_Apu::SaveState( std::ostream& stream )
 	stream.write( reinterpret_cast<const char*>( &noise.feedback ), sizeof( noise.feedback ) );
 }
 
-void Sms_Apu::LoadState( std::istream& stream )
+void Sms_Apu::LoadState( state_reader& stream )
 {
 	stream.read( reinterpret_cast<char*>( &last_time ), sizeof( last_time ) );
 	stream.read( reinterpret_cast<char*>( &latch ), sizeof( latch ) );
@@ -470,6 +534,9 @@ void Sms_Apu::LoadState( std::istream& stream )
 			period_index = 0;
 		noise.period = &noise_periods [period_index];
 	}
+
+	if ( debug_enabled )
+		begin_debug_frame();
 }
 
 Sms_Apu_State Sms_Apu::GetState()
@@ -515,23 +582,31 @@ Sms_Apu_State Sms_Apu::GetState()
 void Sms_Apu::init_debug_buffers( long sample_rate, long clock_rate )
 {
 	debug_enabled = true;
-	double vol = 0.85 / (osc_count * 64 * 2);
-	debug_synth.volume( vol );
+	debug_frame_count = 0;
 
 	for ( int i = 0; i < osc_count; i++ )
 	{
 		debug_bufs [i].set_sample_rate( sample_rate );
 		debug_bufs [i].clock_rate( clock_rate );
 		debug_bufs [i].clear();
-		oscs [i]->debug_buf = &debug_bufs [i];
+		debug_buf_frame [i] = 0;
+		debug_last_amp [i] = 0;
 	}
+
+	// Nothing to replay until a full frame has been recorded
+	debug_frames [debug_current ^ 1].end_time = 0;
+	debug_frames [debug_current ^ 1].writes.clear();
+	begin_debug_frame();
 }
 
 void Sms_Apu::disable_debug_buffers()
 {
 	debug_enabled = false;
-	for ( int i = 0; i < osc_count; i++ )
-		oscs [i]->debug_buf = 0;
+	for ( int i = 0; i < 2; i++ )
+	{
+		std::vector<Debug_Write> empty;
+		debug_frames [i].writes.swap( empty );
+	}
 }
 
 bool Sms_Apu::is_debug_enabled() const
@@ -539,14 +614,137 @@ bool Sms_Apu::is_debug_enabled() const
 	return debug_enabled;
 }
 
+void Sms_Apu::begin_debug_frame()
+{
+	Debug_Frame& frame = debug_frames [debug_current];
+
+	for ( int i = 0; i < osc_count; i++ )
+	{
+		frame.output_select [i] = oscs [i]->output_select;
+		frame.delay [i] = oscs [i]->delay;
+		frame.volume [i] = oscs [i]->volume;
+		frame.volume_reg [i] = oscs [i]->volume_reg;
+		frame.last_amp [i] = oscs [i]->last_amp;
+	}
+
+	for ( int i = 0; i < 3; i++ )
+	{
+		frame.period [i] = squares [i].period;
+		frame.phase [i] = squares [i].phase;
+	}
+
+	frame.noise_period_index = noise_period_index( noise, squares, noise_periods );
+	frame.noise_shifter = noise.shifter;
+	frame.noise_feedback = noise.feedback;
+	frame.latch = latch;
+	frame.end_time = 0;
+	frame.writes.clear();
+}
+
+void Sms_Apu::replay_debug_frame( int channel )
+{
+	const Debug_Frame& frame = debug_frames [debug_current ^ 1];
+	Sms_Osc* debug_oscs [osc_count] = { &debug_squares [0], &debug_squares [1], &debug_squares [2], &debug_noise };
+
+	for ( int i = 0; i < osc_count; i++ )
+	{
+		Sms_Osc& osc = *debug_oscs [i];
+		osc.outputs [1] = &debug_bufs [channel];
+		osc.outputs [2] = &debug_bufs [channel];
+		osc.outputs [3] = &debug_bufs [channel];
+		osc.output_select = frame.output_select [i];
+		osc.output = osc.outputs [osc.output_select];
+		osc.delay = frame.delay [i];
+		osc.volume = frame.volume [i];
+		osc.volume_reg = frame.volume_reg [i];
+	}
+
+	for ( int i = 0; i < 3; i++ )
+	{
+		debug_squares [i].period = frame.period [i];
+		debug_squares [i].phase = frame.phase [i];
+		debug_squares [i].ti = ti_chip_mode;
+	}
+
+	if ( frame.noise_period_index == 3 )
+		debug_noise.period = &debug_squares [2].period;
+	else
+		debug_noise.period = &noise_periods [frame.noise_period_index];
+	debug_noise.shifter = frame.noise_shifter;
+	debug_noise.feedback = frame.noise_feedback;
+	debug_noise.ti = ti_chip_mode;
+
+	int debug_latch = frame.latch;
+	Sms_Osc& osc = *debug_oscs [channel];
+	Blip_Buffer& buf = debug_bufs [channel];
+	bool muted = oscs [channel]->mute;
+	blip_time_t time = 0;
+	size_t next = 0;
+
+	if ( debug_buf_frame [channel] && (debug_buf_frame [channel] + 1 == debug_frame_count) )
+	{
+		// The previous frame was rendered too, keep the waveform continuous
+		osc.last_amp = debug_last_amp [channel];
+	}
+	else
+	{
+		// Start from the amplitude the oscillator had at the frame start, the
+		// same value a continuous replay would carry over
+		buf.clear();
+		osc.last_amp = frame.last_amp [channel];
+	}
+
+	while ( true )
+	{
+		blip_time_t until = (next < frame.writes.size()) ? frame.writes [next].time : frame.end_time;
+
+		if ( until > time )
+		{
+			if ( osc.output && !muted )
+			{
+				if ( channel < 3 )
+					debug_squares [channel].run( time, until );
+				else
+					debug_noise.run( time, until );
+			}
+			time = until;
+		}
+
+		if ( next >= frame.writes.size() )
+			break;
+
+		const Debug_Write& write = frame.writes [next++];
+
+		if ( write.stereo )
+		{
+			// Panning only decides whether the channel runs, the waveform
+			// itself is not split between left and right
+			int flags = write.data >> channel;
+			osc.output_select = (flags >> 3 & 2) | (flags & 1);
+			osc.output = osc.outputs [osc.output_select];
+		}
+		else
+		{
+			apply_data( debug_squares, debug_noise, debug_latch, write.data );
+		}
+	}
+
+	buf.end_frame( frame.end_time );
+	debug_last_amp [channel] = osc.last_amp;
+	debug_buf_frame [channel] = debug_frame_count;
+}
+
 void Sms_Apu::read_debug_samples( blip_sample_t* out, int channel, long max_samples, long* count )
 {
-	if ( !debug_enabled || channel < 0 || channel >= osc_count )
+	if ( !debug_enabled || channel < 0 || channel >= osc_count || debug_frames [debug_current ^ 1].end_time <= 0 )
 	{
 		*count = 0;
 		return;
 	}
 
+	if ( debug_buf_frame [channel] != debug_frame_count )
+		replay_debug_frame( channel );
+
 	long avail = debug_bufs [channel].samples_avail();
 	if ( avail > max_samples )
 		avail = max_samples;
@@ -4,9 +4,12 @@
 #ifndef SMS_APU_H
 #define SMS_APU_H
 
-#include <iosfwd>
+#include <vector>
 #include "Sms_Oscs.h"
 
+class state_writer;
+class state_reader;
+
 struct Sms_Apu_State
 {
 	struct Channel
@@ -64,13 +67,23 @@ public:
 	// start a new frame at time 0.
 	void end_frame( blip_time_t );
 
-	void SaveState( std::ostream& stream );
-	void LoadState( std::istream& stream );
+	// While disabled, oscillators advance their phase and noise shifter
+	// without adding anything to the output buffers
+	void enable_synthesis( bool );
+
+	// Start every oscillator from silence after the output buffers have
+	// been cleared
+	void restart_output();
+
+	void SaveState( state_writer& stream );
+	void LoadState( state_reader& stream );
 
 	// Get current state for debugger
 	Sms_Apu_State GetState();
 
-	// Debug per-channel buffers for oscilloscope
+	// Debug per-channel waveforms for oscilloscope. While enabled, the state
+	// at the start of each frame and the writes made during it are recorded.
+	// read_debug_samples() replays the previous frame for a single channel.
 	void init_debug_buffers( long sample_rate, long clock_rate );
 	void disable_debug_buffers();
 	bool is_debug_enabled() const;
@@ -94,11 +107,44 @@ private:
 	unsigned    looped_feedback;
 	unsigned int ggstereo_save;
 	bool        ti_chip_mode;
+	bool        synthesis_enabled;
+
+	struct Debug_Write
+	{
+		blip_time_t time;
+		int data;
+		bool stereo;
+	};
+	struct Debug_Frame
+	{
+		int output_select [osc_count];
+		int delay [osc_count];
+		int volume [osc_count];
+		int volume_reg [osc_count];
+		int last_amp [osc_count];
+		int period [3];
+		int phase [3];
+		int noise_period_index;
+		unsigned noise_shifter;
+		unsigned noise_feedback;
+		int latch;
+		blip_time_t end_time;
+		std::vector<Debug_Write> writes;
+	};
+	Debug_Frame debug_frames [2];
+	int         debug_current;
+	unsigned    debug_frame_count;
+	Sms_Square  debug_squares [3];
+	Sms_Noise   debug_noise;
 	Blip_Buffer debug_bufs [osc_count];
-	Blip_Synth<blip_med_quality,1> debug_synth;
+	unsigned    debug_buf_frame [osc_count];
+	int         debug_last_amp [osc_count];
 	bool        debug_enabled;
 	
 	void run_until( blip_time_t );
+	void apply_data( Sms_Square* sqs, Sms_Noise& nz, int& latch_, int data ) const;
+	void begin_debug_frame();
+	void replay_debug_frame( int channel );
 };
 
 inline void Sms_Apu::output( Blip_Buffer* b ) { output( b, b, b ); }
@@ -17,8 +17,6 @@ struct Sms_Osc
 	int volume;
 	int volume_reg;
 	bool mute;
-	Blip_Buffer* debug_buf;
-	int debug_last_amp;
 	
 	Sms_Osc();
 	void reset();
@@ -35,6 +33,7 @@ struct Sms_Square : Sms_Osc
 	
 	void reset(bool ti_chip);
 	void run( blip_time_t, blip_time_t );
+	void skip( blip_time_t, blip_time_t );
 };
 
 struct Sms_Noise : Sms_Osc
@@ -49,6 +48,7 @@ struct Sms_Noise : Sms_Osc
 	
 	void reset(bool ti_chip);
 	void run( blip_time_t, blip_time_t );
+	void skip( blip_time_t, blip_time_t );
 };
 
 #endif
\ No newline at end of file
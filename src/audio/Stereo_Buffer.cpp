@@ -2,8 +2,7 @@
 // Blip_Buffer 0.3.0. http://www.slack.net/~ant/nes-emu/
 
 #include "Stereo_Buffer.h"
-#include <istream>
-#include <ostream>
+#include "../state_serializer.h"
 
 /* Library Copyright (C) 2004 Shay Green. Blip_Buffer is free software;
 you can redistribute it and/or modify it under the terms of the GNU
@@ -146,7 +145,7 @@ void Stereo_Buffer::mix_mono( blip_sample_t* out, long count )
 	in.end( bufs [0] );
 }
 
-void Stereo_Buffer::SaveState( std::ostream& stream )
+void Stereo_Buffer::SaveState( state_writer& stream )
 {
 	for ( int i = 0; i < buf_count; i++ )
 	{
@@ -159,7 +158,7 @@ void Stereo_Buffer::SaveState( std::ostream& stream )
 	stream.write( reinterpret_cast<const char*>( &was_stereo ), sizeof( was_stereo ) );
 }
 
-void Stereo_Buffer::LoadState( std::istream& stream )
+void Stereo_Buffer::LoadState( state_reader& stream )
 {
 	for ( int i = 0; i < buf_count; i++ )
 	{
@@ -8,7 +8,9 @@
 #define STEREO_BUFFER_H
 
 #include "Blip_Buffer.h"
-#include <iosfwd>
+
+class state_writer;
+class state_reader;
 
 class Stereo_Buffer {
 public:
@@ -35,8 +37,8 @@ public:
 	// are in samples, *not* pairs.
 	long samples_avail() const;
 	long read_samples( blip_sample_t*, long );
-	void SaveState( std::ostream& stream );
-	void LoadState( std::istream& stream );
+	void SaveState( state_writer& stream );
+	void LoadState( state_reader& stream );
 	
 private:
 	// noncopyable
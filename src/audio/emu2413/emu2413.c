@@ -85,8 +85,6 @@ to do:
 #define EG_REL      1
 #define EG_OFF      0
 
-typedef YM2413_OPLL YM2413_Chip;
-
 /* key scale level */
 /* table is 3dB/octave, DV converts this into 6dB/octave */
 /* 0.1875 is bit 0 weight of the envelope counter (volume) expressed in the 'decibel' scale */
@@ -488,47 +486,62 @@ static unsigned char table[19][8] = {
   {0x05, 0x01, 0x00, 0x00, 0xf8, 0xaa, 0x59, 0x55 }  /* TOM, TOP CYM */
 };
 
-static signed int output[2];
+/* advance LFO to next sample */
+static inline void advance_lfo(YM2413_OPLL *chip, uint32_t *LFO_AM, int32_t *LFO_PM)
+{
+  /* LFO */
+  chip->lfo_am_cnt += chip->lfo_am_inc;
+  if (chip->lfo_am_cnt >= (uint32_t)(LFO_AM_TAB_ELEMENTS<<LFO_SH) )  /* lfo_am_table is 210 elements long */
+    chip->lfo_am_cnt -= (LFO_AM_TAB_ELEMENTS<<LFO_SH);
 
-static uint32_t  LFO_AM;
-static int32_t  LFO_PM;
+  *LFO_AM = lfo_am_table[ chip->lfo_am_cnt >> LFO_SH ] >> 1;
 
-/* emulated chip */
-static YM2413_Chip ym2413;
+  chip->lfo_pm_cnt += chip->lfo_pm_inc;
+  *LFO_PM = (chip->lfo_pm_cnt>>LFO_SH) & 7;
+}
 
-/* advance LFO to next sample */
-static inline void advance_lfo(void)
+/* phase increment of one operator for the current LFO PM step */
+static inline uint32_t phase_inc(YM2413_OPLL *chip, YM2413_OPLL_CH *CH, YM2413_OPLL_SLOT *op, int32_t LFO_PM)
 {
-  /* LFO */
-  ym2413.lfo_am_cnt += ym2413.lfo_am_inc;
-  if (ym2413.lfo_am_cnt >= (uint32_t)(LFO_AM_TAB_ELEMENTS<<LFO_SH) )  /* lfo_am_table is 210 elements long */
-    ym2413.lfo_am_cnt -= (LFO_AM_TAB_ELEMENTS<<LFO_SH);
+  if(op->vib)
+  {
+    uint8_t block;
 
-  LFO_AM = lfo_am_table[ ym2413.lfo_am_cnt >> LFO_SH ] >> 1;
+    unsigned int fnum_lfo   = 8*((CH->block_fnum&0x01c0) >> 6);
+    unsigned int block_fnum = CH->block_fnum * 2;
+    signed int lfo_fn_table_index_offset = lfo_pm_table[LFO_PM + fnum_lfo ];
 
-  ym2413.lfo_pm_cnt += ym2413.lfo_pm_inc;
-  LFO_PM = (ym2413.lfo_pm_cnt>>LFO_SH) & 7;
+    if (lfo_fn_table_index_offset)  /* LFO phase modulation active */
+    {
+      block_fnum += lfo_fn_table_index_offset;
+      block = (block_fnum&0x1c00) >> 10;
+      return (chip->fn_tab[block_fnum&0x03ff] >> (7-block)) * op->mul;
+    }
+  }
+
+  /* LFO phase modulation disabled or zero for this operator */
+  return op->freq;
 }
 
 /* advance to next sample */
-static inline void advance(void)
+static inline void advance(YM2413_OPLL *chip, int32_t LFO_PM)
 {
   YM2413_OPLL_CH *CH;
   YM2413_OPLL_SLOT *op;
   unsigned int i;
 
   /* Envelope Generator */
-  ym2413.eg_timer += ym2413.eg_timer_add;
+  chip->eg_timer += chip->eg_timer_add;
 
-  while (ym2413.eg_timer >= ym2413.eg_timer_overflow)
+  while (chip->eg_timer >= chip->eg_timer_overflow)
   {
-    ym2413.eg_timer -= ym2413.eg_timer_overflow;
+    chip->eg_timer -= chip->eg_timer_overflow;
 
-    ym2413.eg_cnt++;
+    chip->eg_cnt++;
 
     for (i=0; i<9*2; i++)
     {
-      CH  = &ym2413.P_CH[i>>1];
+      CH  = &chip->P_CH[i>>1];
 
       op  = &CH->SLOT[i&1];
 
@@ -554,9 +567,9 @@ static inline void advance(void)
               CH->SLOT[0].phase = CH->SLOT[1].phase = 0;
             }
           }
-          else if ( !(ym2413.eg_cnt & ((1<<op->eg_sh_dp)-1) ) )
+          else if ( !(chip->eg_cnt & ((1<<op->eg_sh_dp)-1) ) )
           {
-            op->volume += eg_inc[op->eg_sel_dp + ((ym2413.eg_cnt>>op->eg_sh_dp)&15)];
+            op->volume += eg_inc[op->eg_sel_dp + ((chip->eg_cnt>>op->eg_sh_dp)&15)];
           }
           break;
 
@@ -565,9 +578,9 @@ static inline void advance(void)
           {
             op->state = EG_DEC;
           }
-          else if ( !(ym2413.eg_cnt & (((1<<op->eg_sh_ar)-1) & ~3)) )
+          else if ( !(chip->eg_cnt & (((1<<op->eg_sh_ar)-1) & ~3)) )
           {
-            op->volume += (~op->volume * (eg_mul[op->eg_sel_ar + ((ym2413.eg_cnt>>op->eg_sh_ar)&15)]))>>4;
+            op->volume += (~op->volume * (eg_mul[op->eg_sel_ar + ((chip->eg_cnt>>op->eg_sh_ar)&15)]))>>4;
           }
           break;
 
@@ -576,9 +589,9 @@ static inline void advance(void)
           {
             op->state = EG_SUS;
           }
-          else if ( !(ym2413.eg_cnt & ((1<<op->eg_sh_dr)-1) ) )
+          else if ( !(chip->eg_cnt & ((1<<op->eg_sh_dr)-1) ) )
           {
-            op->volume += eg_inc[op->eg_sel_dr + ((ym2413.eg_cnt>>op->eg_sh_dr)&15)];
+            op->volume += eg_inc[op->eg_sel_dr + ((chip->eg_cnt>>op->eg_sh_dr)&15)];
             if ( (op->volume & ~3) == (MAX_ATT_INDEX & ~3) )  /* envelope level lowest 2 bits are ignored by the comparator */
             {
               op->state = EG_OFF;
@@ -598,9 +611,9 @@ static inline void advance(void)
           else  /* percussive mode */
           {
             /* during sustain phase chip adds Release Rate (in percussive mode) */
-            if ( !(ym2413.eg_cnt & ((1<<op->eg_sh_rr)-1) ) )
+            if ( !(chip->eg_cnt & ((1<<op->eg_sh_rr)-1) ) )
             {
-              op->volume += eg_inc[op->eg_sel_rr + ((ym2413.eg_cnt>>op->eg_sh_rr)&15)];
+              op->volume += eg_inc[op->eg_sel_rr + ((chip->eg_cnt>>op->eg_sh_rr)&15)];
               if ( (op->volume & ~3) == (MAX_ATT_INDEX & ~3) )  /* envelope level lowest 2 bits are ignored by the comparator */
               {
                 op->state = EG_OFF;
@@ -628,7 +641,7 @@ static inline void advance(void)
           7: 14(r),  15(a)
           8: 16(r),  17(a)
         */
-          if ( (i&1) || ((ym2413.rhythm&0x20) && (i>=12)) )/* exclude modulators */
+          if ( (i&1) || ((chip->rhythm&0x20) && (i>=12)) )/* exclude modulators */
           {
             if (op->eg_type)  /* non-percussive mode (sustained tone) */
             /*this is correct: use RR when SUS = OFF*/
@@ -636,9 +649,9 @@ static inline void advance(void)
             {
               if (CH->sus)
               {
-                if ( !(ym2413.eg_cnt & ((1<<op->eg_sh_rs)-1) ) )
+                if ( !(chip->eg_cnt & ((1<<op->eg_sh_rs)-1) ) )
                 {
-                  op->volume += eg_inc[op->eg_sel_rs + ((ym2413.eg_cnt>>op->eg_sh_rs)&15)];
+                  op->volume += eg_inc[op->eg_sel_rs + ((chip->eg_cnt>>op->eg_sh_rs)&15)];
                   if ( (op->volume & ~3) == (MAX_ATT_INDEX & ~3) )  /* envelope level lowest 2 bits are ignored by the comparator */
                   {
                     op->state = EG_OFF;
@@ -647,9 +660,9 @@ static inline void advance(void)
               }
               else
               {
-                if ( !(ym2413.eg_cnt & ((1<<op->eg_sh_rr)-1) ) )
+                if ( !(chip->eg_cnt & ((1<<op->eg_sh_rr)-1) ) )
                 {
-                  op->volume += eg_inc[op->eg_sel_rr + ((ym2413.eg_cnt>>op->eg_sh_rr)&15)];
+                  op->volume += eg_inc[op->eg_sel_rr + ((chip->eg_cnt>>op->eg_sh_rr)&15)];
                   if ( (op->volume & ~3) == (MAX_ATT_INDEX & ~3) )  /* envelope level lowest 2 bits are ignored by the comparator */
                   {
                     op->state = EG_OFF;
@@ -659,9 +672,9 @@ static inline void advance(void)
             }
             else  /* percussive mode */
             {
-              if ( !(ym2413.eg_cnt & ((1<<op->eg_sh_rs)-1) ) )
+              if ( !(chip->eg_cnt & ((1<<op->eg_sh_rs)-1) ) )
               {
-                op->volume += eg_inc[op->eg_sel_rs + ((ym2413.eg_cnt>>op->eg_sh_rs)&15)];
+                op->volume += eg_inc[op->eg_sel_rs + ((chip->eg_cnt>>op->eg_sh_rs)&15)];
                 if ( (op->volume & ~3) == (MAX_ATT_INDEX & ~3) )  /* envelope level lowest 2 bits are ignored by the comparator */
                 {
                   op->state = EG_OFF;
@@ -683,33 +696,11 @@ static inline void advance(void)
 
   for (i=0; i<9*2; i++)
   {
-    CH  = &ym2413.P_CH[i/2];
+    CH  = &chip->P_CH[i/2];
     op  = &CH->SLOT[i&1];
 
     /* Phase Generator */
-    if(op->vib)
-    {
-      uint8_t block;
-
-      unsigned int fnum_lfo   = 8*((CH->block_fnum&0x01c0) >> 6);
-      unsigned int block_fnum = CH->block_fnum * 2;
-      signed int lfo_fn_table_index_offset = lfo_pm_table[LFO_PM + fnum_lfo ];
-
-      if (lfo_fn_table_index_offset)  /* LFO phase modulation active */
-      {
-        block_fnum += lfo_fn_table_index_offset;
-        block = (block_fnum&0x1c00) >> 10;
-        op->phase += (ym2413.fn_tab[block_fnum&0x03ff] >> (7-block)) * op->mul;
-      }
-      else  /* LFO phase modulation  = zero */
-      {
-        op->phase += op->freq;
-      }
-    }
-    else  /* LFO phase modulation disabled for this operator */
-    {
-      op->phase += op->freq;
-    }
+    op->phase += phase_inc(chip, CH, op, LFO_PM);
   }
 
   /*  The Noise Generator of the YM3812 is 23-bit shift register.
@@ -723,9 +714,9 @@ static inline void advance(void)
   *  Simply use bit 22 as the noise output.
   */
 
-  ym2413.noise_p += ym2413.noise_f;
-  i = ym2413.noise_p >> FREQ_SH;    /* number of events (shifts of the shift register) */
-  ym2413.noise_p &= FREQ_MASK;
+  chip->noise_p += chip->noise_f;
+  i = chip->noise_p >> FREQ_SH;    /* number of events (shifts of the shift register) */
+  chip->noise_p &= FREQ_MASK;
   while (i)
   {
     /*
@@ -742,8 +733,8 @@ static inline void advance(void)
       what is real state of the noise_rng after the reset.
     */
 
-    if (ym2413.noise_rng & 1) ym2413.noise_rng ^= 0x800302;
-    ym2413.noise_rng >>= 1;
+    if (chip->noise_rng & 1) chip->noise_rng ^= 0x800302;
+    chip->noise_rng >>= 1;
 
     i--;
   }
@@ -771,7 +762,7 @@ static inline signed int op_calc1(uint32_t phase, unsigned int env, signed int p
 #define volume_calc(OP) (((OP)-> state != EG_OFF) ? (OP)->TLL + ((uint32_t)(OP)->volume) + (LFO_AM & (OP)->AMmask) : ENV_QUIET)
 
 /* calculate output */
-static inline void chan_calc( YM2413_OPLL_CH *CH )
+static inline void chan_calc( YM2413_OPLL_CH *CH, signed int *output, uint32_t LFO_AM )
 {
   YM2413_OPLL_SLOT *SLOT;
   unsigned int env;
@@ -842,7 +833,7 @@ number   number    BLK/FNUM2 FNUM    Drum  Hat   Drum  Tom  Cymbal
 
 /* calculate rhythm */
 
-static inline void rhythm_calc( YM2413_OPLL_CH *CH, unsigned int noise )
+static inline void rhythm_calc( YM2413_OPLL_CH *CH, unsigned int noise, signed int *output, uint32_t LFO_AM )
 {
   YM2413_OPLL_SLOT *SLOT;
   signed int out;
@@ -1074,7 +1065,7 @@ static int init_tables(void)
 }
 
 
-static void OPLL_initalize(void)
+static void OPLL_initalize(YM2413_OPLL *chip)
 {
   int i;
 
@@ -1085,21 +1076,21 @@ static void OPLL_initalize(void)
   for( i = 0 ; i < 1024; i++ )
   {
     /* OPLL (YM2413) phase increment counter = 18bit */
-    ym2413.fn_tab[i] = (uint32_t)( (double)i * 64 * freqbase * (1<<(FREQ_SH-10)) ); /* -10 because chip works with 10.10 fixed point, while we use 16.16 */
+    chip->fn_tab[i] = (uint32_t)( (double)i * 64 * freqbase * (1<<(FREQ_SH-10)) ); /* -10 because chip works with 10.10 fixed point, while we use 16.16 */
   }
 
   /* Amplitude modulation: 27 output levels (triangle waveform); 1 level takes one of: 192, 256 or 448 samples */
   /* One entry from LFO_AM_TABLE lasts for 64 samples */
-  ym2413.lfo_am_inc = (1.0 / 64.0 ) * (1<<LFO_SH) * freqbase;
+  chip->lfo_am_inc = (1.0 / 64.0 ) * (1<<LFO_SH) * freqbase;
 
   /* Vibrato: 8 output levels (triangle waveform); 1 level takes 1024 samples */
-  ym2413.lfo_pm_inc = (1.0 / 1024.0) * (1<<LFO_SH) * freqbase;
+  chip->lfo_pm_inc = (1.0 / 1024.0) * (1<<LFO_SH) * freqbase;
 
   /* Noise generator: a step takes 1 sample */
-  ym2413.noise_f = (1.0 / 1.0) * (1<<FREQ_SH) * freqbase;
+  chip->noise_f = (1.0 / 1.0) * (1<<FREQ_SH) * freqbase;
 
-  ym2413.eg_timer_add  = (1<<EG_SH) * freqbase;
-  ym2413.eg_timer_overflow = ( 1 ) * (1<<EG_SH);
+  chip->eg_timer_add  = (1<<EG_SH) * freqbase;
+  chip->eg_timer_overflow = ( 1 ) * (1<<EG_SH);
 }
 
 static inline void KEY_ON(YM2413_OPLL_SLOT *SLOT, uint32_t key_set)
@@ -1183,9 +1174,9 @@ static inline void CALC_FCSLOT(YM2413_OPLL_CH *CH,YM2413_OPLL_SLOT *SLOT)
 }
 
 /* set multi,am,vib,EG-TYP,KSR,mul */
-static inline void set_mul(int slot,int v)
+static inline void set_mul(YM2413_OPLL *chip, int slot,int v)
 {
-  YM2413_OPLL_CH   *CH   = &ym2413.P_CH[slot/2];
+  YM2413_OPLL_CH   *CH   = &chip->P_CH[slot/2];
   YM2413_OPLL_SLOT *SLOT = &CH->SLOT[slot&1];
 
   SLOT->mul     = mul_tab[v&0x0f];
@@ -1197,9 +1188,9 @@ static inline void set_mul(int slot,int v)
 }
 
 /* set ksl, tl */
-static inline void set_ksl_tl(int chan,int v)
+static inline void set_ksl_tl(YM2413_OPLL *chip, int chan,int v)
 {
-  YM2413_OPLL_CH   *CH   = &ym2413.P_CH[chan];
+  YM2413_OPLL_CH   *CH   = &chip->P_CH[chan];
   /* modulator */
   YM2413_OPLL_SLOT *SLOT = &CH->SLOT[SLOT1];
 
@@ -1211,9 +1202,9 @@ static inline void set_ksl_tl(int chan,int v)
 }
 
 /* set ksl , waveforms, feedback */
-static inline void set_ksl_wave_fb(int chan,int v)
+static inline void set_ksl_wave_fb(YM2413_OPLL *chip, int chan,int v)
 {
-  YM2413_OPLL_CH   *CH   = &ym2413.P_CH[chan];
+  YM2413_OPLL_CH   *CH   = &chip->P_CH[chan];
   /* modulator */
   YM2413_OPLL_SLOT *SLOT = &CH->SLOT[SLOT1];
   SLOT->wavetable = ((v&0x08)>>3)*SIN_LEN;
@@ -1228,9 +1219,9 @@ static inline void set_ksl_wave_fb(int chan,int v)
 }
 
 /* set attack rate & decay rate  */
-static inline void set_ar_dr(int slot,int v)
+static inline void set_ar_dr(YM2413_OPLL *chip, int slot,int v)
 {
-  YM2413_OPLL_CH   *CH   = &ym2413.P_CH[slot/2];
+  YM2413_OPLL_CH   *CH   = &chip->P_CH[slot/2];
   YM2413_OPLL_SLOT *SLOT = &CH->SLOT[slot&1];
 
   SLOT->ar = (v>>4)  ? 16 + ((v>>4)  <<2) : 0;
@@ -1262,9 +1253,9 @@ static inline void set_ar_dr(int slot,int v)
 }
 
 /* set sustain level & release rate */
-static inline void set_sl_rr(int slot,int v)
+static inline void set_sl_rr(YM2413_OPLL *chip, int slot,int v)
 {
-  YM2413_OPLL_CH   *CH   = &ym2413.P_CH[slot/2];
+  YM2413_OPLL_CH   *CH   = &chip->P_CH[slot/2];
   YM2413_OPLL_SLOT *SLOT = &CH->SLOT[slot&1];
 
   SLOT->sl  = sl_tab[ v>>4 ];
@@ -1274,25 +1265,25 @@ static inline void set_sl_rr(int slot,int v)
   SLOT->eg_sel_rr = eg_rate_select[SLOT->rr + SLOT->ksr ];
 }
 
-static void load_instrument(uint32_t chan, uint32_t slot, uint8_t* inst )
+static void load_instrument(YM2413_OPLL *chip, uint32_t chan, uint32_t slot, uint8_t* inst )
 {
-  set_mul(slot, inst[0]);
-  set_mul(slot+1, inst[1]);
-  set_ksl_tl(chan, inst[2]);
-  set_ksl_wave_fb(chan, inst[3]);
-  set_ar_dr(slot,   inst[4]);
-  set_ar_dr(slot+1, inst[5]);
-  set_sl_rr(slot,   inst[6]);
-  set_sl_rr(slot+1, inst[7]);
+  set_mul(chip, slot, inst[0]);
+  set_mul(chip, slot+1, inst[1]);
+  set_ksl_tl(chip, chan, inst[2]);
+  set_ksl_wave_fb(chip, chan, inst[3]);
+  set_ar_dr(chip, slot,   inst[4]);
+  set_ar_dr(chip, slot+1, inst[5]);
+  set_sl_rr(chip, slot,   inst[6]);
+  set_sl_rr(chip, slot+1, inst[7]);
 }
 
-static void update_instrument_zero(uint8_t r)
+static void update_instrument_zero(YM2413_OPLL *chip, uint8_t r)
 {
-  uint8_t* inst = &ym2413.inst_tab[0][0]; /* point to user instrument */
+  uint8_t* inst = &chip->inst_tab[0][0]; /* point to user instrument */
   uint32_t chan;
 
   uint32_t chan_max = 9;
-  if (ym2413.rhythm & 0x20)
+  if (chip->rhythm & 0x20)
     chan_max=6;
 
   switch(r&7)
@@ -1300,9 +1291,9 @@ static void update_instrument_zero(uint8_t r)
     case 0:
       for (chan=0; chan<chan_max; chan++)
       {
-        if ((ym2413.instvol_r[chan]&0xf0)==0)
+        if ((chip->instvol_r[chan]&0xf0)==0)
         {
-          set_mul(chan*2, inst[0]);
+          set_mul(chip, chan*2, inst[0]);
         }
       }
       break;
@@ -1310,9 +1301,9 @@ static void update_instrument_zero(uint8_t r)
     case 1:
       for (chan=0; chan<chan_max; chan++)
       {
-        if ((ym2413.instvol_r[chan]&0xf0)==0)
+        if ((chip->instvol_r[chan]&0xf0)==0)
         {
-          set_mul(chan*2+1, inst[1]);
+          set_mul(chip, chan*2+1, inst[1]);
         }
       }
       break;
@@ -1320,9 +1311,9 @@ static void update_instrument_zero(uint8_t r)
     case 2:
       for (chan=0; chan<chan_max; chan++)
       {
-        if ((ym2413.instvol_r[chan]&0xf0)==0)
+        if ((chip->instvol_r[chan]&0xf0)==0)
         {
-          set_ksl_tl(chan, inst[2]);
+          set_ksl_tl(chip, chan, inst[2]);
         }
       }
       break;
@@ -1330,9 +1321,9 @@ static void update_instrument_zero(uint8_t r)
     case 3:
       for (chan=0; chan<chan_max; chan++)
       {
-        if ((ym2413.instvol_r[chan]&0xf0)==0)
+        if ((chip->instvol_r[chan]&0xf0)==0)
         {
-          set_ksl_wave_fb(chan, inst[3]);
+          set_ksl_wave_fb(chip, chan, inst[3]);
         }
       }
       break;
@@ -1340,9 +1331,9 @@ static void update_instrument_zero(uint8_t r)
     case 4:
       for (chan=0; chan<chan_max; chan++)
       {
-        if ((ym2413.instvol_r[chan]&0xf0)==0)
+        if ((chip->instvol_r[chan]&0xf0)==0)
         {
-          set_ar_dr(chan*2, inst[4]);
+          set_ar_dr(chip, chan*2, inst[4]);
         }
       }
       break;
@@ -1350,9 +1341,9 @@ static void update_instrument_zero(uint8_t r)
     case 5:
       for (chan=0; chan<chan_max; chan++)
       {
-        if ((ym2413.instvol_r[chan]&0xf0)==0)
+        if ((chip->instvol_r[chan]&0xf0)==0)
         {
-          set_ar_dr(chan*2+1, inst[5]);
+          set_ar_dr(chip, chan*2+1, inst[5]);
         }
       }
       break;
@@ -1360,9 +1351,9 @@ static void update_instrument_zero(uint8_t r)
     case 6:
       for (chan=0; chan<chan_max; chan++)
       {
-        if ((ym2413.instvol_r[chan]&0xf0)==0)
+        if ((chip->instvol_r[chan]&0xf0)==0)
         {
-          set_sl_rr(chan*2, inst[6]);
+          set_sl_rr(chip, chan*2, inst[6]);
         }
       }
       break;
@@ -1370,9 +1361,9 @@ static void update_instrument_zero(uint8_t r)
     case 7:
       for (chan=0; chan<chan_max; chan++)
       {
-        if ((ym2413.instvol_r[chan]&0xf0)==0)
+        if ((chip->instvol_r[chan]&0xf0)==0)
         {
-          set_sl_rr(chan*2+1, inst[7]);
+          set_sl_rr(chip, chan*2+1, inst[7]);
         }
       }
       break;
@@ -1380,7 +1371,7 @@ static void update_instrument_zero(uint8_t r)
 }
 
 /* write a value v to register r on chip chip */
-static void OPLLWriteReg(int r, int v)
+static void OPLLWriteReg(YM2413_OPLL *chip, int r, int v)
 {
   YM2413_OPLL_CH *CH;
   YM2413_OPLL_SLOT *SLOT;
@@ -1404,8 +1395,8 @@ static void OPLLWriteReg(int r, int v)
         case 0x06:  /* Sustain, Release (modulator) */
         case 0x07:  /* Sustain, Release (carrier) */
         {
-          ym2413.inst_tab[0][r] = v;
-          update_instrument_zero(r);
+          chip->inst_tab[0][r] = v;
+          update_instrument_zero(chip, r);
           break;
         }
 
@@ -1414,89 +1405,89 @@ static void OPLLWriteReg(int r, int v)
           if(v&0x20)
           {
             /* rhythm OFF to ON */
-            if ((ym2413.rhythm&0x20)==0)
+            if ((chip->rhythm&0x20)==0)
             {
               /* Load instrument settings for channel seven(chan=6 since we're zero based). (Bass drum) */
-              load_instrument(6, 12, &ym2413.inst_tab[16][0]);
+              load_instrument(chip, 6, 12, &chip->inst_tab[16][0]);
 
               /* Load instrument settings for channel eight. (High hat and snare drum) */
-              load_instrument(7, 14, &ym2413.inst_tab[17][0]);
+              load_instrument(chip, 7, 14, &chip->inst_tab[17][0]);
 
-              CH   = &ym2413.P_CH[7];
+              CH   = &chip->P_CH[7];
               SLOT = &CH->SLOT[SLOT1]; /* modulator envelope is HH */
-              SLOT->TL  = ((ym2413.instvol_r[7]>>4)<<2)<<(ENV_BITS-2-7); /* 7 bits TL (bit 6 = always 0) */
+              SLOT->TL  = ((chip->instvol_r[7]>>4)<<2)<<(ENV_BITS-2-7); /* 7 bits TL (bit 6 = always 0) */
               SLOT->TLL = SLOT->TL + (CH->ksl_base>>SLOT->ksl);
 
               /* Load instrument settings for channel nine. (Tom-tom and top cymbal) */
-              load_instrument(8, 16, &ym2413.inst_tab[18][0]);
+              load_instrument(chip, 8, 16, &chip->inst_tab[18][0]);
 
-              CH   = &ym2413.P_CH[8];
+              CH   = &chip->P_CH[8];
               SLOT = &CH->SLOT[SLOT1]; /* modulator envelope is TOM */
-              SLOT->TL  = ((ym2413.instvol_r[8]>>4)<<2)<<(ENV_BITS-2-7); /* 7 bits TL (bit 6 = always 0) */
+              SLOT->TL  = ((chip->instvol_r[8]>>4)<<2)<<(ENV_BITS-2-7); /* 7 bits TL (bit 6 = always 0) */
               SLOT->TLL = SLOT->TL + (CH->ksl_base>>SLOT->ksl);
             }
 
             /* BD key on/off */
             if(v&0x10)
             {
-              KEY_ON (&ym2413.P_CH[6].SLOT[SLOT1], 2);
-              KEY_ON (&ym2413.P_CH[6].SLOT[SLOT2], 2);
+              KEY_ON (&chip->P_CH[6].SLOT[SLOT1], 2);
+              KEY_ON (&chip->P_CH[6].SLOT[SLOT2], 2);
             }
             else
             {
-              KEY_OFF(&ym2413.P_CH[6].SLOT[SLOT1],~2);
-              KEY_OFF(&ym2413.P_CH[6].SLOT[SLOT2],~2);
+              KEY_OFF(&chip->P_CH[6].SLOT[SLOT1],~2);
+              KEY_OFF(&chip->P_CH[6].SLOT[SLOT2],~2);
             }
 
             /* HH key on/off */
-            if(v&0x01) KEY_ON (&ym2413.P_CH[7].SLOT[SLOT1], 2);
-            else       KEY_OFF(&ym2413.P_CH[7].SLOT[SLOT1],~2);
+            if(v&0x01) KEY_ON (&chip->P_CH[7].SLOT[SLOT1], 2);
+            else       KEY_OFF(&chip->P_CH[7].SLOT[SLOT1],~2);
 
             /* SD key on/off */
-            if(v&0x08) KEY_ON (&ym2413.P_CH[7].SLOT[SLOT2], 2);
-            else       KEY_OFF(&ym2413.P_CH[7].SLOT[SLOT2],~2);
+            if(v&0x08) KEY_ON (&chip->P_CH[7].SLOT[SLOT2], 2);
+            else       KEY_OFF(&chip->P_CH[7].SLOT[SLOT2],~2);
 
             /* TOM key on/off */
-            if(v&0x04) KEY_ON (&ym2413.P_CH[8].SLOT[SLOT1], 2);
-            else       KEY_OFF(&ym2413.P_CH[8].SLOT[SLOT1],~2);
+            if(v&0x04) KEY_ON (&chip->P_CH[8].SLOT[SLOT1], 2);
+            else       KEY_OFF(&chip->P_CH[8].SLOT[SLOT1],~2);
 
             /* TOP-CY key on/off */
-            if(v&0x02) KEY_ON (&ym2413.P_CH[8].SLOT[SLOT2], 2);
-            else       KEY_OFF(&ym2413.P_CH[8].SLOT[SLOT2],~2);
+            if(v&0x02) KEY_ON (&chip->P_CH[8].SLOT[SLOT2], 2);
+            else       KEY_OFF(&chip->P_CH[8].SLOT[SLOT2],~2);
           }
           else
           {
             /* rhythm ON to OFF */
-            if (ym2413.rhythm&0x20)
+            if (chip->rhythm&0x20)
             {
               /* Load instrument settings for channel seven(chan=6 since we're zero based).*/
-              load_instrument(6, 12, &ym2413.inst_tab[ym2413.instvol_r[6]>>4][0]);
+              load_instrument(chip, 6, 12, &chip->inst_tab[chip->instvol_r[6]>>4][0]);
 
               /* Load instrument settings for channel eight.*/
-              load_instrument(7, 14, &ym2413.inst_tab[ym2413.instvol_r[7]>>4][0]);
+              load_instrument(chip, 7, 14, &chip->inst_tab[chip->instvol_r[7]>>4][0]);
 
               /* Load instrument settings for channel nine.*/
-              load_instrument(8, 16, &ym2413.inst_tab[ym2413.instvol_r[8]>>4][0]);
+              load_instrument(chip, 8, 16, &chip->inst_tab[chip->instvol_r[8]>>4][0]);
             }
 
             /* BD key off */
-            KEY_OFF(&ym2413.P_CH[6].SLOT[SLOT1],~2);
-            KEY_OFF(&ym2413.P_CH[6].SLOT[SLOT2],~2);
+            KEY_OFF(&chip->P_CH[6].SLOT[SLOT1],~2);
+            KEY_OFF(&chip->P_CH[6].SLOT[SLOT2],~2);
 
             /* HH key off */
-            KEY_OFF(&ym2413.P_CH[7].SLOT[SLOT1],~2);
+            KEY_OFF(&chip->P_CH[7].SLOT[SLOT1],~2);
 
             /* SD key off */
-            KEY_OFF(&ym2413.P_CH[7].SLOT[SLOT2],~2);
+            KEY_OFF(&chip->P_CH[7].SLOT[SLOT2],~2);
 
             /* TOM key off */
-            KEY_OFF(&ym2413.P_CH[8].SLOT[SLOT1],~2);
+            KEY_OFF(&chip->P_CH[8].SLOT[SLOT1],~2);
 
             /* TOP-CY off */
-            KEY_OFF(&ym2413.P_CH[8].SLOT[SLOT2],~2);
+            KEY_OFF(&chip->P_CH[8].SLOT[SLOT2],~2);
           }
 
-          ym2413.rhythm = v&0x3f;
+          chip->rhythm = v&0x3f;
           break;
         }
       }
@@ -1514,7 +1505,7 @@ static void OPLLWriteReg(int r, int v)
       if (chan >= 9)
         chan -= 9;  /* verified on real YM2413 */
 
-      CH = &ym2413.P_CH[chan];
+      CH = &chip->P_CH[chan];
 
       if(r&0x10)
       {
@@ -1553,7 +1544,7 @@ static void OPLLWriteReg(int r, int v)
 
         block_fnum   = block_fnum * 2;
         block        = (block_fnum&0x1c00) >> 10;
-        CH->fc       = ym2413.fn_tab[block_fnum&0x03ff] >> (7-block);
+        CH->fc       = chip->fn_tab[block_fnum&0x03ff] >> (7-block);
 
         /* refresh Total Level in both SLOTs of this channel */
         CH->SLOT[SLOT1].TLL = CH->SLOT[SLOT1].TL + (CH->ksl_base>>CH->SLOT[SLOT1].ksl);
@@ -1574,13 +1565,13 @@ static void OPLLWriteReg(int r, int v)
       if (chan >= 9)
         chan -= 9;  /* verified on real YM2413 */
 
-      CH   = &ym2413.P_CH[chan];
+      CH   = &chip->P_CH[chan];
       SLOT = &CH->SLOT[SLOT2]; /* carrier */
       SLOT->TL  = ((v&0x0f)<<2)<<(ENV_BITS-2-7); /* 7 bits TL (bit 6 = always 0) */
       SLOT->TLL = SLOT->TL + (CH->ksl_base>>SLOT->ksl);
 
       /*check wether we are in rhythm mode and handle instrument/volume register accordingly*/
-      if ((chan>=6) && (ym2413.rhythm&0x20))
+      if ((chan>=6) && (chip->rhythm&0x20))
       {
         /* we're in rhythm mode*/
 
@@ -1593,10 +1584,10 @@ static void OPLLWriteReg(int r, int v)
       }
       else
       {
-        if ((ym2413.instvol_r[chan]&0xf0) != (v&0xf0))
+        if ((chip->instvol_r[chan]&0xf0) != (v&0xf0))
         {
-          ym2413.instvol_r[chan] = v;  /* store for later use */
-          load_instrument(chan, chan * 2, &ym2413.inst_tab[v>>4][0]);
+          chip->instvol_r[chan] = v;  /* store for later use */
+          load_instrument(chip, chan, chan * 2, &chip->inst_tab[v>>4][0]);
         }
       }
 
@@ -1609,26 +1600,29 @@ static void OPLLWriteReg(int r, int v)
 }
 
 
-void YM2413Init(void)
+void YM2413InitTables(void)
 {
   init_tables();
+}
 
+void YM2413Init(YM2413_OPLL *chip)
+{
   /* clear */
-  memset(&ym2413,0,sizeof(YM2413_Chip));
+  memset(chip,0,sizeof(YM2413_OPLL));
 
-  /* init global tables */
-  OPLL_initalize();
+  /* init chip tables */
+  OPLL_initalize(chip);
 }
 
-void YM2413ResetChip(void)
+void YM2413ResetChip(YM2413_OPLL *chip)
 {
   int c,s;
   int i;
 
-  ym2413.eg_timer = 0;
-  ym2413.eg_cnt   = 0;
+  chip->eg_timer = 0;
+  chip->eg_cnt   = 0;
 
-  ym2413.noise_rng = 1;  /* noise shift register */
+  chip->noise_rng = 1;  /* noise shift register */
 
 
   /* setup instruments table */
@@ -1636,19 +1630,19 @@ void YM2413ResetChip(void)
   {
     for (c=0; c<8; c++)
     {
-      ym2413.inst_tab[i][c] = table[i][c];
+      chip->inst_tab[i][c] = table[i][c];
     }
   }
 
 
   /* reset with register write */
-  OPLLWriteReg(0x0f,0); /*test reg*/
-  for(i = 0x3f ; i >= 0x10 ; i-- ) OPLLWriteReg(i,0x00);
+  OPLLWriteReg(chip, 0x0f,0); /*test reg*/
+  for(i = 0x3f ; i >= 0x10 ; i-- ) OPLLWriteReg(chip, i,0x00);
 
   /* reset operator parameters */
   for( c = 0 ; c < 9 ; c++ )
   {
-    YM2413_OPLL_CH *CH = &ym2413.P_CH[c];
+    YM2413_OPLL_CH *CH = &chip->P_CH[c];
     for(s = 0 ; s < 2 ; s++ )
     {
       /* wave table */
@@ -1661,76 +1655,263 @@ void YM2413ResetChip(void)
 
 /* YM2413 I/O interface */
 
-void YM2413Write(unsigned int a, unsigned int v)
+void YM2413Write(YM2413_OPLL *chip, unsigned int a, unsigned int v)
 {
   if( !(a&2) )
   {
     if( !(a&1) )
     {
       /* address port */
-      ym2413.address = v & 0xff;
+      chip->address = v & 0xff;
     }
     else
     {
       /* data port */
-      OPLLWriteReg(ym2413.address,v);
+      OPLLWriteReg(chip, chip->address,v);
     }
   }
   else
   {
     /* bit 0 enable/disable FM output (Master System / Mark-III FM adapter specific) */
-    ym2413.status = v & 0x01;
+    chip->status = v & 0x01;
   }
 }
 
-unsigned int YM2413Read(void)
+unsigned int YM2413Read(YM2413_OPLL *chip)
 {
   /* bit 0 returns latched FM enable status, bits 1-2 return zero (Master System / Mark-III FM adapter specific) */
-  return 0xF8 | ym2413.status;
+  return 0xF8 | chip->status;
 }
 
-int YM2413Update(void)
+/* render one sample at the native rate (clock / 72) */
+static inline int render_sample(YM2413_OPLL *chip, int rhythm)
 {
   int out;
+  signed int output[2];
+  uint32_t LFO_AM;
+  int32_t LFO_PM;
 
   output[0] = 0;
   output[1] = 0;
 
-  advance_lfo();
+  advance_lfo(chip, &LFO_AM, &LFO_PM);
 
   /* FM part */
-  chan_calc(&ym2413.P_CH[0]);
-  chan_calc(&ym2413.P_CH[1]);
-  chan_calc(&ym2413.P_CH[2]);
-  chan_calc(&ym2413.P_CH[3]);
-  chan_calc(&ym2413.P_CH[4]);
-  chan_calc(&ym2413.P_CH[5]);
-
-  if(!(ym2413.rhythm&0x20))
+  chan_calc(&chip->P_CH[0], output, LFO_AM);
+  chan_calc(&chip->P_CH[1], output, LFO_AM);
+  chan_calc(&chip->P_CH[2], output, LFO_AM);
+  chan_calc(&chip->P_CH[3], output, LFO_AM);
+  chan_calc(&chip->P_CH[4], output, LFO_AM);
+  chan_calc(&chip->P_CH[5], output, LFO_AM);
+
+  if(!rhythm)
   {
-    chan_calc(&ym2413.P_CH[6]);
-    chan_calc(&ym2413.P_CH[7]);
-    chan_calc(&ym2413.P_CH[8]);
+    chan_calc(&chip->P_CH[6], output, LFO_AM);
+    chan_calc(&chip->P_CH[7], output, LFO_AM);
+    chan_calc(&chip->P_CH[8], output, LFO_AM);
   }
   else    /* Rhythm part */
   {
-    rhythm_calc(&ym2413.P_CH[0], (ym2413.noise_rng>>0)&1 );
+    rhythm_calc(&chip->P_CH[0], (chip->noise_rng>>0)&1, output, LFO_AM );
   }
 
   /* Melody (MO) & Rythm (RO) outputs mixing & amplification (latched bit controls FM output) */
-  out = (output[0] + (output[1] * 2)) * 2 * ym2413.status;
+  out = (output[0] + (output[1] * 2)) * 2 * chip->status;
+
+  advance(chip, LFO_PM);
 
-  advance();
-  
   return out;
 }
 
-unsigned char *YM2413GetContextPtr(void)
+int YM2413Update(YM2413_OPLL *chip)
+{
+  return render_sample(chip, chip->rhythm & 0x20);
+}
+
+/* true when every carrier is off, so the melody channels can't reach the output */
+/* (modulators of melody channels keep their level while releasing, see advance) */
+static int is_muted(YM2413_OPLL *chip)
 {
-  return (unsigned char *)&ym2413;
+  int c;
+
+  if (chip->rhythm & 0x20)
+    return 0;
+
+  for (c = 0; c < 9; c++)
+  {
+    YM2413_OPLL_CH *CH = &chip->P_CH[c];
+
+    if (CH->SLOT[SLOT2].state != EG_OFF)
+      return 0;
+
+    if ((CH->SLOT[SLOT1].state != EG_OFF) && (CH->SLOT[SLOT1].state != EG_REL))
+      return 0;
+  }
+
+  return 1;
+}
+
+/* true when the modulators are off too and their feedback has drained */
+static int is_idle(YM2413_OPLL *chip)
+{
+  int c;
+
+  for (c = 0; c < 9; c++)
+  {
+    YM2413_OPLL_SLOT *SLOT = &chip->P_CH[c].SLOT[SLOT1];
+
+    if ((SLOT->state != EG_OFF) || SLOT->op1_out[0] || SLOT->op1_out[1])
+      return 0;
+  }
+
+  return 1;
 }
 
-unsigned int YM2413GetContextSize(void)
+/* same as render_sample() without output: only the modulator feedback is computed */
+/* (in rhythm mode only the bass drum modulator keeps feedback state) */
+static inline void render_muted_sample(YM2413_OPLL *chip, int rhythm)
 {
-  return sizeof(YM2413_Chip);
-}
\ No newline at end of file
+  uint32_t LFO_AM;
+  int32_t LFO_PM;
+  int c;
+  int channels = rhythm ? 7 : 9;
+
+  advance_lfo(chip, &LFO_AM, &LFO_PM);
+
+  for (c = 0; c < channels; c++)
+  {
+    YM2413_OPLL_SLOT *SLOT = &chip->P_CH[c].SLOT[SLOT1];
+    unsigned int env = volume_calc(SLOT);
+    signed int out = SLOT->op1_out[0] + SLOT->op1_out[1];
+
+    SLOT->op1_out[0] = SLOT->op1_out[1];
+    SLOT->op1_out[1] = 0;
+
+    if( env < ENV_QUIET )
+    {
+      if (!SLOT->fb_shift)
+        out = 0;
+      SLOT->op1_out[1] = op_calc1(SLOT->phase, env, (out<<SLOT->fb_shift), SLOT->wavetable );
+    }
+  }
+
+  advance(chip, LFO_PM);
+}
+
+/* advance the free running counters as render_sample() would for 'count' silent samples */
+static void skip_silence(YM2413_OPLL *chip, int count)
+{
+  uint64_t total;
+  uint32_t ticks;
+  uint32_t lfo_pm_cnt = chip->lfo_pm_cnt;
+  int i, j;
+
+  /* LFO AM wraps at the end of the table, LFO PM is free running */
+  total = (uint64_t)chip->lfo_am_cnt + ((uint64_t)chip->lfo_am_inc * count);
+  chip->lfo_am_cnt = (uint32_t)(total % (uint64_t)(LFO_AM_TAB_ELEMENTS<<LFO_SH));
+  chip->lfo_pm_cnt += chip->lfo_pm_inc * count;
+
+  /* Envelope Generator: operators in EG_OFF only get their attenuation reset */
+  total = (uint64_t)chip->eg_timer + ((uint64_t)chip->eg_timer_add * count);
+  ticks = (uint32_t)(total / chip->eg_timer_overflow);
+  chip->eg_timer = (uint32_t)(total % chip->eg_timer_overflow);
+  chip->eg_cnt += ticks;
+
+  /* Phase Generator */
+  for (i=0; i<9*2; i++)
+  {
+    YM2413_OPLL_CH *CH = &chip->P_CH[i/2];
+    YM2413_OPLL_SLOT *op = &CH->SLOT[i&1];
+
+    if (ticks)
+      op->volume = MAX_ATT_INDEX;
+
+    if (op->vib)
+    {
+      uint32_t pm_cnt = lfo_pm_cnt;
+
+      for (j = 0; j < count; j++)
+      {
+        pm_cnt += chip->lfo_pm_inc;
+        op->phase += phase_inc(chip, CH, op, (pm_cnt>>LFO_SH) & 7);
+      }
+    }
+    else
+    {
+      op->phase += op->freq * count;
+    }
+  }
+
+  /* Noise Generator */
+  chip->noise_p += chip->noise_f * count;
+  i = chip->noise_p >> FREQ_SH;
+  chip->noise_p &= FREQ_MASK;
+  while (i)
+  {
+    if (chip->noise_rng & 1) chip->noise_rng ^= 0x800302;
+    chip->noise_rng >>= 1;
+    i--;
+  }
+}
+
+int YM2413UpdateBlock(YM2413_OPLL *chip, int *buffer, int count)
+{
+  int i;
+
+  if (is_muted(chip))
+  {
+    if (is_idle(chip))
+    {
+      skip_silence(chip, count);
+    }
+    else
+    {
+      for (i = 0; i < count; i++)
+        render_muted_sample(chip, 0);
+    }
+
+    memset(buffer, 0, sizeof(int) * count);
+    return 1;
+  }
+
+  /* no register can be written in the middle of a block, so the rhythm mode */
+  /* is fixed and each loop gets its own specialized copy of the channel code */
+  if (chip->rhythm & 0x20)
+  {
+    for (i = 0; i < count; i++)
+      buffer[i] = render_sample(chip, 0x20);
+  }
+  else
+  {
+    for (i = 0; i < count; i++)
+      buffer[i] = render_sample(chip, 0);
+  }
+
+  return 0;
+}
+
+int YM2413SkipBlock(YM2413_OPLL *chip, int count)
+{
+  int i;
+  int rhythm = chip->rhythm & 0x20;
+
+  if (is_muted(chip))
+  {
+    if (is_idle(chip))
+      skip_silence(chip, count);
+    else
+    {
+      for (i = 0; i < count; i++)
+        render_muted_sample(chip, 0);
+    }
+
+    return 0;
+  }
+
+  /* carriers and rhythm outputs carry no state, so they are only computed */
+  /* for the last sample, which the caller keeps as the current level */
+  for (i = 0; i < count - 1; i++)
+    render_muted_sample(chip, rhythm);
+
+  return render_sample(chip, rhythm);
+}
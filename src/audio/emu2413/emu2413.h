@@ -86,13 +86,18 @@ typedef struct {
 extern "C" {
 #endif
 
-extern void YM2413Init(void);
-extern void YM2413ResetChip(void);
-extern int YM2413Update(void);
-extern void YM2413Write(unsigned int a, unsigned int v);
-extern unsigned int YM2413Read(void);
-extern unsigned char *YM2413GetContextPtr(void);
-extern unsigned int YM2413GetContextSize(void);
+/* shared read-only tables, must be initialized once before any chip is used */
+extern void YM2413InitTables(void);
+
+extern void YM2413Init(YM2413_OPLL *chip);
+extern void YM2413ResetChip(YM2413_OPLL *chip);
+extern int YM2413Update(YM2413_OPLL *chip);
+/* returns 1 when the block was silent and the buffer was zero filled */
+extern int YM2413UpdateBlock(YM2413_OPLL *chip, int *buffer, int count);
+/* advances the chip exactly as YM2413UpdateBlock would, returns only the last sample */
+extern int YM2413SkipBlock(YM2413_OPLL *chip, int count);
+extern void YM2413Write(YM2413_OPLL *chip, unsigned int a, unsigned int v);
+extern unsigned int YM2413Read(YM2413_OPLL *chip);
 
 #ifdef __cplusplus
 }
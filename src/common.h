@@ -26,11 +26,13 @@
 #include <time.h>
 #if defined(_WIN32)
 #include <direct.h>
+#include <io.h>
 #include <windows.h>
 #else
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <errno.h>
+#include <unistd.h>
 #endif
 #include "definitions.h"
 #include "log.h"
@@ -330,6 +332,28 @@ inline FILE* fopen_utf8(const char* path, const char* mode)
     std::wstring wmode = utf8_to_wstring(mode);
     return _wfopen(wpath.c_str(), wmode.c_str());
 }
+
+inline bool rename_utf8(const char* from, const char* to)
+{
+    std::wstring wfrom = utf8_to_wstring(from);
+    std::wstring wto = utf8_to_wstring(to);
+    return MoveFileExW(wfrom.c_str(), wto.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+inline bool remove_utf8(const char* path)
+{
+    std::wstring wpath = utf8_to_wstring(path);
+    return _wremove(wpath.c_str()) == 0;
+}
+
+inline bool sync_file(FILE* file)
+{
+    if (fflush(file) != 0)
+        return false;
+
+    HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(file)));
+    return (handle != INVALID_HANDLE_VALUE) && (FlushFileBuffers(handle) != 0);
+}
 #else
 #define open_ifstream_utf8(stream, path, mode) \
     stream.open(path, mode)
@@ -341,6 +365,24 @@ inline FILE* fopen_utf8(const char* path, const char* mode)
 {
     return fopen(path, mode);
 }
+
+inline bool rename_utf8(const char* from, const char* to)
+{
+    return rename(from, to) == 0;
+}
+
+inline bool remove_utf8(const char* path)
+{
+    return remove(path) == 0;
+}
+
+inline bool sync_file(FILE* file)
+{
+    if (fflush(file) != 0)
+        return false;
+
+    return fsync(fileno(file)) == 0;
+}
 #endif
 
 inline bool extract_zip_to_folder(const char* zip_path, const char* out_folder)
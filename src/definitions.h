@@ -145,14 +145,21 @@ typedef void (*RamChangedCallback) (void);
 #define GS_FRAMES_PER_SECOND_PAL 50
 
 #define GS_AUDIO_SAMPLE_RATE 44100
+#define GS_AUDIO_SAMPLE_RATE_MIN 22050
+#define GS_AUDIO_SAMPLE_RATE_MAX 48000
 #define GS_AUDIO_BUFFER_SIZE 2048
 #define GS_AUDIO_BUFFER_SIZE_V1 4096
 #define GS_AUDIO_QUEUE_SIZE 1792
+#define GS_AUDIO_GAIN_SHIFT 12
 
 #define GS_SAVESTATE_MAGIC 0x03121220
+#define GS_SAVESTATE_MAGIC_COMPACT 0x03121221
 #define GS_SAVESTATE_VERSION 106
 #define GS_SAVESTATE_MIN_VERSION 100
 #define GS_SAVESTATE_VERSION_V1 1
+#define GS_SAVESTATE_FILE_MAGIC 0x32535347
+#define GS_SAVESTATE_FILE_VERSION 2
+#define GS_SAVESTATE_THUMBNAIL_SCALE 2
 
 enum GS_Color_Format
 {
@@ -226,6 +233,36 @@ struct GS_SaveState_Header
     char emu_build[32];
 };
 
+// Savestate files start with this header, followed by a compressed
+// thumbnail and the compressed state, so browsing slots only reads the
+// first few hundred bytes of each file
+struct GS_SaveState_File_Header
+{
+    u32 magic;
+    u32 version;
+    u32 state_version;
+    u32 rom_crc;
+    s64 timestamp;
+    u32 thumbnail_offset;
+    u32 thumbnail_size;
+    u32 thumbnail_packed_size;
+    u16 thumbnail_width;
+    u16 thumbnail_height;
+    u32 state_offset;
+    u32 state_size;
+    u32 state_packed_size;
+    char rom_name[128];
+    char emu_build[32];
+};
+
+// A savestate copied out of the core, waiting to be compressed and written
+struct GS_SaveState_Capture
+{
+    GS_SaveState_File_Header header;
+    u8* state;
+    u8* thumbnail;
+};
+
 struct GS_SaveState_Header_Libretro
 {
     u32 magic;
@@ -240,6 +277,44 @@ struct GS_SaveState_Screenshot
     u8* data;
 };
 
+enum GS_State_Section
+{
+    GS_State_Section_Memory = 0,
+    GS_State_Section_RAM,
+    GS_State_Section_CPU,
+    GS_State_Section_Audio,
+    GS_State_Section_YM2413,
+    GS_State_Section_PSG,
+    GS_State_Section_VDP,
+    GS_State_Section_VRAM,
+    GS_State_Section_CRAM,
+    GS_State_Section_VDP_Registers,
+    GS_State_Section_Input,
+    GS_State_Section_Mapper,
+    GS_State_Section_Bootrom,
+    GS_State_Section_IO,
+    GS_State_Section_Footer,
+    GS_State_Section_Count
+};
+
+#define GS_STATE_MAX_RANGES 32
+
+struct GS_State_Range
+{
+    u32 section;
+    u32 offset;
+    u32 size;
+};
+
+// Where each section lives inside a savestate buffer. A section can be
+// split in several ranges when a component writes it in more than one run.
+struct GS_State_Layout
+{
+    u32 size;
+    u32 count;
+    GS_State_Range ranges[GS_STATE_MAX_RANGES];
+};
+
 struct GS_Disassembler_Record
 {
     u32 address;
@@ -302,6 +377,14 @@ inline int AsHex(const char c)
     #define GS_LITTLE_ENDIAN
 #endif
 
+#if !defined(GS_DISABLE_SIMD)
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+        #define GS_SSE2
+    #elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+        #define GS_NEON
+    #endif
+#endif
+
 #if defined(__GNUC__) || defined(__clang__)
     #define INLINE inline __attribute__((always_inline))
     #define NO_INLINE __attribute__((noinline))
@@ -29,6 +29,7 @@
 #include "Cartridge.h"
 #include "Audio.h"
 #include "Video.h"
+#include "Scaler.h"
 #include "SixteenBitRegister.h"
 #include "MemoryRule.h"
 #include "TraceLogger.h"
@@ -0,0 +1,291 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef STATE_SERIALIZER_H
+#define STATE_SERIALIZER_H
+
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+
+// A contiguous run of bytes written while a section was active
+struct state_range
+{
+    int section;
+    size_t offset;
+    size_t size;
+};
+
+// Savestate fields are copied straight into a caller provided buffer.
+// Without a buffer the writer only counts bytes, which is how the size of
+// a savestate is queried.
+// Compact savestates leave out everything that is rebuilt on load (ROM
+// slots, render scratch buffers, audio output buffers), so their size only
+// depends on the loaded ROM.
+// Components mark where each section starts. The writer can record those
+// as byte ranges and keep a running 64-bit hash per section, which works
+// without a buffer too.
+class state_writer
+{
+public:
+    state_writer()
+    {
+        m_pBuffer = NULL;
+        m_Capacity = 0;
+        m_Size = 0;
+        m_bOverflow = false;
+        m_bCompact = false;
+        Init();
+    }
+
+    state_writer(char* buffer, size_t capacity, bool compact = false)
+    {
+        m_pBuffer = buffer;
+        m_Capacity = capacity;
+        m_Size = 0;
+        m_bOverflow = false;
+        m_bCompact = compact;
+        Init();
+    }
+
+    void write(const char* data, size_t size)
+    {
+        if (m_pBuffer != NULL)
+        {
+            if ((m_Size + size) <= m_Capacity)
+                std::memcpy(m_pBuffer + m_Size, data, size);
+            else
+                m_bOverflow = true;
+        }
+
+        if ((m_pHashes != NULL) && (m_Section >= 0) && (m_Section < m_HashCount))
+            m_pHashes[m_Section] = hash(m_pHashes[m_Section], data, size);
+
+        m_Size += size;
+    }
+
+    void section(int id)
+    {
+        if (id == m_Section)
+            return;
+
+        end_section();
+        m_Section = id;
+
+        if (m_pRanges != NULL)
+        {
+            if (m_RangeCount < m_MaxRanges)
+            {
+                m_pRanges[m_RangeCount].section = id;
+                m_pRanges[m_RangeCount].offset = m_Size;
+                m_pRanges[m_RangeCount].size = 0;
+                m_RangeCount++;
+            }
+            else
+                m_bRangesOverflow = true;
+        }
+    }
+
+    void end_section()
+    {
+        if ((m_Section >= 0) && (m_pRanges != NULL) && (m_RangeCount > 0))
+        {
+            state_range& range = m_pRanges[m_RangeCount - 1];
+            if (range.section == m_Section)
+                range.size = m_Size - range.offset;
+        }
+
+        m_Section = -1;
+    }
+
+    void set_ranges(state_range* ranges, int max_ranges)
+    {
+        m_pRanges = ranges;
+        m_MaxRanges = max_ranges;
+        m_RangeCount = 0;
+        m_bRangesOverflow = false;
+    }
+
+    int range_count() const
+    {
+        return m_RangeCount;
+    }
+
+    // True when more sections started than set_ranges() had room for
+    bool ranges_overflow() const
+    {
+        return m_bRangesOverflow;
+    }
+
+    // Every hash must be seeded by the caller, usually with hash_seed()
+    void set_hashes(uint64_t* hashes, int count)
+    {
+        m_pHashes = hashes;
+        m_HashCount = count;
+    }
+
+    static uint64_t hash_seed()
+    {
+        return 0xCBF29CE484222325ULL;
+    }
+
+    // FNV-1a over 64-bit words, with the tail hashed byte by byte
+    static uint64_t hash(uint64_t h, const char* data, size_t size)
+    {
+        const uint64_t prime = 0x100000001B3ULL;
+
+        while (size >= 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, data, 8);
+            h = (h ^ word) * prime;
+            data += 8;
+            size -= 8;
+        }
+
+        while (size > 0)
+        {
+            h = (h ^ static_cast<unsigned char>(*data)) * prime;
+            data++;
+            size--;
+        }
+
+        return h;
+    }
+
+    size_t size() const
+    {
+        return m_Size;
+    }
+
+    bool good() const
+    {
+        return !m_bOverflow;
+    }
+
+    bool compact() const
+    {
+        return m_bCompact;
+    }
+
+private:
+    void Init()
+    {
+        m_Section = -1;
+        m_pRanges = NULL;
+        m_MaxRanges = 0;
+        m_RangeCount = 0;
+        m_bRangesOverflow = false;
+        m_pHashes = NULL;
+        m_HashCount = 0;
+    }
+
+private:
+    char* m_pBuffer;
+    size_t m_Capacity;
+    size_t m_Size;
+    bool m_bOverflow;
+    bool m_bCompact;
+    int m_Section;
+    state_range* m_pRanges;
+    int m_MaxRanges;
+    int m_RangeCount;
+    bool m_bRangesOverflow;
+    uint64_t* m_pHashes;
+    int m_HashCount;
+};
+
+// Reads past the end leave the destination untouched and mark the reader
+// as failed, like an exhausted std::istream
+class state_reader
+{
+public:
+    state_reader(const char* buffer, size_t size)
+    {
+        m_pBuffer = buffer;
+        m_Size = size;
+        m_Position = 0;
+        m_bFailed = false;
+        m_bCompact = false;
+    }
+
+    void read(char* data, size_t size)
+    {
+        if (m_bFailed || (size > (m_Size - m_Position)))
+        {
+            m_bFailed = true;
+            return;
+        }
+
+        std::memcpy(data, m_pBuffer + m_Position, size);
+        m_Position += size;
+    }
+
+    void skip(size_t size)
+    {
+        if (m_bFailed || (size > (m_Size - m_Position)))
+        {
+            m_bFailed = true;
+            return;
+        }
+
+        m_Position += size;
+    }
+
+    void seek(size_t position)
+    {
+        if (position > m_Size)
+        {
+            m_bFailed = true;
+            return;
+        }
+
+        m_Position = position;
+        m_bFailed = false;
+    }
+
+    size_t size() const
+    {
+        return m_Size;
+    }
+
+    bool good() const
+    {
+        return !m_bFailed;
+    }
+
+    void set_compact(bool compact)
+    {
+        m_bCompact = compact;
+    }
+
+    bool compact() const
+    {
+        return m_bCompact;
+    }
+
+private:
+    const char* m_pBuffer;
+    size_t m_Size;
+    size_t m_Position;
+    bool m_bFailed;
+    bool m_bCompact;
+};
+
+#endif /* STATE_SERIALIZER_H */